@@ -0,0 +1,170 @@
+#include <benchmark/benchmark.h>
+#include <QByteArray>
+#include <QDataStream>
+#include <QStringList>
+#include <QVariantMap>
+#include "message.h"
+#include "nodetable.h"
+#include "wireformat.h"
+
+// Codec cost per message for the legacy QVariantMap path (toVariantMap,
+// fromVariantMap, QDataStream << and >>) and the binary WireFormat, for
+// payloads of 16 B to 64 KB in four scripts. Arguments are
+// {payload bytes, script}; bytes_per_second is UTF-8 payload bytes.
+
+enum Script {
+    Ascii,
+    Latin1,  // two-byte UTF-8 sequences
+    Cjk,     // three-byte sequences
+    Emoji    // four-byte sequences (UTF-16 surrogate pairs)
+};
+
+static const char* const ScriptNames[] = {"ascii", "latin1", "cjk", "emoji"};
+
+// Text in the given script whose UTF-8 encoding is exactly bytes long
+static QString makeText(int bytes, Script script) {
+    QString sample;
+    switch (script) {
+    case Ascii:
+        sample = QString::fromUtf8("The quick brown fox jumps over the lazy dog. ");
+        break;
+    case Latin1:
+        sample = QString::fromUtf8("Déjà vu, señor: größte Ærø façade. ");
+        break;
+    case Cjk:
+        sample = QString::fromUtf8("环形网络消息传递测试文本。");
+        break;
+    case Emoji:
+        sample = QString::fromUtf8("😀🚀🌍💬🔁");
+        break;
+    }
+
+    // Whole code points only, cycling through the sample
+    QString text;
+    int utf8Size = 0;
+    const QVector<uint> codePoints = sample.toUcs4();
+    for (int i = 0;; i = (i + 1) % codePoints.size()) {
+        QString next = QString::fromUcs4(reinterpret_cast<const char32_t*>(&codePoints[i]), 1);
+        int nextSize = next.toUtf8().size();
+        if (utf8Size + nextSize > bytes) {
+            break;
+        }
+        text += next;
+        utf8Size += nextSize;
+    }
+    // Top up with ASCII so every script lands on the same byte count
+    text += QString(bytes - utf8Size, 'x');
+    return text;
+}
+
+static Message makeMessage(const benchmark::State& state) {
+    return Message(makeText(int(state.range(0)), Script(state.range(1))), "Node1", "Node3", 42);
+}
+
+static void setCounters(benchmark::State& state) {
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.SetLabel(ScriptNames[state.range(1)]);
+}
+
+static NodeTable ringTable() {
+    NodeTable nodes;
+    nodes.setRingMembers(QStringList({"Node1", "Node2", "Node3", "Node4"}));
+    return nodes;
+}
+
+static void BM_ToVariantMap(benchmark::State& state) {
+    const Message message = makeMessage(state);
+    for (auto _ : state) {
+        QVariantMap map = message.toVariantMap();
+        benchmark::DoNotOptimize(map);
+    }
+    setCounters(state);
+}
+
+static void BM_FromVariantMap(benchmark::State& state) {
+    const QVariantMap map = makeMessage(state).toVariantMap();
+    for (auto _ : state) {
+        Message message = Message::fromVariantMap(map);
+        benchmark::DoNotOptimize(message);
+    }
+    setCounters(state);
+}
+
+static void BM_DataStreamWrite(benchmark::State& state) {
+    const Message message = makeMessage(state);
+    QByteArray out;
+    for (auto _ : state) {
+        out.resize(0);
+        WireFormat::encodeLegacy(message, out);
+        benchmark::DoNotOptimize(out.constData());
+    }
+    setCounters(state);
+}
+
+static void BM_DataStreamRead(benchmark::State& state) {
+    QByteArray frame;
+    WireFormat::encodeLegacy(makeMessage(state), frame);
+    for (auto _ : state) {
+        Message message;
+        WireFormat::decodeLegacy(frame.constData(), frame.size(), message);
+        benchmark::DoNotOptimize(message);
+    }
+    setCounters(state);
+}
+
+static void BM_WireEncode(benchmark::State& state) {
+    const NodeTable nodes = ringTable();
+    const Message message = makeMessage(state);
+    QByteArray out;
+    for (auto _ : state) {
+        out.resize(0);
+        WireFormat::encodeMessage(message, nodes, out);
+        benchmark::DoNotOptimize(out.constData());
+    }
+    setCounters(state);
+}
+
+static void BM_WireDecode(benchmark::State& state) {
+    const NodeTable nodes = ringTable();
+    QByteArray frame;
+    WireFormat::encodeMessage(makeMessage(state), nodes, frame);
+    for (auto _ : state) {
+        Message message;
+        WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, message);
+        benchmark::DoNotOptimize(message);
+    }
+    setCounters(state);
+}
+
+// What the UI pays on top of a binary decode to display the text
+static void BM_WireDecodeToQString(benchmark::State& state) {
+    const NodeTable nodes = ringTable();
+    QByteArray frame;
+    WireFormat::encodeMessage(makeMessage(state), nodes, frame);
+    for (auto _ : state) {
+        Message message;
+        WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, message);
+        QString text = message.getChatText();
+        benchmark::DoNotOptimize(text);
+    }
+    setCounters(state);
+}
+
+// 16 B .. 64 KB in powers of four, in every script
+static void CodecArgs(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"bytes", "script"});
+    for (int script = Ascii; script <= Emoji; ++script) {
+        for (int bytes = 16; bytes <= 64 * 1024; bytes *= 4) {
+            bench->Args({bytes, script});
+        }
+    }
+}
+
+BENCHMARK(BM_ToVariantMap)->Apply(CodecArgs);
+BENCHMARK(BM_FromVariantMap)->Apply(CodecArgs);
+BENCHMARK(BM_DataStreamWrite)->Apply(CodecArgs);
+BENCHMARK(BM_DataStreamRead)->Apply(CodecArgs);
+BENCHMARK(BM_WireEncode)->Apply(CodecArgs);
+BENCHMARK(BM_WireDecode)->Apply(CodecArgs);
+BENCHMARK(BM_WireDecodeToQString)->Apply(CodecArgs);
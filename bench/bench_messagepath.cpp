@@ -0,0 +1,203 @@
+#include <benchmark/benchmark.h>
+#include <QByteArray>
+#include <QStringList>
+#include <QtEndian>
+#include <atomic>
+#include <cstdlib>
+#include "nodetable.h"
+#include "payloadpool.h"
+#include "receivebuffer.h"
+#include "reorderbuffer.h"
+#include "wireformat.h"
+
+// Counts heap allocations per message on the receive, forward and delivery
+// paths. Qt containers allocate with malloc, so on glibc the allocator entry
+// points are wrapped; elsewhere allocs_per_msg is reported as -1. A path that
+// allocates once warm is reported as an error and the run exits non-zero.
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+static std::atomic<quint64> allocations{0};
+
+extern "C" void* malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+static quint64 allocationCount() { return allocations.load(std::memory_order_relaxed); }
+static const bool CountingAllocations = true;
+#else
+static quint64 allocationCount() { return 0; }
+static const bool CountingAllocations = false;
+#endif
+
+static const int FramesPerRead = 64;
+static const int WarmupReads = 16;
+
+static NodeTable ringTable() {
+    NodeTable nodes;
+    nodes.setRingMembers(QStringList({"Node1", "Node2", "Node3", "Node4"}));
+    return nodes;
+}
+
+// One read worth of chat frames from Node1 to destination, sequence numbers 1..FramesPerRead
+static QByteArray makeChunk(const NodeTable& nodes, const QString& destination, int payloadSize) {
+    QByteArray chunk;
+    for (int sequence = 1; sequence <= FramesPerRead; ++sequence) {
+        QByteArray frame;
+        WireFormat::encodeMessage(Message(QString(payloadSize, 'm'), "Node1", destination, sequence), nodes, frame);
+        char prefix[ReceiveBuffer::PrefixSize];
+        qToBigEndian(quint32(frame.size()), prefix);
+        chunk.append(prefix, ReceiveBuffer::PrefixSize);
+        chunk.append(frame);
+    }
+    return chunk;
+}
+
+static int allocatingPaths = 0;
+
+static void reportAllocations(benchmark::State& state, quint64 before) {
+    quint64 allocated = allocationCount() - before;
+    double messages = double(state.iterations()) * FramesPerRead;
+    state.counters["allocs_per_msg"] = CountingAllocations ? double(allocated) / messages : -1;
+    state.SetItemsProcessed(state.iterations() * FramesPerRead);
+    if (allocated > 0) {
+        ++allocatingPaths;
+        state.SkipWithError("allocated on the message path");
+    }
+}
+
+// Appends one length-prefixed frame the way FrameBatcher::enqueue() does
+static void batchFrame(QByteArray& batch, const char* data, int size) {
+    char prefix[ReceiveBuffer::PrefixSize];
+    qToBigEndian(quint32(size), prefix);
+    batch.append(prefix, ReceiveBuffer::PrefixSize);
+    batch.append(data, size);
+}
+
+// Transit traffic: peek at the destination and cut the frame through untouched
+static void BM_ForwardTransit(benchmark::State& state) {
+    NodeTable nodes = ringTable();
+    const QByteArray chunk = makeChunk(nodes, "Node3", int(state.range(0)));
+    ReceiveBuffer buffer;
+    QByteArray batch;
+
+    auto forwardRead = [&]() {
+        buffer.append(chunk.constData(), chunk.size());
+        const char* data;
+        int size;
+        while (buffer.nextFrame(data, size)) {
+            quint16 handle;
+            const char* name;
+            int nameSize;
+            if (WireFormat::peekDestination(data, size, handle, name, nameSize)) {
+                batchFrame(batch, data, size);
+            }
+        }
+        benchmark::DoNotOptimize(batch.constData());
+        batch.resize(0);
+    };
+
+    for (int i = 0; i < WarmupReads; ++i) {
+        forwardRead();
+    }
+    quint64 before = allocationCount();
+    for (auto _ : state) {
+        forwardRead();
+    }
+    reportAllocations(state, before);
+}
+
+// Decode into a Message and encode it again, as for a legacy neighbor or a resend
+static void BM_ForwardDecoded(benchmark::State& state) {
+    NodeTable nodes = ringTable();
+    const QByteArray chunk = makeChunk(nodes, "Node3", int(state.range(0)));
+    ReceiveBuffer buffer;
+    QByteArray batch;
+
+    auto forwardRead = [&]() {
+        buffer.append(chunk.constData(), chunk.size());
+        const char* data;
+        int size;
+        while (buffer.nextFrame(data, size)) {
+            Message message;
+            if (WireFormat::decodeMessage(data, size, nodes, message)) {
+                WireFormat::encodeMessage(message, nodes, batch);
+            }
+        }
+        benchmark::DoNotOptimize(batch.constData());
+        batch.resize(0);
+    };
+
+    for (int i = 0; i < WarmupReads; ++i) {
+        forwardRead();
+    }
+    quint64 before = allocationCount();
+    for (auto _ : state) {
+        forwardRead();
+    }
+    reportAllocations(state, before);
+}
+
+// Local delivery: decode, move through the reorder buffer and release in order
+static void BM_DeliverInOrder(benchmark::State& state) {
+    NodeTable nodes = ringTable();
+    const QByteArray chunk = makeChunk(nodes, "Node2", int(state.range(0)));
+    ReceiveBuffer buffer;
+    QVector<Message> ready;
+
+    auto deliverRead = [&]() {
+        // Every read starts the sequence over; an in-order buffer never allocates its window
+        ReorderBuffer reorder;
+        buffer.append(chunk.constData(), chunk.size());
+        const char* data;
+        int size;
+        while (buffer.nextFrame(data, size)) {
+            Message message;
+            if (WireFormat::decodeMessage(data, size, nodes, message)) {
+                reorder.insert(std::move(message), ready);
+            }
+            for (const Message& inOrder : ready) {
+                benchmark::DoNotOptimize(inOrder.chatTextUtf8().constData());
+            }
+            ready.clear();
+        }
+    };
+
+    for (int i = 0; i < WarmupReads; ++i) {
+        deliverRead();
+    }
+    quint64 before = allocationCount();
+    for (auto _ : state) {
+        deliverRead();
+    }
+    reportAllocations(state, before);
+    state.counters["pool_buffers"] = PayloadPool::local().size();
+}
+
+BENCHMARK(BM_ForwardTransit)->ArgName("payload")->Arg(64)->Arg(1024);
+BENCHMARK(BM_ForwardDecoded)->ArgName("payload")->Arg(64)->Arg(1024);
+BENCHMARK(BM_DeliverInOrder)->ArgName("payload")->Arg(64)->Arg(1024);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return allocatingPaths > 0 ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include <QByteArray>
+#include <QDataStream>
+#include <QtEndian>
+#include "receivebuffer.h"
+
+// One read worth of back-to-back frames, as a socket would deliver them
+static QByteArray makeChunk(int frames, int payloadSize) {
+    QByteArray body(payloadSize, 'm');
+    char prefix[ReceiveBuffer::PrefixSize];
+    qToBigEndian(quint32(body.size()), prefix);
+
+    QByteArray chunk;
+    for (int i = 0; i < frames; ++i) {
+        chunk.append(prefix, ReceiveBuffer::PrefixSize);
+        chunk.append(body);
+    }
+    return chunk;
+}
+
+// The previous receive loop: remove() the prefix and the body from the front for every frame
+static void BM_QByteArrayRemove(benchmark::State& state) {
+    const int frames = int(state.range(0));
+    const QByteArray chunk = makeChunk(frames, int(state.range(1)));
+    QByteArray buffer;
+
+    for (auto _ : state) {
+        buffer.append(chunk);
+        while (buffer.size() >= int(sizeof(quint32))) {
+            QDataStream sizeStream(buffer);
+            quint32 messageSize;
+            sizeStream >> messageSize;
+            if (quint32(buffer.size()) < sizeof(quint32) + messageSize) {
+                break;
+            }
+            buffer.remove(0, sizeof(quint32));
+            QByteArray messageData = buffer.left(messageSize);
+            buffer.remove(0, messageSize);
+            benchmark::DoNotOptimize(messageData.constData());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * chunk.size());
+}
+
+static void BM_ReceiveBuffer(benchmark::State& state) {
+    const int frames = int(state.range(0));
+    const QByteArray chunk = makeChunk(frames, int(state.range(1)));
+    ReceiveBuffer buffer;
+
+    for (auto _ : state) {
+        buffer.append(chunk.constData(), chunk.size());
+        const char* data;
+        int size;
+        while (buffer.nextFrame(data, size)) {
+            benchmark::DoNotOptimize(data);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * chunk.size());
+}
+
+// Frames per read from 1 to 4096; per-frame cost is items_per_second inverted
+static void FrameArgs(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"frames", "payload"});
+    for (int payload : {64, 1024}) {
+        for (int frames = 1; frames <= 4096; frames *= 4) {
+            bench->Args({frames, payload});
+        }
+    }
+}
+
+BENCHMARK(BM_QByteArrayRemove)->Apply(FrameArgs);
+BENCHMARK(BM_ReceiveBuffer)->Apply(FrameArgs);
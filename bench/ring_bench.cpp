@@ -0,0 +1,440 @@
+#include <QCoreApplication>
+#include <QFile>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "networkmanager.h"
+#include "ringconfig.h"
+#include "ringrouter.h"
+#include "transport.h"
+
+// Runs a ring of --nodes nodes on localhost and pushes chat traffic through
+// it: random origin/destination pairs, --size byte payloads, at --rate
+// messages per second (0 = as fast as a window of --window messages in
+// flight allows). After --warmup messages, --messages are measured and the
+// run reports throughput, end-to-end latency percentiles, latency divided
+// by route length and CPU time per message. That ratio spreads the send and
+// delivery cost over the hops, so it is not the time one hop takes; the
+// per-hop timeline comes from --trace-every on the nodes themselves.
+//
+// Nodes are NetworkManagers sharing this process's event loop, or with
+// --processes, one headless node process per node (--binary, SimpleChat_Node
+// or SimpleChat, which is passed --headless) driven over
+// stdin/stdout. Latency comes from the send time carried with each message;
+// every node runs on this host, so they share one clock. Debug logging is
+// switched off so it does not dominate the measurement.
+//
+//   SimpleChat_Bench [--nodes N] [--messages M] [--warmup W] [--size B] [--rate R] [--window W]
+//                    [--routing clockwise|shortest|finger] [--transport qt|epoll|uring] [--base-port P]
+//                    [--seed S] [--processes --binary PATH] [--timeout-ms T] [--csv]
+
+struct Options {
+    int nodes = 4;
+    int messages = 20000;
+    int warmup = 1000;
+    int size = 64;
+    int rate = 0;
+    int window = 1000;
+    RingRouter::Mode routing = RingRouter::ShortestDirection;
+    const char* routingName = "shortest";
+    Transport::Backend transport = Transport::QtSockets;
+    const char* transportName = "qt";
+    int basePort = 19001;
+    unsigned seed = 1;
+    bool processes = false;
+    QString binary;
+    int timeoutMsec = 120000;
+    bool csv = false;
+};
+
+static qint64 wallClockUsec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// User plus system time of this process in microseconds
+static qint64 cpuUsec() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// The same for another process; Linux only, -1 elsewhere
+static qint64 processCpuUsec(qint64 pid) {
+    QFile stat(QString("/proc/%1/stat").arg(pid));
+    if (!stat.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    // Fields after the parenthesised command name; utime and stime are the 12th and 13th of them
+    QByteArray line = stat.readAll();
+    QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13) {
+        return -1;
+    }
+    qint64 ticks = fields[11].toLongLong() + fields[12].toLongLong();
+    return ticks * 1000000 / sysconf(_SC_CLK_TCK);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, size_t(p * double(sorted.size())))];
+}
+
+static void quietMessageHandler(QtMsgType type, const QMessageLogContext&, const QString& message) {
+    if (type != QtDebugMsg && type != QtInfoMsg) {
+        std::fprintf(stderr, "%s\n", qPrintable(message));
+    }
+}
+
+class RingBench {
+public:
+    RingBench(const Options& options)
+        : options(options), ring(RingConfig::localRing(options.nodes, options.basePort)), rng(options.seed),
+          expectedLinks(0), connectedLinks(0), sent(0), delivered(0), target(0), measuring(false),
+          measureStartUsec(0), measureStartCpu(0) {
+        for (int i = 0; i < ring.size(); ++i) {
+            RingRouter router;
+            router.configure(ring.size(), i, options.routing);
+            expectedLinks += router.neighbors().size();
+            routers.append(router);
+        }
+        // Headless nodes carry the send time in the text, which takes up to 17 of the bytes
+        int padding = options.processes ? options.size - 17 : options.size;
+        payload = QString(qMax(1, padding), 'x');
+    }
+
+    ~RingBench() {
+        for (QProcess* process : processes) {
+            process->write("quit\n");
+            process->waitForFinished(2000);
+        }
+        qDeleteAll(processes);
+        qDeleteAll(managers);
+    }
+
+    bool start() {
+        return options.processes ? startProcesses() : startManagers();
+    }
+
+    // Sends count messages and waits for all of them (or the deadline); false on timeout
+    bool run(int count, bool measured) {
+        measuring = measured;
+        sent = 0;
+        delivered = 0;
+        target = count;
+        latencies.clear();
+        latencyOverHops.clear();
+        measureStartUsec = wallClockUsec();
+        measureStartCpu = totalCpuUsec();
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        QTimer pump;
+        QObject::connect(&pump, &QTimer::timeout, [&]() {
+            qint64 due = options.rate > 0 ? qMin<qint64>(target, options.rate * elapsed.nsecsElapsed() / 1000000000)
+                                          : target;
+            while (sent < due && sent - delivered < options.window) {
+                sendOne();
+            }
+        });
+        pump.start(options.rate > 0 ? 1 : 0);
+        bool done = waitUntil([this]() { return delivered >= target; }, options.timeoutMsec);
+        pump.stop();
+
+        measureUsec = wallClockUsec() - measureStartUsec;
+        measureCpu = totalCpuUsec() - measureStartCpu;
+        return done;
+    }
+
+    bool waitForLinks() {
+        return waitUntil([this]() { return connectedLinks >= expectedLinks; }, options.timeoutMsec);
+    }
+
+    void report(bool complete) const {
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double ratioTotal = 0;
+        for (double value : latencyOverHops) {
+            ratioTotal += value;
+        }
+        double seconds = double(measureUsec) / 1e6;
+        double throughput = seconds > 0 ? double(delivered) / seconds : 0;
+        double latencyOverHopsUsec = latencyOverHops.empty() ? 0 : ratioTotal / double(latencyOverHops.size());
+        double cpuPerMessage = measureCpu >= 0 && delivered > 0 ? double(measureCpu) / double(delivered) : -1;
+        const char* mode = options.processes ? "process" : "inproc";
+
+        if (options.csv) {
+            std::printf("nodes,mode,routing,transport,size,rate,delivered,msgs_per_s,p50_us,p99_us,p999_us,max_us,"
+                        "latency_over_hops_us,cpu_us_per_msg,complete\n");
+            std::printf("%d,%s,%s,%s,%d,%d,%ld,%.0f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%d\n", options.nodes, mode,
+                        options.routingName, options.transportName, options.size, options.rate, delivered, throughput,
+                        percentile(sorted, 0.50), percentile(sorted, 0.99), percentile(sorted, 0.999),
+                        sorted.empty() ? 0.0 : sorted.back(), latencyOverHopsUsec, cpuPerMessage,
+                        complete ? 1 : 0);
+            return;
+        }
+        std::printf("%d nodes (%s, %s routing, %s transport), %d byte messages, rate %s\n", options.nodes,
+                    mode, options.routingName, options.transportName, options.size,
+                    options.rate > 0 ? qPrintable(QString::number(options.rate) + "/s") : "unlimited");
+        std::printf("  delivered   %ld of %d in %.3f s%s\n", delivered, target, seconds,
+                    complete ? "" : " (timed out)");
+        std::printf("  throughput  %.0f msgs/s\n", throughput);
+        std::printf("  latency     p50 %.1f us  p99 %.1f us  p999 %.1f us  max %.1f us\n",
+                    percentile(sorted, 0.50), percentile(sorted, 0.99), percentile(sorted, 0.999),
+                    sorted.empty() ? 0.0 : sorted.back());
+        std::printf("  latency/hops %.2f us (end to end over route length)\n", latencyOverHopsUsec);
+        if (cpuPerMessage >= 0) {
+            std::printf("  cpu         %.2f us per message\n", cpuPerMessage);
+        } else {
+            std::printf("  cpu         unavailable\n");
+        }
+    }
+
+private:
+    bool startManagers() {
+        for (int i = 0; i < ring.size(); ++i) {
+            const RingMember& member = ring.member(i);
+            NetworkManager* manager = new NetworkManager();
+            manager->setNodeId(member.nodeId);
+            manager->setRoutingMode(options.routing);
+            manager->setTimestampsEnabled(true);
+            manager->setTransportBackend(options.transport);
+            if (!manager->startServer(member.port, QHostAddress(QHostAddress::LocalHost))) {
+                std::fprintf(stderr, "cannot listen on port %d\n", member.port);
+                delete manager;
+                return false;
+            }
+            // A transport the kernel refuses falls back to qt, which would be measured under the wrong name
+            if (manager->getTransportBackend() != options.transport) {
+                std::fprintf(stderr, "the %s transport is not usable on this system\n", options.transportName);
+                delete manager;
+                return false;
+            }
+            QObject::connect(manager, &NetworkManager::connectionEstablished, [this]() { ++connectedLinks; });
+            QObject::connect(manager, &NetworkManager::messageReceived, [this, i](const Message& message) {
+                received(message.getTimestamp(), ring.indexOfNode(message.getOrigin()), i);
+            });
+            managers.append(manager);
+        }
+        for (NetworkManager* manager : managers) {
+            manager->setRingTopology(ring);
+        }
+        return true;
+    }
+
+    bool startProcesses() {
+        if (options.binary.isEmpty()) {
+            std::fprintf(stderr, "--processes needs --binary <path to SimpleChat_Node or SimpleChat>\n");
+            return false;
+        }
+        if (!storeDirectory.isValid()) {
+            return false;
+        }
+
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert("QT_LOGGING_RULES", "*.debug=false");
+        for (int i = 0; i < ring.size(); ++i) {
+            QProcess* process = new QProcess();
+            process->setProcessEnvironment(environment);
+            process->setStandardErrorFile(QProcess::nullDevice());
+            QObject::connect(process, &QProcess::readyReadStandardOutput, [this, process, i]() {
+                while (process->canReadLine()) {
+                    processEvent(QString::fromUtf8(process->readLine()).trimmed(), i);
+                }
+            });
+            process->start(options.binary, {"--headless", "--ring-size", QString::number(options.nodes),
+                                            "--base-port", QString::number(options.basePort),
+                                            "--node", ring.member(i).nodeId,
+                                            "--routing", options.routingName,
+                                            "--transport", options.transportName,
+                                            "--store-dir", storeDirectory.path()});
+            if (!process->waitForStarted()) {
+                std::fprintf(stderr, "cannot start %s\n", qPrintable(options.binary));
+                delete process;
+                return false;
+            }
+            processes.append(process);
+        }
+        return true;
+    }
+
+    // Headless nodes report "connected <peer>" and "recv <origin> <sequence> <send usec> <padding>"
+    void processEvent(const QString& line, int node) {
+        if (line.startsWith("connected ")) {
+            ++connectedLinks;
+        } else if (line.startsWith("recv ")) {
+            int origin = ring.indexOfNode(line.section(' ', 1, 1));
+            received(line.section(' ', 3, 3).toLongLong(), origin, node);
+        }
+    }
+
+    void sendOne() {
+        std::uniform_int_distribution<int> member(0, ring.size() - 1);
+        int origin = member(rng);
+        int destination = member(rng);
+        while (destination == origin) {
+            destination = member(rng);
+        }
+
+        const QString& destinationId = ring.member(destination).nodeId;
+        if (options.processes) {
+            QByteArray command = QString("send %1 %2 %3\n").arg(destinationId).arg(wallClockUsec()).arg(payload).toUtf8();
+            processes[origin]->write(command);
+        } else {
+            // Placeholder sequence number; NetworkManager assigns the real one
+            managers[origin]->sendMessage(Message(payload, ring.member(origin).nodeId, destinationId, 1));
+        }
+        ++sent;
+    }
+
+    void received(qint64 sentUsec, int origin, int destination) {
+        ++delivered;
+        if (!measuring || sentUsec < measureStartUsec || origin < 0) {
+            return;
+        }
+        double latency = double(wallClockUsec() - sentUsec);
+        latencies.push_back(latency);
+        latencyOverHops.push_back(latency / qMax(1, routers[origin].hopCount(destination)));
+    }
+
+    qint64 totalCpuUsec() const {
+        if (!options.processes) {
+            return cpuUsec();
+        }
+        qint64 total = 0;
+        for (QProcess* process : processes) {
+            qint64 usec = processCpuUsec(process->processId());
+            if (usec < 0) {
+                return -1;
+            }
+            total += usec;
+        }
+        return total;
+    }
+
+    template <typename Condition>
+    static bool waitUntil(Condition condition, int timeoutMsec) {
+        QElapsedTimer timer;
+        timer.start();
+        while (!condition()) {
+            if (timer.elapsed() > timeoutMsec) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        return true;
+    }
+
+    Options options;
+    RingConfig ring;
+    QVector<RingRouter> routers;
+    QVector<NetworkManager*> managers;
+    QVector<QProcess*> processes;
+    QTemporaryDir storeDirectory;
+    QString payload;
+    std::mt19937 rng;
+
+    int expectedLinks;
+    int connectedLinks;
+    long sent;
+    long delivered;
+    int target;
+    bool measuring;
+    qint64 measureStartUsec;
+    qint64 measureStartCpu;
+    qint64 measureUsec = 0;
+    qint64 measureCpu = 0;
+    std::vector<double> latencies;
+    std::vector<double> latencyOverHops;
+};
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(quietMessageHandler);
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--nodes") == 0 && hasValue) {
+            options.nodes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--messages") == 0 && hasValue) {
+            options.messages = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            options.size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+            options.rate = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--window") == 0 && hasValue) {
+            options.window = qMax(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--routing") == 0 && hasValue) {
+            options.routingName = argv[++i];
+            if (std::strcmp(options.routingName, "clockwise") == 0) {
+                options.routing = RingRouter::Clockwise;
+            } else if (std::strcmp(options.routingName, "finger") == 0) {
+                options.routing = RingRouter::Finger;
+            } else {
+                options.routingName = "shortest";
+            }
+        } else if (std::strcmp(argv[i], "--transport") == 0 && hasValue) {
+            if (!Transport::parseBackend(QString::fromLatin1(argv[++i]), options.transport)) {
+                std::fprintf(stderr, "unknown transport %s (expected qt, epoll or uring)\n", argv[i]);
+                return 2;
+            }
+            if (!Transport::isAvailable(options.transport)) {
+                std::fprintf(stderr, "transport %s is not available in this build\n", argv[i]);
+                return 2;
+            }
+            options.transportName = argv[i];
+        } else if (std::strcmp(argv[i], "--base-port") == 0 && hasValue) {
+            options.basePort = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = unsigned(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--processes") == 0) {
+            options.processes = true;
+        } else if (std::strcmp(argv[i], "--binary") == 0 && hasValue) {
+            options.binary = QString::fromLocal8Bit(argv[++i]);
+        } else if (std::strcmp(argv[i], "--timeout-ms") == 0 && hasValue) {
+            options.timeoutMsec = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            options.csv = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--nodes N] [--messages M] [--warmup W] [--size B] [--rate R] [--window W]\n"
+                                 "       [--routing clockwise|shortest|finger] [--transport qt|epoll|uring] [--base-port P]\n"
+                                 "       [--seed S] [--processes --binary PATH] [--timeout-ms T] [--csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.nodes < 2) {
+        std::fprintf(stderr, "a ring needs at least 2 nodes\n");
+        return 2;
+    }
+
+    RingBench bench(options);
+    if (!bench.start()) {
+        return 1;
+    }
+    if (!bench.waitForLinks()) {
+        std::fprintf(stderr, "ring links did not come up\n");
+        return 1;
+    }
+    // Warm-up also lets every link finish negotiating the binary wire format
+    if (options.warmup > 0 && !bench.run(options.warmup, false)) {
+        std::fprintf(stderr, "warm-up did not complete\n");
+        return 1;
+    }
+    bool complete = bench.run(options.messages, true);
+    bench.report(complete);
+    return complete ? 0 : 1;
+}
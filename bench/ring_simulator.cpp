@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "ringrouter.h"
+
+// Walks messages through RingRouter for every routing mode and ring sizes
+// 1..1024, including the degenerate rings of one and two nodes and sizes on
+// either side of powers of two, and reports the hop count and modelled
+// latency distributions. Each hop costs --hop-us plus exponentially
+// distributed jitter with mean --jitter-us. Exits non-zero if a route loops
+// or takes a different number of hops than RingRouter::hopCount() predicts.
+//
+//   SimpleChat_RingSim [--samples N] [--hop-us U] [--jitter-us J] [--seed S] [--csv]
+
+struct Summary {
+    double mean;
+    double p50;
+    double p99;
+    double max;
+};
+
+static Summary summarize(std::vector<double>& values) {
+    // A ring of one has nobody to send to
+    if (values.empty()) {
+        return {0, 0, 0, 0};
+    }
+    std::sort(values.begin(), values.end());
+    double total = 0;
+    for (double value : values) {
+        total += value;
+    }
+    auto percentile = [&values](double p) {
+        return values[std::min(values.size() - 1, size_t(p * double(values.size())))];
+    };
+    return {total / double(values.size()), percentile(0.50), percentile(0.99), values.back()};
+}
+
+// Follows nextHop() from origin to destination; -1 if the route loops
+static int walk(int ringSize, int origin, int destination, RingRouter::Mode mode) {
+    RingRouter router;
+    int at = origin;
+    int hops = 0;
+    while (at != destination) {
+        if (hops > ringSize) {
+            return -1;
+        }
+        router.configure(ringSize, at, mode);
+        at = router.nextHop(destination);
+        ++hops;
+    }
+    return hops;
+}
+
+int main(int argc, char* argv[]) {
+    long samples = 20000;
+    double hopUsec = 50.0;
+    double jitterUsec = 30.0;
+    unsigned seed = 1;
+    bool csv = false;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--samples") == 0 && hasValue) {
+            samples = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hop-us") == 0 && hasValue) {
+            hopUsec = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--jitter-us") == 0 && hasValue) {
+            jitterUsec = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = unsigned(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--samples N] [--hop-us U] [--jitter-us J] [--seed S] [--csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const struct { RingRouter::Mode mode; const char* name; } modes[] = {
+        {RingRouter::Clockwise, "clockwise"},
+        {RingRouter::ShortestDirection, "shortest"},
+        {RingRouter::Finger, "finger"},
+    };
+
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> jitter(jitterUsec > 0 ? 1.0 / jitterUsec : 1.0);
+
+    if (csv) {
+        std::printf("nodes,mode,links,hops_mean,hops_p50,hops_p99,hops_max,"
+                    "latency_mean_us,latency_p50_us,latency_p99_us,latency_max_us\n");
+    } else {
+        std::printf("%6s %-10s %5s | %8s %6s %6s %6s | %10s %10s %10s %10s\n", "nodes", "mode", "links",
+                    "hops avg", "p50", "p99", "max", "lat avg us", "p50", "p99", "max");
+    }
+
+    const int ringSizes[] = {1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 31, 32, 33, 64, 100, 128, 255, 256, 512, 1000, 1023, 1024};
+    for (int ringSize : ringSizes) {
+        // Small rings are enumerated exactly, large ones sampled
+        std::vector<std::pair<int, int>> pairs;
+        if (long(ringSize) * (ringSize - 1) <= samples) {
+            for (int origin = 0; origin < ringSize; ++origin) {
+                for (int destination = 0; destination < ringSize; ++destination) {
+                    if (origin != destination) {
+                        pairs.emplace_back(origin, destination);
+                    }
+                }
+            }
+        } else {
+            std::uniform_int_distribution<int> member(0, ringSize - 1);
+            while (long(pairs.size()) < samples) {
+                int origin = member(rng);
+                int destination = member(rng);
+                if (origin != destination) {
+                    pairs.emplace_back(origin, destination);
+                }
+            }
+        }
+
+        for (const auto& entry : modes) {
+            RingRouter router;
+            router.configure(ringSize, 0, entry.mode);
+            int links = int(router.neighbors().size());
+
+            std::vector<double> hops;
+            std::vector<double> latencies;
+            hops.reserve(pairs.size());
+            latencies.reserve(pairs.size());
+            for (const auto& pair : pairs) {
+                int count = walk(ringSize, pair.first, pair.second, entry.mode);
+                if (count < 0) {
+                    std::fprintf(stderr, "%s: no route %d -> %d on a ring of %d\n",
+                                 entry.name, pair.first, pair.second, ringSize);
+                    return 1;
+                }
+                router.configure(ringSize, pair.first, entry.mode);
+                if (count != router.hopCount(pair.second)) {
+                    std::fprintf(stderr, "%s: %d -> %d on a ring of %d took %d hops, expected %d\n",
+                                 entry.name, pair.first, pair.second, ringSize, count, router.hopCount(pair.second));
+                    return 1;
+                }
+                double latency = 0;
+                for (int hop = 0; hop < count; ++hop) {
+                    latency += hopUsec + (jitterUsec > 0 ? jitter(rng) : 0.0);
+                }
+                hops.push_back(count);
+                latencies.push_back(latency);
+            }
+
+            Summary h = summarize(hops);
+            Summary l = summarize(latencies);
+            if (csv) {
+                std::printf("%d,%s,%d,%.3f,%.0f,%.0f,%.0f,%.1f,%.1f,%.1f,%.1f\n", ringSize, entry.name, links,
+                            h.mean, h.p50, h.p99, h.max, l.mean, l.p50, l.p99, l.max);
+            } else {
+                std::printf("%6d %-10s %5d | %8.2f %6.0f %6.0f %6.0f | %10.1f %10.1f %10.1f %10.1f\n",
+                            ringSize, entry.name, links, h.mean, h.p50, h.p99, h.max,
+                            l.mean, l.p50, l.p99, l.max);
+            }
+        }
+    }
+    return 0;
+}
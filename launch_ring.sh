@@ -5,6 +5,19 @@
 
 set -e
 
+# Usage: ./launch_ring.sh [nodes] [base-port]
+NODES=${1:-4}
+BASE_PORT=${2:-9001}
+
+# Larger rings run headless (SimpleChat_Node, which does not load QtWidgets) and start faster;
+# the nodes retry until their neighbor is up
+DELAY=3
+HEADLESS=0
+if [ "$NODES" -gt 8 ]; then
+    DELAY=0.2
+    HEADLESS=1
+fi
+
 echo "Building SimpleChat..."
 
 # Create build directory and clean any existing cache
@@ -29,25 +42,22 @@ if [ ! -f "./SimpleChat" ]; then
 fi
 
 echo "Launching SimpleChat ring network..."
-echo "Starting 4 nodes on ports 9001, 9002, 9003, 9004"
+echo "Starting $NODES nodes on ports $BASE_PORT-$((BASE_PORT + NODES - 1))"
 echo ""
 
 # Launch instances in background with proper delays
-echo "Starting Node 1 (port 9001)..."
-./SimpleChat --port 9001 &
-sleep 3
-
-echo "Starting Node 2 (port 9002)..."
-./SimpleChat --port 9002 &
-sleep 3
-
-echo "Starting Node 3 (port 9003)..."
-./SimpleChat --port 9003 &
-sleep 3
-
-echo "Starting Node 4 (port 9004)..."
-./SimpleChat --port 9004 &
-sleep 3
+for ((i = 0; i < NODES; i++)); do
+    port=$((BASE_PORT + i))
+    echo "Starting Node $((i + 1)) (port $port)..."
+    if [ "$HEADLESS" -eq 1 ]; then
+        mkdir -p logs
+        ./SimpleChat_Node --port $port --ring-size $NODES --base-port $BASE_PORT \
+            </dev/null >logs/node$((i + 1)).out 2>logs/node$((i + 1)).log &
+    else
+        ./SimpleChat --port $port --ring-size $NODES --base-port $BASE_PORT &
+    fi
+    sleep $DELAY
+done
 
 echo "Waiting for all connections to establish..."
 sleep 5
@@ -59,12 +69,12 @@ echo "Usage:"
 echo "- Select destination node from dropdown menu"
 echo "- Type your message in the text input area"
 echo "- Click 'Send' or press Enter to send message"
-echo "- Available nodes: Node1, Node2, Node3, Node4"
+echo "- Available nodes: Node1 .. Node$NODES"
 echo ""
 echo "Press Ctrl+C to stop all instances"
 
 # Wait for user to stop
-trap 'echo ""; echo "Stopping all instances..."; killall SimpleChat 2>/dev/null || true; exit 0' INT
+trap 'echo ""; echo "Stopping all instances..."; killall SimpleChat SimpleChat_Node 2>/dev/null || true; exit 0' INT
 
 # Keep script running
 while true; do
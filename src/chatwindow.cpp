@@ -1,8 +1,13 @@
 #include "chatwindow.h"
 #include <QApplication>
 #include <QKeyEvent>
+#include <QDir>
+#include <QScrollBar>
 
-ChatWindow::ChatWindow(QWidget* parent) : QWidget(parent) {
+static const int ScrollbackPageRows = 100;
+
+ChatWindow::ChatWindow(QWidget* parent)
+    : QWidget(parent), historyRows(ConversationModel::DefaultWindowRows) {
     setupUI();
     setWindowTitle("SimpleChat");
     resize(500, 400);
@@ -10,6 +15,7 @@ ChatWindow::ChatWindow(QWidget* parent) : QWidget(parent) {
 
 void ChatWindow::setupUI() {
     auto* mainLayout = new QVBoxLayout(this);
+    messageDelegate = new MessageDelegate(this);
     
     // Apply dark theme styling to main window
     setStyleSheet("QWidget { background-color: #0B141A; color: #E9EDEF; }");
@@ -77,7 +83,6 @@ void ChatWindow::setupUI() {
     inputLayout->addWidget(destLabel);
     
     destinationCombo = new QComboBox(this);
-    destinationCombo->addItems({"Node1", "Node2", "Node3", "Node4"});
     destinationCombo->setMinimumWidth(120);
     destinationCombo->setMinimumHeight(40);
     destinationCombo->setStyleSheet(
@@ -242,101 +247,120 @@ void ChatWindow::appendMessage(const QString& message) {
 }
 
 void ChatWindow::appendMessageToConversation(const QString& nodeId, const QString& message) {
-    QTextEdit* conversation = getOrCreateConversation(nodeId);
-    conversation->append(message);
-    conversation->moveCursor(QTextCursor::End);
+    appendToConversation(nodeId, {{message, ConversationModel::Note}});
 }
 
 void ChatWindow::appendSentMessage(const QString& nodeId, const QString& message) {
-    QTextEdit* conversation = getOrCreateConversation(nodeId);
-    QString styledMessage = QString(
-        "<table width='100%' cellpadding='0' cellspacing='0' style='margin: 8px 0;'>"
-        "<tr>"
-        "<td width='30%'></td>"
-        "<td align='right'>"
-        "<div style='"
-        "background-color: #007AFF; "
-        "color: #FFFFFF; "
-        "padding: 12px 16px; "
-        "border-radius: 18px 18px 6px 18px; "
-        "font-size: 14px; "
-        "line-height: 1.4; "
-        "font-weight: 400; "
-        "white-space: pre-wrap; "
-        "display: inline-block; "
-        "max-width: 250px; "
-        "word-wrap: break-word; "
-        "font-family: -apple-system, BlinkMacSystemFont, \"Segoe UI\", Roboto, Arial, sans-serif; "
-        "box-shadow: 0 1px 2px rgba(0,0,0,0.1); "
-        "'>%1</div>"
-        "</td>"
-        "</tr>"
-        "</table>"
-    ).arg(message);
-    conversation->append(styledMessage);
-    conversation->moveCursor(QTextCursor::End);
+    appendToConversation(nodeId, {{message, ConversationModel::Sent}});
 }
 
 void ChatWindow::appendReceivedMessage(const QString& nodeId, const QString& message) {
-    QTextEdit* conversation = getOrCreateConversation(nodeId);
-    QString styledMessage = QString(
-        "<table width='100%' cellpadding='0' cellspacing='0' style='margin: 8px 0;'>"
-        "<tr>"
-        "<td align='left'>"
-        "<div style='"
-        "background-color: #2A2F32; "
-        "color: #E9EDEF; "
-        "padding: 12px 16px; "
-        "border-radius: 18px 18px 18px 6px; "
-        "font-size: 14px; "
-        "line-height: 1.4; "
-        "font-weight: normal; "
-        "white-space: pre-wrap; "
-        "display: inline-block; "
-        "max-width: 250px; "
-        "word-wrap: break-word; "
-        "font-family: -apple-system, BlinkMacSystemFont, \"Segoe UI\", Roboto, Arial, sans-serif; "
-        "box-shadow: 0 1px 2px rgba(0,0,0,0.1); "
-        "'>%1</div>"
-        "</td>"
-        "<td width='30%'></td>"
-        "</tr>"
-        "</table>"
-    ).arg(message);
-    conversation->append(styledMessage);
-    conversation->moveCursor(QTextCursor::End);
+    appendToConversation(nodeId, {{message, ConversationModel::Received}});
+}
+
+void ChatWindow::appendReceivedMessages(const QString& nodeId, const QStringList& messages) {
+    QVector<ConversationModel::Entry> entries;
+    entries.reserve(messages.size());
+    for (const QString& message : messages) {
+        entries.append({message, ConversationModel::Received});
+    }
+    appendToConversation(nodeId, entries);
+}
+
+void ChatWindow::appendToConversation(const QString& nodeId, const QVector<ConversationModel::Entry>& entries) {
+    Conversation* conversation = getOrCreateConversation(nodeId);
+    if (!conversation) {
+        for (const ConversationModel::Entry& entry : entries) {
+            appendMessage(entry.text);
+        }
+        return;
+    }
+    
+    // Only follow new messages if the user hasn't scrolled up to read history;
+    // a whole batch costs one insert and one scroll
+    QScrollBar* scrollBar = conversation->view->verticalScrollBar();
+    bool atBottom = scrollBar->value() == scrollBar->maximum();
+    conversation->model->append(entries);
+    if (atBottom) {
+        // Following the tail: anything older than the window goes back to the scrollback
+        conversation->model->trimToWindow();
+        conversation->view->scrollToBottom();
+    }
+}
+
+void ChatWindow::restoreConversation(const QString& nodeId, const QVector<ConversationModel::Entry>& entries) {
+    Conversation* conversation = getOrCreateConversation(nodeId);
+    if (!conversation) {
+        return;
+    }
+    if (conversation->model->rowCount() == 0) {
+        conversation->model->append(entries);
+        conversation->model->trimToWindow();
+    }
+    conversation->view->scrollToBottom();
 }
 
-QTextEdit* ChatWindow::getOrCreateConversation(const QString& nodeId) {
+void ChatWindow::fetchOlderMessages(Conversation* conversation) {
+    int added = conversation->model->fetchOlder(ScrollbackPageRows);
+    if (added > 0) {
+        // Keep the row that was at the top in place rather than jumping to the new first row
+        conversation->view->scrollTo(conversation->model->index(added), QAbstractItemView::PositionAtTop);
+    }
+}
+
+ChatWindow::Conversation* ChatWindow::getOrCreateConversation(const QString& nodeId) {
     // For consistency, always use the remote node as the conversation key
     QString conversationKey = nodeId;
     if (nodeId == currentNodeId) {
         // This shouldn't happen, but handle it just in case
-        return systemLog;
+        return nullptr;
     }
     
-    if (conversations.contains(conversationKey)) {
-        return conversations[conversationKey];
+    auto existing = conversations.find(conversationKey);
+    if (existing != conversations.end()) {
+        return &existing.value();
     }
     
-    // Create new conversation tab
-    QTextEdit* newConversation = new QTextEdit(this);
-    newConversation->setReadOnly(true);
-    newConversation->setWordWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
-    newConversation->setStyleSheet(
+    // Create new conversation tab; the view only lays out and paints the rows in sight
+    Conversation conversation;
+    conversation.model = new ConversationModel(this);
+    conversation.model->setWindowRows(historyRows);
+    if (!scrollbackDirectory.isEmpty()) {
+        conversation.model->openScrollback(
+            QDir(scrollbackDirectory).filePath(QString("%1-%2").arg(currentNodeId, conversationKey)));
+    }
+    conversation.view = new QListView(this);
+    conversation.view->setModel(conversation.model);
+    conversation.view->setItemDelegate(messageDelegate);
+    conversation.view->setSelectionMode(QAbstractItemView::NoSelection);
+    conversation.view->setFocusPolicy(Qt::NoFocus);
+    conversation.view->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    conversation.view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    conversation.view->setResizeMode(QListView::Adjust);
+    conversation.view->setLayoutMode(QListView::Batched);
+    conversation.view->setUniformItemSizes(false);
+    conversation.view->setStyleSheet(
         "background-color: #0B141A; "
         "color: #8696A0; "
         "border: 1px solid #202C33; "
         "border-radius: 12px; "
-        "padding: 20px; "
+        "padding: 12px; "
         "font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;"
     );
     
     QString tabName = QString("💬 %1").arg(conversationKey);
-    conversationTabs->addTab(newConversation, tabName);
-    conversations[conversationKey] = newConversation;
+    conversationTabs->addTab(conversation.view, tabName);
+    Conversation* stored = &conversations.insert(conversationKey, conversation).value();
     
-    return newConversation;
+    // Page older messages in from the scrollback when the user reaches the top
+    QScrollBar* scrollBar = conversation.view->verticalScrollBar();
+    connect(scrollBar, &QScrollBar::valueChanged, this, [this, stored, scrollBar](int value) {
+        if (value == scrollBar->minimum() && stored->model->hasOlder()) {
+            fetchOlderMessages(stored);
+        }
+    });
+    conversation.view->scrollToBottom();
+    return stored;
 }
 
 void ChatWindow::setNodeId(const QString& nodeId) {
@@ -353,6 +377,14 @@ void ChatWindow::setNodeId(const QString& nodeId) {
     }
 }
 
+void ChatWindow::setAvailableNodes(const QStringList& nodeIds) {
+    QStringList destinations = nodeIds;
+    destinations.removeAll(currentNodeId);
+    
+    destinationCombo->clear();
+    destinationCombo->addItems(destinations);
+}
+
 QString ChatWindow::getSelectedDestination() const {
     return destinationCombo->currentText();
 }
@@ -9,7 +9,10 @@
 #include <QLabel>
 #include <QComboBox>
 #include <QTabWidget>
+#include <QListView>
 #include <QMap>
+#include "conversationmodel.h"
+#include "messagedelegate.h"
 
 class ChatWindow : public QWidget {
     Q_OBJECT
@@ -21,7 +24,16 @@ public:
     void appendMessageToConversation(const QString& nodeId, const QString& message);
     void appendSentMessage(const QString& nodeId, const QString& message);
     void appendReceivedMessage(const QString& nodeId, const QString& message);
+    void appendReceivedMessages(const QString& nodeId, const QStringList& messages);
+    // Reopens a conversation from an earlier run; entries only fill it if there is no scrollback
+    void restoreConversation(const QString& nodeId, const QVector<ConversationModel::Entry>& entries);
     void setNodeId(const QString& nodeId);
+    void setAvailableNodes(const QStringList& nodeIds);
+    
+    // Conversations keep historyRows messages in memory and the full history in
+    // per-peer scrollback logs under directory (no logs if it is empty)
+    void setScrollbackDirectory(const QString& directory) { scrollbackDirectory = directory; }
+    void setHistoryRows(int rows) { historyRows = rows; }
     QString getSelectedDestination() const;
 
 signals:
@@ -38,7 +50,14 @@ protected:
 
 private:
     void setupUI();
-    QTextEdit* getOrCreateConversation(const QString& nodeId);
+    struct Conversation {
+        QListView* view = nullptr;
+        ConversationModel* model = nullptr;
+    };
+    
+    Conversation* getOrCreateConversation(const QString& nodeId);
+    void appendToConversation(const QString& nodeId, const QVector<ConversationModel::Entry>& entries);
+    void fetchOlderMessages(Conversation* conversation);
     void updateInputVisibility();
     QString getCurrentTabDestination() const;
     
@@ -51,6 +70,9 @@ private:
     QWidget* inputContainer;
     QLabel* destLabel;
     QString currentNodeId;
-    QMap<QString, QTextEdit*> conversations;
+    MessageDelegate* messageDelegate;
+    QString scrollbackDirectory;
+    int historyRows;
+    QMap<QString, Conversation> conversations;
     QMap<QString, QString> tabToNodeMap;
 };
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "conversationmodel.h"
+#include "scrollbacklog.h"
+
+ConversationModel::ConversationModel(QObject* parent)
+    : QAbstractListModel(parent), windowRows(DefaultWindowRows), scrollback(nullptr), firstRecord(0) {}
+
+ConversationModel::~ConversationModel() {
+    delete scrollback;
+}
+
+bool ConversationModel::openScrollback(const QString& path) {
+    auto* log = new ScrollbackLog();
+    if (!log->open(path)) {
+        delete log;
+        return false;
+    }
+    delete scrollback;
+    scrollback = log;
+    
+    QVector<Entry> recent = scrollback->read(scrollback->count() - windowRows, windowRows);
+    beginResetModel();
+    rows.clear();
+    for (const Entry& entry : recent) {
+        Row row;
+        row.entry = entry;
+        rows.append(row);
+    }
+    firstRecord = scrollback->count() - rows.size();
+    endResetModel();
+    return true;
+}
+
+void ConversationModel::setWindowRows(int rows) {
+    windowRows = qMax(1, rows);
+}
+
+int ConversationModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant ConversationModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= rows.size()) {
+        return QVariant();
+    }
+    const Entry& entry = rows[index.row()].entry;
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.text;
+    case KindRole:
+        return int(entry.kind);
+    default:
+        return QVariant();
+    }
+}
+
+void ConversationModel::append(const QString& text, Kind kind) {
+    Entry entry;
+    entry.text = text;
+    entry.kind = kind;
+    append(QVector<Entry>{entry});
+}
+
+void ConversationModel::append(const QVector<Entry>& entries) {
+    if (entries.isEmpty()) {
+        return;
+    }
+    if (scrollback) {
+        scrollback->append(entries);
+    }
+    
+    // One insert notification for the whole batch
+    beginInsertRows(QModelIndex(), rows.size(), rows.size() + entries.size() - 1);
+    rows.reserve(rows.size() + entries.size());
+    for (const Entry& entry : entries) {
+        Row row;
+        row.entry = entry;
+        rows.append(row);
+    }
+    endInsertRows();
+    
+    // Hard bound for a view that is parked on old messages and not trimming
+    if (rows.size() > 2 * windowRows) {
+        trimTo(windowRows);
+    }
+}
+
+void ConversationModel::trimToWindow() {
+    trimTo(windowRows);
+}
+
+void ConversationModel::trimTo(int keep) {
+    int excess = rows.size() - keep;
+    if (excess <= 0) {
+        return;
+    }
+    beginRemoveRows(QModelIndex(), 0, excess - 1);
+    rows.remove(0, excess);
+    firstRecord += excess;
+    endRemoveRows();
+}
+
+bool ConversationModel::hasOlder() const {
+    return scrollback && firstRecord > 0;
+}
+
+int ConversationModel::fetchOlder(int count) {
+    if (!hasOlder() || count <= 0) {
+        return 0;
+    }
+    
+    int start = qMax(0, firstRecord - count);
+    QVector<Entry> older = scrollback->read(start, firstRecord - start);
+    if (older.isEmpty()) {
+        return 0;
+    }
+    
+    beginInsertRows(QModelIndex(), 0, older.size() - 1);
+    rows.insert(0, older.size(), Row());
+    for (int i = 0; i < older.size(); ++i) {
+        rows[i].entry = older[i];
+    }
+    firstRecord = start;
+    endInsertRows();
+    return older.size();
+}
+
+int ConversationModel::cachedHeight(int row, int width) const {
+    const Row& cached = rows[row];
+    return cached.measuredWidth == width ? cached.measuredHeight : -1;
+}
+
+void ConversationModel::cacheHeight(int row, int width, int height) const {
+    rows[row].measuredWidth = width;
+    rows[row].measuredHeight = height;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+class ScrollbackLog;
+
+// One conversation's messages as plain data: the text and which side sent
+// it. The delegate's measured row height is kept next to each row, so
+// relayouts only measure rows that are new or were measured at another
+// width.
+//
+// Only a window of the most recent rows is kept in memory. With a
+// scrollback log open, every message is also written to disk and rows
+// that fell out of the window are paged back in with fetchOlder().
+class ConversationModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Sent,
+        Received,
+        Note
+    };
+
+    enum Roles {
+        KindRole = Qt::UserRole + 1
+    };
+
+    struct Entry {
+        QString text;
+        Kind kind = Note;
+    };
+
+    static constexpr int DefaultWindowRows = 500;
+
+    explicit ConversationModel(QObject* parent = nullptr);
+    ~ConversationModel();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void append(const QString& text, Kind kind);
+    void append(const QVector<Entry>& entries);
+    const Entry& entry(int row) const { return rows[row].entry; }
+
+    // Loads the newest window of rows from an existing log, so history survives restarts
+    bool openScrollback(const QString& path);
+    void setWindowRows(int rows);
+    int getWindowRows() const { return windowRows; }
+
+    // Drops the oldest rows beyond the window. append() does this by itself
+    // only past twice the window, so rows paged in for reading stay put.
+    void trimToWindow();
+    bool hasOlder() const;
+    int fetchOlder(int count);
+
+    // -1 until the row has been measured at this width
+    int cachedHeight(int row, int width) const;
+    void cacheHeight(int row, int width, int height) const;
+
+private:
+    struct Row {
+        Entry entry;
+        mutable int measuredWidth = -1;
+        mutable int measuredHeight = 0;
+    };
+
+    void trimTo(int keep);
+
+    QVector<Row> rows;
+    int windowRows;
+    ScrollbackLog* scrollback;
+    int firstRecord; // scrollback record shown in row 0
+};
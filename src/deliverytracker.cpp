@@ -0,0 +1,49 @@
+#include "deliverytracker.h"
+
+DeliveryTracker::DeliveryTracker() : sent(0), acknowledged(0), lost(0), expired(0) {}
+
+void DeliveryTracker::messageSent(int sequence, qint64 nowUsec) {
+    if (outstanding.size() >= MaxOutstanding) {
+        outstanding.erase(outstanding.begin());
+        ++expired;
+    }
+    outstanding.insert(sequence, nowUsec);
+    ++sent;
+}
+
+int DeliveryTracker::acknowledge(int cumulative, qint64 nowUsec, qint64 oneWayUsec,
+                                 const QVector<SequenceRange>& skipped) {
+    for (const SequenceRange& range : skipped) {
+        auto it = outstanding.lowerBound(range.first);
+        while (it != outstanding.end() && it.key() - range.first < range.length && it.key() <= cumulative) {
+            it = outstanding.erase(it);
+            ++lost;
+        }
+    }
+
+    int settled = 0;
+    auto it = outstanding.begin();
+    while (it != outstanding.end() && it.key() <= cumulative) {
+        roundTripLatency.record(quint64(qMax<qint64>(0, nowUsec - it.value())));
+        it = outstanding.erase(it);
+        ++settled;
+    }
+    acknowledged += settled;
+
+    if (settled > 0 && oneWayUsec >= 0) {
+        oneWayLatency.record(quint64(oneWayUsec));
+    }
+    return settled;
+}
+
+DeliveryTracker::Stats DeliveryTracker::stats() const {
+    Stats stats;
+    stats.sent = sent;
+    stats.acknowledged = acknowledged;
+    stats.lost = lost;
+    stats.expired = expired;
+    stats.outstanding = outstanding.size();
+    stats.roundTrip = roundTripLatency.snapshot();
+    stats.oneWay = oneWayLatency.snapshot();
+    return stats;
+}
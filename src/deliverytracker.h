@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QMap>
+#include <QVector>
+#include "latencyhistogram.h"
+#include "message.h"
+
+// Outstanding messages to one destination and the latency of the ones it
+// acknowledged. ACKs are cumulative, so one ACK settles every outstanding
+// sequence number up to it, and each of those contributes a round-trip
+// sample. One-way samples come from the destination, which measures them
+// against the send timestamp carried in the frame. Sequence numbers the
+// destination gave up waiting for come with the ACK as skipped ranges and
+// are counted as lost, without a latency sample.
+class DeliveryTracker {
+public:
+    // Messages never acknowledged are forgotten once this many are outstanding
+    static constexpr int MaxOutstanding = 4096;
+
+    struct Stats {
+        quint64 sent = 0;
+        quint64 acknowledged = 0;
+        quint64 lost = 0;
+        quint64 expired = 0;
+        int outstanding = 0;
+        LatencyHistogram::Snapshot roundTrip; // microseconds
+        LatencyHistogram::Snapshot oneWay;    // microseconds
+    };
+
+    DeliveryTracker();
+
+    void messageSent(int sequence, qint64 nowUsec);
+
+    // Returns how many outstanding messages the ACK settled as delivered; oneWayUsec < 0 means none was measured
+    int acknowledge(int cumulative, qint64 nowUsec, qint64 oneWayUsec = -1,
+                    const QVector<SequenceRange>& skipped = QVector<SequenceRange>());
+
+    int outstandingCount() const { return outstanding.size(); }
+    const LatencyHistogram& roundTrip() const { return roundTripLatency; }
+    const LatencyHistogram& oneWay() const { return oneWayLatency; }
+    Stats stats() const;
+
+private:
+    QMap<int, qint64> outstanding; // sequence -> send time
+    quint64 sent;
+    quint64 acknowledged;
+    quint64 lost;
+    quint64 expired;
+    LatencyHistogram roundTripLatency; // microseconds
+    LatencyHistogram oneWayLatency;    // microseconds
+};
@@ -0,0 +1,457 @@
+#include "epolltransport.h"
+#include <QDebug>
+#include <QMetaObject>
+#include <QTimer>
+#include "posixsocket.h"
+#include "receivebuffer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Reads ask for at least this much room in the receive buffer; anything
+// beyond it lands in a stack area and is appended after the read
+static const int MinReadRoom = 16 * 1024;
+static const int OverflowBytes = 64 * 1024;
+
+static QString errnoString() {
+    return PosixSocket::errorString(errno);
+}
+
+EpollConnection::EpollConnection(EpollTransport* transport, QObject* parent)
+    : Connection(parent), transport(transport), id(0), fd(-1), state(Unconnected),
+      interest(0), peerClosed(false), pendingPos(0) {}
+
+EpollConnection::EpollConnection(EpollTransport* transport, int fd, const QString& peer, QObject* parent)
+    : Connection(parent), transport(transport), id(0), fd(fd), state(Connected), peer(peer),
+      interest(EPOLLIN | EPOLLRDHUP), peerClosed(false), pendingPos(0) {
+    PosixSocket::setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    id = transport->watch(this, fd, interest);
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+EpollConnection::~EpollConnection() {
+    closeSocket();
+}
+
+void EpollConnection::connectToHost(const QString& host, quint16 port) {
+    closeSocket();
+    if (!transport) {
+        fail("Transport is gone");
+        return;
+    }
+
+    QHostAddress address;
+    QString resolveError;
+    if (!PosixSocket::resolve(host, address, resolveError)) {
+        fail(resolveError);
+        return;
+    }
+
+    sockaddr_storage storage;
+    socklen_t length;
+    if (!PosixSocket::toSockaddr(address, port, storage, length)) {
+        fail(QString("Unsupported address %1").arg(address.toString()));
+        return;
+    }
+
+    fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fail(errnoString());
+        return;
+    }
+    PosixSocket::setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    peer = address.toString();
+
+    // Even an immediate success is reported through EPOLLOUT, so connected() is never emitted from here
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0 && errno != EINPROGRESS) {
+        fail(errnoString());
+        return;
+    }
+    state = Connecting;
+    interest = EPOLLOUT;
+    id = transport->watch(this, fd, interest);
+}
+
+void EpollConnection::disconnectFromHost() {
+    if (state == Unconnected || state == Closing) {
+        return;
+    }
+    bool wasConnected = state == Connected;
+    if (wasConnected) {
+        flushPending();
+        if (state != Connected) {
+            return; // failed, and already reported
+        }
+        if (pendingPos < pending.size() && transport) {
+            // The rest goes out as the socket drains; reading stops meanwhile
+            state = Closing;
+            updateInterest();
+            quint64 closingId = id;
+            QTimer::singleShot(CloseTimeoutMsec, this, [this, closingId]() {
+                if (state == Closing && id == closingId) {
+                    finishClose();
+                }
+            });
+            return;
+        }
+    }
+    closeSocket();
+    if (wasConnected) {
+        emit disconnected();
+    }
+}
+
+void EpollConnection::finishClose() {
+    closeSocket();
+    emit disconnected();
+}
+
+void EpollConnection::handleEvents(quint32 events) {
+    if (state == Connecting) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            finishConnect();
+        }
+        return;
+    }
+    if (state != Connected && state != Closing) {
+        return;
+    }
+
+    if (events & EPOLLERR) {
+        int socketError = 0;
+        socklen_t length = sizeof(socketError);
+        ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &socketError, &length);
+        fail(QString::fromLocal8Bit(std::strerror(socketError)));
+        return;
+    }
+
+    if (events & EPOLLOUT) {
+        qint64 written = flushPending();
+        if (state == Closing && pendingPos == pending.size()) {
+            finishClose();
+            return;
+        }
+        if (state != Connected && state != Closing) {
+            return;
+        }
+        if (written > 0) {
+            emit bytesWritten(written);
+        }
+    }
+    if (state == Closing) {
+        if (events & EPOLLHUP) {
+            finishClose(); // nothing more can be sent
+        }
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        // The reader calls readInto(); end of stream is only acted on once it has had the data
+        emit readyRead();
+        if (state != Connected) {
+            return;
+        }
+        if (peerClosed) {
+            closeSocket();
+            emit disconnected();
+        }
+    }
+}
+
+void EpollConnection::finishConnect() {
+    int socketError = 0;
+    socklen_t length = sizeof(socketError);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &socketError, &length) < 0) {
+        socketError = errno;
+    }
+    if (socketError != 0) {
+        fail(QString::fromLocal8Bit(std::strerror(socketError)));
+        return;
+    }
+
+    state = Connected;
+    peerClosed = false;
+    updateInterest();
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    emit connected();
+}
+
+qint64 EpollConnection::readInto(ReceiveBuffer& buffer) {
+    if (state != Connected) {
+        return 0;
+    }
+
+    char overflow[OverflowBytes];
+    int room;
+    char* tail = buffer.prepareWrite(MinReadRoom, room);
+    iovec vectors[2] = {{tail, size_t(room)}, {overflow, sizeof(overflow)}};
+
+    ssize_t bytesRead = ::readv(fd, vectors, 2);
+    if (bytesRead > 0) {
+        int direct = int(qMin<ssize_t>(bytesRead, room));
+        buffer.commitWrite(direct);
+        if (bytesRead > direct) {
+            buffer.append(overflow, int(bytesRead - direct));
+        }
+        PosixSocket::setOption(fd, IPPROTO_TCP, TCP_QUICKACK, 1);
+        return bytesRead;
+    }
+    if (bytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        if (bytesRead < 0) {
+            setErrorString(errnoString());
+        }
+        peerClosed = true;
+    }
+    return 0;
+}
+
+qint64 EpollConnection::bytesAvailable() const {
+    int available = 0;
+    if (fd >= 0) {
+        ::ioctl(fd, FIONREAD, &available);
+    }
+    return available;
+}
+
+qint64 EpollConnection::readData(char* data, qint64 maxSize) {
+    if (state != Connected) {
+        return -1;
+    }
+    ssize_t bytesRead = ::read(fd, data, size_t(maxSize));
+    if (bytesRead > 0) {
+        return bytesRead;
+    }
+    if (bytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        peerClosed = true;
+    }
+    return 0;
+}
+
+qint64 EpollConnection::writeData(const char* data, qint64 size) {
+    if (state != Connected) {
+        return -1;
+    }
+
+    ssize_t written;
+    if (pendingPos == pending.size()) {
+        written = ::send(fd, data, size_t(size), MSG_NOSIGNAL);
+    } else {
+        // Older bytes go first, in the same system call
+        iovec vectors[2] = {{pending.data() + pendingPos, size_t(pending.size() - pendingPos)},
+                            {const_cast<char*>(data), size_t(size)}};
+        written = ::writev(fd, vectors, 2);
+    }
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            // Reported from the event loop, so callers in the middle of a write never see the connection go
+            setErrorString(errnoString());
+            QMetaObject::invokeMethod(this, [this]() { fail(errorString()); }, Qt::QueuedConnection);
+            return size;
+        }
+        written = 0;
+    }
+
+    qint64 fromPending = qMin<qint64>(written, pending.size() - pendingPos);
+    consumePending(fromPending);
+    qint64 fromData = written - fromPending;
+    if (fromData < size) {
+        pending.append(data + fromData, int(size - fromData));
+    }
+    updateInterest();
+    return size;
+}
+
+qint64 EpollConnection::flushPending() {
+    if (pendingPos == pending.size()) {
+        return 0;
+    }
+    ssize_t written = ::send(fd, pending.constData() + pendingPos, size_t(pending.size() - pendingPos), MSG_NOSIGNAL);
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            fail(errnoString());
+        }
+        return 0;
+    }
+    consumePending(written);
+    updateInterest();
+    return written;
+}
+
+void EpollConnection::consumePending(qint64 bytes) {
+    pendingPos += int(bytes);
+    if (pendingPos == pending.size()) {
+        // resize() keeps the allocation for the next backlog
+        pending.resize(0);
+        pendingPos = 0;
+    } else if (pendingPos > pending.size() / 2) {
+        pending.remove(0, pendingPos);
+        pendingPos = 0;
+    }
+}
+
+void EpollConnection::updateInterest() {
+    if (fd < 0 || !transport) {
+        return;
+    }
+    quint32 wanted = state == Closing ? 0 : EPOLLIN | EPOLLRDHUP;
+    if (pendingPos < pending.size()) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted != interest) {
+        interest = wanted;
+        transport->rewatch(fd, id, interest);
+    }
+}
+
+void EpollConnection::fail(const QString& error) {
+    bool wasConnected = state == Connected || state == Closing;
+    setErrorString(error);
+    closeSocket();
+    emit errorOccurred();
+    if (wasConnected) {
+        emit disconnected();
+    }
+}
+
+void EpollConnection::closeSocket() {
+    if (fd >= 0) {
+        if (transport) {
+            transport->unwatch(fd, id);
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    id = 0;
+    state = Unconnected;
+    interest = 0;
+    peerClosed = false;
+    pending.resize(0);
+    pendingPos = 0;
+    if (isOpen()) {
+        close();
+    }
+}
+
+EpollTransport::EpollTransport(QObject* parent) : Transport(parent), listenFd(-1), notifier(nullptr), nextId(ListenId + 1) {
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        error = errnoString();
+        qDebug() << "epoll_create1 failed:" << error;
+        return;
+    }
+    notifier = new QSocketNotifier(epollFd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &EpollTransport::onEpollReadable);
+}
+
+EpollTransport::~EpollTransport() {
+    close();
+    // Connections still around (owned elsewhere) stop using the epoll set from here on
+    for (EpollConnection* connection : connections) {
+        connection->transport = nullptr;
+    }
+    if (epollFd >= 0) {
+        ::close(epollFd);
+    }
+}
+
+bool EpollTransport::listen(const QHostAddress& address, quint16 port) {
+    close();
+    if (epollFd < 0) {
+        return false;
+    }
+
+    listenFd = PosixSocket::listen(address, port, SOCK_NONBLOCK, error);
+    if (listenFd < 0) {
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = ListenId;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) < 0) {
+        error = errnoString();
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void EpollTransport::close() {
+    if (listenFd >= 0) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+        ::close(listenFd);
+        listenFd = -1;
+    }
+}
+
+quint64 EpollTransport::watch(EpollConnection* connection, int fd, quint32 events) {
+    // 64 bits never wrap, so an id is never handed out twice
+    quint64 id = nextId++;
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = id;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        qDebug() << "epoll_ctl add failed:" << errnoString();
+        return 0;
+    }
+    connections.insert(id, connection);
+    return id;
+}
+
+bool EpollTransport::rewatch(int fd, quint64 id, quint32 events) {
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = id;
+    return ::epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void EpollTransport::unwatch(int fd, quint64 id) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    connections.remove(id);
+}
+
+void EpollTransport::onEpollReadable() {
+    epoll_event events[MaxEvents];
+    int count;
+    do {
+        count = ::epoll_wait(epollFd, events, MaxEvents, 0);
+        for (int i = 0; i < count; ++i) {
+            quint64 id = events[i].data.u64;
+            if (id == ListenId) {
+                if (listenFd >= 0) {
+                    acceptPending();
+                }
+                continue;
+            }
+            // Looked up per event: an earlier handler may have closed this connection, and its
+            // descriptor may already belong to a new one
+            if (EpollConnection* connection = connections.value(id, nullptr)) {
+                connection->handleEvents(events[i].events);
+            }
+        }
+    } while (count == MaxEvents);
+}
+
+void EpollTransport::acceptPending() {
+    for (;;) {
+        sockaddr_storage storage;
+        socklen_t length = sizeof(storage);
+        int fd = ::accept4(listenFd, reinterpret_cast<sockaddr*>(&storage), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                qDebug() << "accept failed:" << errnoString();
+            }
+            return;
+        }
+        QHostAddress peer(reinterpret_cast<sockaddr*>(&storage));
+        emit newConnection(new EpollConnection(this, fd, peer.toString(), this));
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QPointer>
+#include <QSocketNotifier>
+#include "transport.h"
+
+class EpollTransport;
+
+// Non-blocking TCP socket driven by an EpollTransport. Reads go straight
+// into the ReceiveBuffer with one readv() (buffer tail plus a stack
+// overflow area), writes go straight to the kernel, and whatever it does
+// not take waits in one pending buffer that is sent with writev() ahead of
+// the next write. TCP_NODELAY is always on and TCP_QUICKACK is re-armed
+// after every read, since the kernel clears it. disconnectFromHost() keeps
+// the socket open until the pending buffer has been sent.
+class EpollConnection : public Connection {
+    Q_OBJECT
+
+public:
+    EpollConnection(EpollTransport* transport, QObject* parent = nullptr);
+    // Takes over an accepted, connected socket
+    EpollConnection(EpollTransport* transport, int fd, const QString& peer, QObject* parent = nullptr);
+    ~EpollConnection() override;
+
+    void connectToHost(const QString& host, quint16 port) override;
+    void disconnectFromHost() override;
+    bool isConnected() const override { return state == Connected; }
+    QString peerAddress() const override { return peer; }
+    qint64 readInto(ReceiveBuffer& buffer) override;
+
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override { return pending.size() - pendingPos; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+private:
+    friend class EpollTransport;
+
+    enum State {
+        Unconnected,
+        Connecting,
+        Connected,
+        Closing // sending what is pending before closing
+    };
+
+    void handleEvents(quint32 events);
+    void finishConnect();
+    qint64 flushPending();
+    void consumePending(qint64 bytes);
+    void updateInterest();
+    void finishClose();
+    void fail(const QString& error);
+    void closeSocket();
+
+    QPointer<EpollTransport> transport;
+    quint64 id; // changes with every socket, so events for an old one are ignored
+    int fd;
+    State state;
+    QString peer;
+    quint32 interest;
+    bool peerClosed;
+    QByteArray pending;
+    int pendingPos;
+};
+
+// Linux backend: one epoll instance per transport, watched by a single
+// QSocketNotifier, so any number of connections cost the Qt event loop one
+// file descriptor and each wakeup dispatches up to MaxEvents of them.
+class EpollTransport : public Transport {
+    Q_OBJECT
+
+public:
+    static constexpr int MaxEvents = 64;
+
+    explicit EpollTransport(QObject* parent = nullptr);
+    ~EpollTransport() override;
+
+    Backend backend() const override { return Epoll; }
+    bool listen(const QHostAddress& address, quint16 port) override;
+    void close() override;
+    QString errorString() const override { return error; }
+    Connection* createConnection(QObject* parent = nullptr) override { return new EpollConnection(this, parent); }
+
+private slots:
+    void onEpollReadable();
+
+private:
+    friend class EpollConnection;
+
+    // Events carry the connection id rather than the descriptor, which the kernel reuses
+    static constexpr quint64 ListenId = 0;
+
+    quint64 watch(EpollConnection* connection, int fd, quint32 events); // the id, or 0 on failure
+    bool rewatch(int fd, quint64 id, quint32 events);
+    void unwatch(int fd, quint64 id);
+    void acceptPending();
+
+    int epollFd;
+    int listenFd;
+    QSocketNotifier* notifier;
+    quint64 nextId;
+    QHash<quint64, EpollConnection*> connections; // id -> connection
+    QString error;
+};
@@ -0,0 +1,102 @@
+#include "framebatcher.h"
+#include <QtEndian>
+
+static const int PrefixSize = 4;
+
+FrameBatcher::FrameBatcher(QObject* parent)
+    : QObject(parent), frameStart(-1), batchFrames(0),
+      windowUsec(0), maxBatchBytes(DefaultMaxBatchBytes) {
+
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setTimerType(Qt::PreciseTimer);
+    connect(flushTimer, &QTimer::timeout, this, &FrameBatcher::flush);
+}
+
+void FrameBatcher::setDevice(QIODevice* device) {
+    this->device = device;
+}
+
+void FrameBatcher::setWindowUsec(int usec) {
+    windowUsec = qMax(0, usec);
+}
+
+void FrameBatcher::setMaxBatchBytes(int bytes) {
+    maxBatchBytes = qMax(PrefixSize, bytes);
+}
+
+QByteArray& FrameBatcher::beginFrame() {
+    frameStart = batch.size();
+    batch.append(PrefixSize, '\0');
+    return batch;
+}
+
+void FrameBatcher::endFrame() {
+    if (frameStart < 0) {
+        return;
+    }
+    quint32 bodySize = quint32(batch.size() - frameStart - PrefixSize);
+    qToBigEndian(bodySize, batch.data() + frameStart);
+    frameStart = -1;
+    frameAdded();
+}
+
+void FrameBatcher::enqueue(const char* data, int size) {
+    char prefix[PrefixSize];
+    qToBigEndian(quint32(size), prefix);
+    batch.append(prefix, PrefixSize);
+    batch.append(data, size);
+    frameAdded();
+}
+
+void FrameBatcher::frameAdded() {
+    ++batchFrames;
+
+    if (batch.size() >= maxBatchBytes) {
+        flush();
+    } else if (!flushTimer->isActive()) {
+        // QTimer has millisecond resolution, so sub-millisecond windows round up
+        flushTimer->start((windowUsec + 999) / 1000);
+    }
+}
+
+void FrameBatcher::flush() {
+    flushTimer->stop();
+    if (batch.isEmpty() || !device || !device->isOpen()) {
+        return;
+    }
+
+    device->write(batch.constData(), batch.size());
+
+    int frames = batchFrames;
+    int bytes = batch.size();
+    totals.batches++;
+    totals.frames += frames;
+    totals.bytes += bytes;
+    totals.largestBatchFrames = qMax(totals.largestBatchFrames, frames);
+
+    // resize() keeps the allocation around for the next batch
+    batch.resize(0);
+    batchFrames = 0;
+    emit batchFlushed(frames, bytes);
+}
+
+QList<QByteArray> FrameBatcher::takeFrames() {
+    QList<QByteArray> frames;
+    int end = frameStart >= 0 ? frameStart : batch.size();
+    int offset = 0;
+    while (offset + PrefixSize <= end) {
+        int size = int(qFromBigEndian<quint32>(batch.constData() + offset));
+        frames.append(batch.mid(offset + PrefixSize, size));
+        offset += PrefixSize + size;
+    }
+    discard();
+    return frames;
+}
+
+void FrameBatcher::discard() {
+    flushTimer->stop();
+    batch.resize(0);
+    batchFrames = 0;
+    frameStart = -1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+// Coalesces outgoing frames for one link into a single contiguous buffer
+// (length prefix followed by body, back to back) and hands it to the
+// connection with one write() per batch. A batch is flushed when the byte
+// threshold is reached or when the batching window expires; a window of 0
+// flushes at the end of the current event-loop turn.
+class FrameBatcher : public QObject {
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 batches = 0;
+        quint64 frames = 0;
+        quint64 bytes = 0;
+        int largestBatchFrames = 0;
+    };
+
+    static constexpr int DefaultMaxBatchBytes = 64 * 1024;
+
+    explicit FrameBatcher(QObject* parent = nullptr);
+
+    void setDevice(QIODevice* device);
+    void setWindowUsec(int usec);
+    void setMaxBatchBytes(int bytes);
+    int getWindowUsec() const { return windowUsec; }
+    int getMaxBatchBytes() const { return maxBatchBytes; }
+
+    // Encode straight into the batch: beginFrame() reserves the length prefix and
+    // returns the buffer to append the body to, endFrame() fills the prefix in.
+    QByteArray& beginFrame();
+    void endFrame();
+    void enqueue(const char* data, int size);
+
+    void flush();
+    void discard();
+    // Empties the batch and returns the bodies of the frames in it, oldest first;
+    // a frame still between beginFrame() and endFrame() is dropped
+    QList<QByteArray> takeFrames();
+    int pendingFrames() const { return batchFrames; }
+    int pendingBytes() const { return batch.size(); }
+    const Stats& stats() const { return totals; }
+
+signals:
+    void batchFlushed(int frames, int bytes);
+
+private:
+    void frameAdded();
+
+    QPointer<QIODevice> device;
+    QByteArray batch;
+    int frameStart;
+    int batchFrames;
+    int windowUsec;
+    int maxBatchBytes;
+    QTimer* flushTimer;
+    Stats totals;
+};
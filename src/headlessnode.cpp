@@ -0,0 +1,138 @@
+#include "headlessnode.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <unistd.h>
+
+HeadlessNode::HeadlessNode(const RingConfig& ring, int selfIndex, QObject* parent)
+    : QObject(parent), stdinNotifier(nullptr), out(stdout), ring(ring), self(ring.member(selfIndex)) {
+    
+    nodeId = self.nodeId;
+    listenAddress = self.listenAddress();
+    
+    // Without a UI thread to protect, the network manager simply runs on the main thread
+    networkManager = new NetworkManager(this);
+    networkManager->setNodeId(nodeId);
+    networkManager->setOutboundQueueDirectory(OutboundQueue::defaultStorageDirectory());
+    
+    connect(networkManager, &NetworkManager::messageReceived, this, &HeadlessNode::onMessageReceived);
+    connect(networkManager, &NetworkManager::connectionEstablished, this, &HeadlessNode::onConnectionEstablished);
+    connect(networkManager, &NetworkManager::connectionLost, this, &HeadlessNode::onConnectionLost);
+    connect(networkManager, &NetworkManager::sendRejected, this, &HeadlessNode::onSendRejected);
+}
+
+bool HeadlessNode::start() {
+    if (!networkManager->startServer(self.port, listenAddress)) {
+        emitEvent(QString("error failed to start server on port %1").arg(self.port));
+        return false;
+    }
+    networkManager->setRingTopology(ring);
+    
+    stdinNotifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+    connect(stdinNotifier, &QSocketNotifier::activated, this, &HeadlessNode::onStdinReadable);
+    
+    emitEvent(QString("ready %1 %2").arg(nodeId).arg(self.port));
+    return true;
+}
+
+void HeadlessNode::onStdinReadable() {
+    char chunk[4096];
+    ssize_t bytesRead = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+    if (bytesRead <= 0) {
+        // A relay started with stdin closed keeps running; only the command channel goes away
+        stdinNotifier->setEnabled(false);
+        qDebug() << "stdin closed, no further commands will be read";
+        return;
+    }
+    stdinBuffer.append(chunk, int(bytesRead));
+    
+    int lineStart = 0;
+    int newline;
+    while ((newline = stdinBuffer.indexOf('\n', lineStart)) != -1) {
+        processCommand(QString::fromUtf8(stdinBuffer.constData() + lineStart, newline - lineStart).trimmed());
+        lineStart = newline + 1;
+    }
+    stdinBuffer.remove(0, lineStart);
+}
+
+void HeadlessNode::processCommand(const QString& line) {
+    if (line.isEmpty()) {
+        return;
+    }
+    
+    QString command = line.section(' ', 0, 0);
+    if (command == "send") {
+        QString destination = line.section(' ', 1, 1);
+        QString text = unescapeText(line.section(' ', 2));
+        if (destination.isEmpty() || text.isEmpty()) {
+            emitEvent("error usage: send <destination> <text>");
+            return;
+        }
+        // Placeholder sequence number; NetworkManager assigns the real one
+        networkManager->sendMessage(Message(text, nodeId, destination, 1));
+    } else if (command == "stats") {
+        const FrameBatcher::Stats& stats = networkManager->getBatchStats();
+        emitEvent(QString("stats queued=%1 batches=%2 frames=%3 bytes=%4")
+                  .arg(networkManager->getOutboundQueueSize())
+                  .arg(stats.batches).arg(stats.frames).arg(stats.bytes));
+        
+        const QMap<QString, DeliveryTracker::Stats> deliveries = networkManager->getDeliveryStats();
+        for (auto it = deliveries.constBegin(); it != deliveries.constEnd(); ++it) {
+            const DeliveryTracker::Stats& delivery = it.value();
+            emitEvent(QString("delivery %1 sent=%2 acked=%3 lost=%4 outstanding=%5 rtt_p50_us=%6 rtt_p99_us=%7 "
+                              "rtt_max_us=%8 oneway_p50_us=%9 oneway_p99_us=%10")
+                      .arg(it.key()).arg(delivery.sent).arg(delivery.acknowledged).arg(delivery.lost)
+                      .arg(delivery.outstanding)
+                      .arg(delivery.roundTrip.percentile(0.5)).arg(delivery.roundTrip.percentile(0.99))
+                      .arg(delivery.roundTrip.max)
+                      .arg(delivery.oneWay.percentile(0.5)).arg(delivery.oneWay.percentile(0.99)));
+        }
+    } else if (command == "quit") {
+        QCoreApplication::quit();
+    } else {
+        emitEvent(QString("error unknown command %1").arg(command));
+    }
+}
+
+void HeadlessNode::onMessageReceived(const Message& message) {
+    emitEvent(QString("recv %1 %2 %3").arg(message.getOrigin())
+              .arg(message.getSequenceNumber())
+              .arg(escapeText(message.getChatText())));
+}
+
+void HeadlessNode::onConnectionEstablished(const QString& peerId) {
+    emitEvent("connected " + peerId);
+}
+
+void HeadlessNode::onConnectionLost(const QString& peerId) {
+    emitEvent("disconnected " + peerId);
+}
+
+void HeadlessNode::onSendRejected(const Message& message) {
+    emitEvent(QString("rejected %1 %2").arg(message.getDestination()).arg(message.getSequenceNumber()));
+}
+
+void HeadlessNode::emitEvent(const QString& event) {
+    // Flushed per line so a driving process sees each event as it happens
+    out << event << Qt::endl;
+}
+
+QString HeadlessNode::escapeText(const QString& text) {
+    QString escaped = text;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+QString HeadlessNode::unescapeText(const QString& text) {
+    QString unescaped;
+    unescaped.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            ++i;
+            unescaped.append(text[i] == 'n' ? QChar('\n') : text[i]);
+        } else {
+            unescaped.append(text[i]);
+        }
+    }
+    return unescaped;
+}
\ No newline at end of file
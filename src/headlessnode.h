@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include "networkmanager.h"
+#include "ringconfig.h"
+#include "message.h"
+
+// A node without the widget stack: only the NetworkManager runs, and chat
+// traffic is injected and observed as text lines on stdin/stdout.
+//
+// Commands (stdin):  send <destination> <text> | stats | quit
+// Events (stdout):   ready <node> <port> | connected <peer> | disconnected <peer> |
+//                    recv <origin> <sequence> <text> | rejected <destination> <sequence> |
+//                    stats queued=<n> batches=<n> frames=<n> bytes=<n> |
+//                    delivery <destination> sent=<n> acked=<n> outstanding=<n> rtt_p50_us=<n> ... |
+//                    error <reason>
+//
+// Newlines and backslashes in message text are escaped as \n and \\.
+// Logging stays on stderr so stdout carries nothing but events.
+class HeadlessNode : public QObject {
+    Q_OBJECT
+
+public:
+    HeadlessNode(const RingConfig& ring, int selfIndex, QObject* parent = nullptr);
+    
+    // Defaults to the member's listenAddress()
+    void setListenAddress(const QHostAddress& address) { listenAddress = address; }
+    bool start();
+    NetworkManager* getNetworkManager() const { return networkManager; }
+
+private slots:
+    void onStdinReadable();
+    void onMessageReceived(const Message& message);
+    void onConnectionEstablished(const QString& peerId);
+    void onConnectionLost(const QString& peerId);
+    void onSendRejected(const Message& message);
+
+private:
+    void processCommand(const QString& line);
+    void emitEvent(const QString& event);
+    static QString escapeText(const QString& text);
+    static QString unescapeText(const QString& text);
+    
+    NetworkManager* networkManager;
+    QSocketNotifier* stdinNotifier;
+    QByteArray stdinBuffer;
+    QTextStream out;
+    RingConfig ring;
+    RingMember self;
+    QHostAddress listenAddress;
+    QString nodeId;
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "latencyhistogram.h"
+#include <QtAlgorithms>
+
+LatencyHistogram::LatencyHistogram() : samples(0), total(0), maximum(0) {
+    for (QAtomicInteger<quint64>& bucket : buckets) {
+        bucket.storeRelaxed(0);
+    }
+}
+
+int LatencyHistogram::bucketFor(quint64 value) {
+    if (value < SubBuckets) {
+        return int(value);
+    }
+    // The top three bits pick the sub-bucket within the value's power of two
+    int shift = 63 - int(qCountLeadingZeroBits(value)) - 3;
+    int bucket = (shift + 1) * SubBuckets + int((value >> shift) & (SubBuckets - 1));
+    return qMin(bucket, BucketCount - 1);
+}
+
+quint64 LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SubBuckets) {
+        return quint64(bucket);
+    }
+    int shift = bucket / SubBuckets - 1;
+    quint64 lower = quint64(SubBuckets + bucket % SubBuckets) << shift;
+    return lower + (quint64(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(quint64 value) {
+    buckets[bucketFor(value)].fetchAndAddRelaxed(1);
+    samples.fetchAndAddRelaxed(1);
+    total.fetchAndAddRelaxed(value);
+
+    quint64 current = maximum.loadRelaxed();
+    while (value > current && !maximum.testAndSetRelaxed(current, value, current)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    // Counters are read one by one, so a snapshot taken mid-record may be off by that sample
+    Snapshot snapshot;
+    snapshot.buckets.resize(BucketCount);
+    for (int i = 0; i < BucketCount; ++i) {
+        quint64 value = buckets[i].loadRelaxed();
+        snapshot.buckets[i] = value;
+        snapshot.count += value;
+    }
+    snapshot.total = total.loadRelaxed();
+    snapshot.max = maximum.loadRelaxed();
+    return snapshot;
+}
+
+quint64 LatencyHistogram::Snapshot::percentile(double fraction) const {
+    if (count == 0) {
+        return 0;
+    }
+    quint64 target = qMax<quint64>(1, quint64(fraction * double(count) + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return qMin(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QVector>
+
+// Latency distribution that one thread can record into while another reads
+// it: every counter is an atomic, so neither side takes a lock. Values are
+// in whatever unit the owner records (the owning field's name says which).
+// Buckets are log-linear: values below 8 are exact, and each power of two
+// above is split into 8 linear sub-buckets, which keeps the error within
+// 12.5% of the value at any magnitude.
+class LatencyHistogram {
+public:
+    static constexpr int SubBuckets = 8;
+    static constexpr int BucketCount = 48 * SubBuckets;
+
+    struct Snapshot {
+        quint64 count = 0;
+        quint64 total = 0;
+        quint64 max = 0;
+        QVector<quint64> buckets;
+
+        quint64 mean() const { return count ? total / count : 0; }
+        // Upper bound of the bucket holding the given fraction (0..1) of samples
+        quint64 percentile(double fraction) const;
+    };
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(quint64 value);
+    Snapshot snapshot() const;
+    quint64 count() const { return samples.loadRelaxed(); }
+
+    static int bucketFor(quint64 value);
+    static quint64 bucketUpperBound(int bucket);
+
+private:
+    QAtomicInteger<quint64> buckets[BucketCount];
+    QAtomicInteger<quint64> samples;
+    QAtomicInteger<quint64> total;
+    QAtomicInteger<quint64> maximum;
+};
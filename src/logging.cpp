@@ -0,0 +1,273 @@
+#include "logging.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Bounded multi-producer ring (Vyukov): every cell carries a sequence number
+// that says whose turn it is, so producers claim cells with one CAS and the
+// consumer never blocks them
+class LogRing {
+public:
+    static constexpr quint64 Capacity = 4096; // power of two
+
+    LogRing() : head(0), tail(0) {
+        for (quint64 i = 0; i < Capacity; ++i) {
+            cells[i].sequence.storeRelaxed(i);
+        }
+    }
+
+    bool push(const LogRecord& record) {
+        quint64 position = head.loadRelaxed();
+        for (;;) {
+            Cell& cell = cells[position & (Capacity - 1)];
+            qint64 lag = qint64(cell.sequence.loadAcquire()) - qint64(position);
+            if (lag == 0) {
+                if (head.testAndSetRelaxed(position, position + 1, position)) {
+                    cell.record = record;
+                    cell.sequence.storeRelease(position + 1);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false; // full
+            } else {
+                position = head.loadRelaxed();
+            }
+        }
+    }
+
+    // Single consumer
+    bool pop(LogRecord& record) {
+        Cell& cell = cells[tail & (Capacity - 1)];
+        if (cell.sequence.loadAcquire() != tail + 1) {
+            return false;
+        }
+        record = cell.record;
+        cell.sequence.storeRelease(tail + Capacity);
+        ++tail;
+        return true;
+    }
+
+private:
+    struct Cell {
+        QAtomicInteger<quint64> sequence;
+        LogRecord record;
+    };
+
+    Cell cells[Capacity];
+    QAtomicInteger<quint64> head;
+    quint64 tail;
+};
+
+// Owns the ring and the thread that formats and prints it. The thread sleeps
+// on a condition variable while the ring is empty; writers only take the
+// mutex to wake it when it has said it is sleeping.
+class LogSink {
+public:
+    static LogSink& instance() {
+        static LogSink sink;
+        return sink;
+    }
+
+    ~LogSink() {
+        stopping.storeRelease(1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake.notify_one();
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void write(const LogRecord& record) {
+        std::call_once(started, [this]() { worker = std::thread([this]() { run(); }); });
+        if (!ring.push(record)) {
+            dropped.fetchAndAddRelaxed(1);
+            return;
+        }
+        queued.fetchAndAddRelease(1);
+        // Pairs with the fence in run(): either the worker sees this record or this sees it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake.notify_one();
+        }
+    }
+
+    void flush() {
+        quint64 target = queued.loadAcquire();
+        std::unique_lock<std::mutex> lock(mutex);
+        printedAll.wait(lock, [this, target]() { return printed.loadAcquire() >= target; });
+    }
+
+    qint64 elapsedUsec() const { return clock.nsecsElapsed() / 1000; }
+    quint64 droppedCount() const { return dropped.loadRelaxed(); }
+
+private:
+    LogSink() : queued(0), printed(0), dropped(0), stopping(0), sleeping(false) { clock.start(); }
+
+    void run() {
+        LogRecord record;
+        for (;;) {
+            bool drained = false;
+            while (ring.pop(record)) {
+                qDebug().noquote() << Logger::format(record);
+                printed.fetchAndAddRelease(1);
+                drained = true;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            if (drained) {
+                printedAll.notify_all();
+            }
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Checked after announcing the sleep, so a record queued meanwhile is never missed
+            if (printed.loadAcquire() == queued.loadAcquire()) {
+                // Only once the ring is drained, so records queued before shutdown still print
+                if (stopping.loadAcquire()) {
+                    return;
+                }
+                wake.wait(lock);
+            }
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing ring;
+    QElapsedTimer clock;
+    QAtomicInteger<quint64> queued;
+    QAtomicInteger<quint64> printed;
+    QAtomicInteger<quint64> dropped;
+    QAtomicInteger<int> stopping;
+    std::atomic<bool> sleeping;
+    std::mutex mutex;
+    std::condition_variable wake;       // the worker, when records arrive or on shutdown
+    std::condition_variable printedAll; // flush(), whenever the worker has printed a batch
+    std::once_flag started;
+    std::thread worker;
+};
+
+const char* const LevelNames[] = {"trace", "debug", "info", "warning", "off"};
+
+} // namespace
+
+LogField::LogField(const char* key, const char* value) : LogField(key, value, int(std::strlen(value))) {}
+
+LogField::LogField(const char* key, const char* value, int size)
+    : key(key), type(Text), textSize(quint8(qMin(size, MaxText))), integer(0) {
+    std::memcpy(text, value, textSize);
+}
+
+LogField::LogField(const char* key, const QString& value) : key(key), type(Text), textSize(0), integer(0) {
+    const QChar* p = value.constData();
+    const QChar* end = p + value.size();
+    int size = 0;
+    while (p < end) {
+        char32_t code = p->unicode();
+        int units = 1;
+        if (code >= 0xD800 && code < 0xDC00 && p + 1 < end && p[1].unicode() >= 0xDC00 && p[1].unicode() < 0xE000) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (p[1].unicode() - 0xDC00);
+            units = 2;
+        } else if (code >= 0xD800 && code < 0xE000) {
+            code = 0xFFFD; // unpaired surrogate
+        }
+
+        char bytes[4];
+        int length;
+        if (code < 0x80) {
+            bytes[0] = char(code);
+            length = 1;
+        } else if (code < 0x800) {
+            bytes[0] = char(0xC0 | (code >> 6));
+            bytes[1] = char(0x80 | (code & 0x3F));
+            length = 2;
+        } else if (code < 0x10000) {
+            bytes[0] = char(0xE0 | (code >> 12));
+            bytes[1] = char(0x80 | ((code >> 6) & 0x3F));
+            bytes[2] = char(0x80 | (code & 0x3F));
+            length = 3;
+        } else {
+            bytes[0] = char(0xF0 | (code >> 18));
+            bytes[1] = char(0x80 | ((code >> 12) & 0x3F));
+            bytes[2] = char(0x80 | ((code >> 6) & 0x3F));
+            bytes[3] = char(0x80 | (code & 0x3F));
+            length = 4;
+        }
+        // Truncated at a character boundary, like the other text values but never mid-sequence
+        if (size + length > MaxText) {
+            break;
+        }
+        std::memcpy(text + size, bytes, size_t(length));
+        size += length;
+        p += units;
+    }
+    textSize = quint8(size);
+}
+
+bool Logger::parseLevel(const QString& name, Level& level) {
+    for (int i = Trace; i <= Off; ++i) {
+        if (name == QLatin1String(LevelNames[i])) {
+            level = Level(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::write(Level level, const char* event, std::initializer_list<LogField> fields) {
+    LogSink& sink = LogSink::instance();
+    LogRecord record;
+    record.timeUsec = sink.elapsedUsec();
+    record.event = event;
+    record.level = quint8(level);
+    record.fieldCount = 0;
+    for (const LogField& field : fields) {
+        if (record.fieldCount == LogRecord::MaxFields) {
+            break;
+        }
+        record.fields[record.fieldCount++] = field;
+    }
+    sink.write(record);
+}
+
+void Logger::flush() {
+    LogSink::instance().flush();
+}
+
+quint64 Logger::droppedCount() {
+    return LogSink::instance().droppedCount();
+}
+
+QByteArray Logger::format(const LogRecord& record) {
+    // [+seconds] level event key=value ...
+    QByteArray line;
+    line.reserve(128);
+    line += "[+" + QByteArray::number(double(record.timeUsec) / 1e6, 'f', 6) + "s] ";
+    line += LevelNames[qMin<int>(record.level, Off)];
+    line += ' ';
+    line += record.event;
+    for (int i = 0; i < record.fieldCount; ++i) {
+        const LogField& field = record.fields[i];
+        line += ' ';
+        line += field.key;
+        line += '=';
+        switch (field.type) {
+        case LogField::Integer:
+            line += QByteArray::number(field.integer);
+            break;
+        case LogField::Real:
+            line += QByteArray::number(field.real, 'g', 6);
+            break;
+        case LogField::Text:
+            line.append(field.text, field.textSize);
+            break;
+        }
+    }
+    return line;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QString>
+#include <initializer_list>
+#include <type_traits>
+
+// Structured logging for the message path. A record is an event name plus a
+// few typed key/value fields; write() copies it into a lock-free ring and a
+// background thread formats it, so the calling thread never builds strings.
+//
+// SC_LOG(level, event, fields...) is compiled out entirely (fields are not
+// even evaluated) below SIMPLECHAT_LOG_LEVEL, and skipped after a single
+// relaxed load below the runtime level:
+//
+//   SC_LOG(Trace, "forward", LogField("to", destination), LogField("seq", sequence));
+//
+// Event names and field keys must be string literals; text values are copied
+// (up to LogField::MaxText bytes).
+
+#ifndef SIMPLECHAT_LOG_LEVEL
+#define SIMPLECHAT_LOG_LEVEL 1 // Debug: per-message tracing is compiled out
+#endif
+
+struct LogField {
+    static constexpr int MaxText = 31;
+    enum Type : quint8 { Integer, Real, Text };
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogField(const char* key, T value) : key(key), type(Integer), textSize(0), integer(qint64(value)) {}
+    LogField(const char* key, double value) : key(key), type(Real), textSize(0), real(value) {}
+    LogField(const char* key, const char* value);
+    LogField(const char* key, const QByteArray& value) : LogField(key, value.constData(), value.size()) {}
+    LogField(const char* key, const QString& value); // encoded in place, without a temporary QByteArray
+    LogField() : key(""), type(Integer), textSize(0), integer(0) {}
+
+    const char* key;
+    Type type;
+    quint8 textSize;
+    union {
+        qint64 integer;
+        double real;
+    };
+    char text[MaxText];
+
+private:
+    LogField(const char* key, const char* value, int size);
+};
+
+struct LogRecord {
+    static constexpr int MaxFields = 6;
+
+    qint64 timeUsec;     // since the first record
+    const char* event;
+    quint8 level;
+    quint8 fieldCount;
+    LogField fields[MaxFields];
+};
+
+class Logger {
+public:
+    enum Level { Trace = 0, Debug = 1, Info = 2, Warning = 3, Off = 4 };
+
+    static void setLevel(Level level) { runtimeLevel.storeRelaxed(level); }
+    static Level level() { return Level(runtimeLevel.loadRelaxed()); }
+    static bool isEnabled(Level level) { return level >= runtimeLevel.loadRelaxed(); }
+    static bool parseLevel(const QString& name, Level& level);
+
+    // Queues the record; drops it (and counts the drop) when the ring is full
+    static void write(Level level, const char* event, std::initializer_list<LogField> fields);
+    // Blocks until every record queued so far has been printed
+    static void flush();
+    static quint64 droppedCount();
+
+    static QByteArray format(const LogRecord& record);
+
+private:
+    static inline QAtomicInteger<int> runtimeLevel{Debug};
+};
+
+#define SC_LOG(level, event, ...)                                                              \
+    do {                                                                                       \
+        if constexpr (Logger::level >= SIMPLECHAT_LOG_LEVEL) {                                 \
+            if (Logger::isEnabled(Logger::level)) {                                            \
+                Logger::write(Logger::level, event, {__VA_ARGS__});                            \
+            }                                                                                  \
+        }                                                                                      \
+    } while (0)
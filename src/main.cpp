@@ -1,13 +1,43 @@
-#include <QApplication>
+#include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QScopedPointer>
+#include "headlessnode.h"
+#include "logging.h"
+#include "metricsserver.h"
+#ifndef SIMPLECHAT_NO_GUI
+#include <QApplication>
 #include "simplechat.h"
+#endif
+
+// The application object has to exist before the parser runs, so --headless is looked up by hand.
+// SimpleChat_Node is built without widgets and is always headless.
+static bool isHeadless(int argc, char *argv[]) {
+#ifdef SIMPLECHAT_NO_GUI
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    return true;
+#else
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+#endif
+}
 
 int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
+    const bool headless = isHeadless(argc, argv);
+#ifdef SIMPLECHAT_NO_GUI
+    QScopedPointer<QCoreApplication> app(new QCoreApplication(argc, argv));
+#else
+    QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv)
+                                                  : new QApplication(argc, argv));
+#endif
     
-    QApplication::setApplicationName("SimpleChat");
-    QApplication::setApplicationVersion("1.0");
+    QCoreApplication::setApplicationName("SimpleChat");
+    QCoreApplication::setApplicationVersion("1.0");
     
     QCommandLineParser parser;
     parser.setApplicationDescription("SimpleChat - Ring Network Messaging Application");
@@ -15,10 +45,120 @@ int main(int argc, char *argv[]) {
     parser.addVersionOption();
     
     QCommandLineOption portOption(QStringList() << "p" << "port",
-                                  "Port number for this node (9001-9004)", "port", "9001");
+                                  "Port number for this node; picks the ring member with this port", "port", "9001");
     parser.addOption(portOption);
     
-    parser.process(app);
+    QCommandLineOption nodeOption("node", "Node ID of this process in the ring (takes precedence over --port)",
+                                  "nodeId");
+    parser.addOption(nodeOption);
+    
+    QCommandLineOption configOption("config",
+                                    "Ring topology file, one \"<nodeId> <host>:<port>\" member per line in ring order",
+                                    "file");
+    parser.addOption(configOption);
+    
+    QCommandLineOption ringSizeOption("ring-size",
+                                      "Without --config: number of local nodes, Node1..NodeN on consecutive ports",
+                                      "count", QString::number(RingConfig::DefaultRingSize));
+    parser.addOption(ringSizeOption);
+    
+    QCommandLineOption basePortOption("base-port", "Without --config: port of Node1",
+                                      "port", QString::number(RingConfig::DefaultBasePort));
+    parser.addOption(basePortOption);
+    
+    QCommandLineOption bindOption("bind",
+                                  "Address to listen on (default: loopback for loopback members, otherwise any)",
+                                  "address");
+    parser.addOption(bindOption);
+    
+    // Accepted, and implied, by SimpleChat_Node
+    QCommandLineOption headlessOption("headless",
+                                      "Run without a window; chat over stdin/stdout (send <node> <text>, stats, quit)");
+    parser.addOption(headlessOption);
+    
+    QCommandLineOption routingOption("routing",
+                                     "How messages travel the ring: clockwise, shortest (either direction) or finger (log2 N shortcuts)",
+                                     "mode", "shortest");
+    parser.addOption(routingOption);
+    
+#ifndef SIMPLECHAT_NO_GUI
+    QCommandLineOption historyRowsOption("history-rows",
+                                         "Messages per conversation kept in memory; older ones are paged in from disk",
+                                         "rows", QString::number(ConversationModel::DefaultWindowRows));
+    parser.addOption(historyRowsOption);
+#endif
+    
+    QCommandLineOption batchWindowOption("batch-window-us",
+                                         "Coalesce outgoing messages for this many microseconds (0 = same event-loop turn)",
+                                         "usec", "0");
+    parser.addOption(batchWindowOption);
+    
+    QCommandLineOption batchBytesOption("batch-max-bytes",
+                                        "Flush an outgoing batch once it reaches this many bytes",
+                                        "bytes", "65536");
+    parser.addOption(batchBytesOption);
+    
+    QCommandLineOption batchStatsOption("batch-stats", "Log the size of every outgoing batch");
+    parser.addOption(batchStatsOption);
+    
+    QCommandLineOption queuePolicyOption("queue-policy",
+                                         "What to do when the outbound queue is full: spill, drop-oldest or reject",
+                                         "policy", "spill");
+    parser.addOption(queuePolicyOption);
+    
+    QCommandLineOption queueMemoryOption("queue-memory-kb",
+                                         "Outbound queue memory limit before the overflow policy applies",
+                                         "kb", "4096");
+    parser.addOption(queueMemoryOption);
+    
+    QCommandLineOption queueDiskOption("queue-disk-mb", "Outbound queue spill limit on disk",
+                                       "mb", "256");
+    parser.addOption(queueDiskOption);
+    
+    QCommandLineOption timestampsOption("timestamps",
+                                        "Stamp outgoing messages with the send time so destinations report one-way latency "
+                                        "(needs synchronized clocks)");
+    parser.addOption(timestampsOption);
+    
+    QCommandLineOption storeDirOption("store-dir",
+                                      "Directory for the message store (sent/delivered messages and sequence state)",
+                                      "dir");
+    parser.addOption(storeDirOption);
+    
+    QCommandLineOption metricsPortOption("metrics-port",
+                                         "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics (0 disables)",
+                                         "port", "0");
+    parser.addOption(metricsPortOption);
+    
+    QCommandLineOption transportOption("transport",
+                                       "Socket layer: qt (QTcpSocket), epoll or uring (Linux only; uring falls back "
+                                       "to qt if the kernel refuses it)", "backend", "qt");
+    parser.addOption(transportOption);
+    
+    QCommandLineOption traceEveryOption("trace-every",
+                                        "Trace every Nth message sent from this node: each node it passes records a hop "
+                                        "(0 disables)", "n", "0");
+    parser.addOption(traceEveryOption);
+    
+    QCommandLineOption traceFileOption("trace-file",
+                                       "Write the hop timelines of traced messages delivered here to a Chrome trace file",
+                                       "path");
+    parser.addOption(traceFileOption);
+    
+    QCommandLineOption logLevelOption("log-level",
+                                      "Message path logging: trace, debug, info, warning or off "
+                                      "(levels below the build's SIMPLECHAT_LOG_LEVEL are compiled out)",
+                                      "level", "debug");
+    parser.addOption(logLevelOption);
+    
+    parser.process(*app);
+    
+    Logger::Level logLevel;
+    if (!Logger::parseLevel(parser.value(logLevelOption), logLevel)) {
+        qDebug() << "Invalid log level" << parser.value(logLevelOption);
+        return 1;
+    }
+    Logger::setLevel(logLevel);
     
     bool ok;
     int port = parser.value(portOption).toInt(&ok);
@@ -28,8 +168,135 @@ int main(int argc, char *argv[]) {
         port = 9001;
     }
     
-    SimpleChat chat(port);
-    chat.show();
+    RingConfig ring;
+    if (parser.isSet(configOption)) {
+        QString error;
+        if (!ring.load(parser.value(configOption), error)) {
+            qDebug() << "Invalid ring configuration:" << error;
+            return 1;
+        }
+    } else {
+        int ringSize = parser.value(ringSizeOption).toInt();
+        int basePort = parser.value(basePortOption).toInt();
+        if (ringSize < 1 || ringSize > RingConfig::MaxMembers || basePort < 1024 || basePort + ringSize - 1 > 65535) {
+            qDebug() << "Invalid ring size or base port";
+            return 1;
+        }
+        ring = RingConfig::localRing(ringSize, basePort);
+    }
+    
+    int selfIndex = parser.isSet(nodeOption) ? ring.indexOfNode(parser.value(nodeOption))
+                                             : ring.indexOfPort(port);
+    if (selfIndex == -1) {
+        qDebug() << "This node is not a member of the ring:"
+                 << (parser.isSet(nodeOption) ? parser.value(nodeOption) : QString("port %1").arg(port));
+        return 1;
+    }
+    
+    QScopedPointer<HeadlessNode> node;
+#ifndef SIMPLECHAT_NO_GUI
+    QScopedPointer<SimpleChat> chat;
+#endif
+    NetworkManager* network = nullptr;
+    if (headless) {
+        node.reset(new HeadlessNode(ring, selfIndex));
+        network = node->getNetworkManager();
+    } else {
+#ifndef SIMPLECHAT_NO_GUI
+        chat.reset(new SimpleChat(ring, selfIndex));
+        chat->setHistoryRows(parser.value(historyRowsOption).toInt());
+        network = chat->getNetworkManager();
+#endif
+    }
+    
+    if (parser.isSet(bindOption)) {
+        QHostAddress bindAddress(parser.value(bindOption));
+        if (bindAddress.isNull()) {
+            qDebug() << "Invalid bind address" << parser.value(bindOption);
+            return 1;
+        }
+        if (headless) {
+            node->setListenAddress(bindAddress);
+        } else {
+#ifndef SIMPLECHAT_NO_GUI
+            chat->setListenAddress(bindAddress);
+#endif
+        }
+    }
+    
+    // Network settings have to be in place before the network thread starts
+    if (parser.value(routingOption) == "clockwise") {
+        network->setRoutingMode(RingRouter::Clockwise);
+    } else if (parser.value(routingOption) == "finger") {
+        network->setRoutingMode(RingRouter::Finger);
+    } else {
+        network->setRoutingMode(RingRouter::ShortestDirection);
+    }
+    Transport::Backend transportBackend;
+    if (!Transport::parseBackend(parser.value(transportOption), transportBackend)
+        || !network->setTransportBackend(transportBackend)) {
+        qDebug() << "Unsupported transport" << parser.value(transportOption);
+        return 1;
+    }
+    network->setTimestampsEnabled(parser.isSet(timestampsOption));
+    network->setTraceInterval(parser.value(traceEveryOption).toInt());
+    if (parser.isSet(traceFileOption) && !network->openTraceFile(parser.value(traceFileOption))) {
+        return 1;
+    }
+    network->setBatchWindowUsec(parser.value(batchWindowOption).toInt());
+    network->setBatchMaxBytes(parser.value(batchBytesOption).toInt());
+    bool queueMemoryOk = false;
+    bool queueDiskOk = false;
+    qint64 queueMemoryKb = parser.value(queueMemoryOption).toLongLong(&queueMemoryOk);
+    qint64 queueDiskMb = parser.value(queueDiskOption).toLongLong(&queueDiskOk);
+    if (!queueMemoryOk || !queueDiskOk || queueMemoryKb < 1 || queueDiskMb < 1) {
+        qDebug() << "Invalid outbound queue limits";
+        return 1;
+    }
+    network->setOutboundQueueLimits(queueMemoryKb * 1024, queueDiskMb * 1024 * 1024);
+    
+    QString queuePolicy = parser.value(queuePolicyOption);
+    if (queuePolicy == "drop-oldest") {
+        network->setOutboundQueuePolicy(OutboundQueue::DropOldest);
+    } else if (queuePolicy == "reject") {
+        network->setOutboundQueuePolicy(OutboundQueue::RejectNew);
+    } else {
+        network->setOutboundQueuePolicy(OutboundQueue::SpillToDisk);
+    }
+    
+    // Sequence numbers pick up where the last run stopped
+    QString storeDirectory = parser.isSet(storeDirOption) ? parser.value(storeDirOption)
+                                                          : MessageStore::defaultStorageDirectory();
+    if (!network->openMessageStore(storeDirectory)) {
+        qDebug() << "Failed to open the message store in" << storeDirectory;
+        return 1;
+    }
+    
+    // Metrics are atomics, so the endpoint reads them from this thread while the network thread runs
+    MetricsServer metricsServer(network->getMetrics(), ring.member(selfIndex).nodeId);
+    int metricsPort = parser.value(metricsPortOption).toInt();
+    if (metricsPort > 0 && !metricsServer.listen(metricsPort)) {
+        return 1;
+    }
+    
+    if (parser.isSet(batchStatsOption)) {
+        QObject::connect(network, &NetworkManager::batchFlushed, [](int frames, int bytes) {
+            qDebug() << "Flushed batch of" << frames << "frames," << bytes << "bytes";
+        });
+    }
+    
+    if (headless) {
+        if (!node->start()) {
+            return 1;
+        }
+    } else {
+#ifndef SIMPLECHAT_NO_GUI
+        if (!chat->start()) {
+            return 1;
+        }
+        chat->show();
+#endif
+    }
     
-    return app.exec();
+    return app->exec();
 }
\ No newline at end of file
@@ -1,24 +1,35 @@
 #include "message.h"
 
-Message::Message() : sequenceNumber(0) {}
+Message::Message() : sequenceNumber(0), originNode(-1), destinationNode(-1), timestamp(0), traced(false) {}
 
 Message::Message(const QString& chatText, const QString& origin, const QString& destination, int sequenceNumber)
-    : chatText(chatText), origin(origin), destination(destination), sequenceNumber(sequenceNumber) {}
+    : chatText(chatText.toUtf8()), origin(origin.toUtf8()), destination(destination.toUtf8()),
+      sequenceNumber(sequenceNumber), originNode(-1), destinationNode(-1), timestamp(0), traced(false) {}
+
+Message Message::fromUtf8(const QByteArray& chatText, const QByteArray& origin,
+                          const QByteArray& destination, int sequenceNumber) {
+    Message msg;
+    msg.chatText = chatText;
+    msg.origin = origin;
+    msg.destination = destination;
+    msg.sequenceNumber = sequenceNumber;
+    return msg;
+}
 
 Message Message::fromVariantMap(const QVariantMap& map) {
     Message msg;
-    msg.chatText = map.value("ChatText").toString();
-    msg.origin = map.value("Origin").toString();
-    msg.destination = map.value("Destination").toString();
+    msg.chatText = map.value("ChatText").toString().toUtf8();
+    msg.origin = map.value("Origin").toString().toUtf8();
+    msg.destination = map.value("Destination").toString().toUtf8();
     msg.sequenceNumber = map.value("SequenceNumber").toInt();
     return msg;
 }
 
 QVariantMap Message::toVariantMap() const {
     QVariantMap map;
-    map["ChatText"] = chatText;
-    map["Origin"] = origin;
-    map["Destination"] = destination;
+    map["ChatText"] = getChatText();
+    map["Origin"] = getOrigin();
+    map["Destination"] = getDestination();
     map["SequenceNumber"] = sequenceNumber;
     return map;
 }
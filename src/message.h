@@ -1,34 +1,81 @@
 #pragma once
 
+#include <QByteArray>
 #include <QVariantMap>
 #include <QString>
 #include <QDataStream>
+#include <QMetaType>
+#include <QVector>
 
+// One hop of a traced message: the node it passed and when, in microseconds
+// on that host's monotonic clock
+struct TraceHop {
+    quint16 node = 0; // NodeTable handle
+    qint64 usec = 0;
+};
+
+// Text fields are held as UTF-8 in implicitly shared buffers, so copying or
+// moving a Message through the pipeline never copies text. Decoded messages
+// share a pooled payload buffer (see PayloadPool) and the NodeTable's copy
+// of each name; the QString accessors convert on demand for the UI.
+// Messages decoded from a frame or sent from this node also carry the
+// NodeTable handles of both ends, so routing does not hash the names again.
 class Message {
 public:
     Message();
     Message(const QString& chatText, const QString& origin, const QString& destination, int sequenceNumber);
     
+    static Message fromUtf8(const QByteArray& chatText, const QByteArray& origin,
+                            const QByteArray& destination, int sequenceNumber);
     static Message fromVariantMap(const QVariantMap& map);
     QVariantMap toVariantMap() const;
     
-    QString getChatText() const { return chatText; }
-    QString getOrigin() const { return origin; }
-    QString getDestination() const { return destination; }
+    QString getChatText() const { return QString::fromUtf8(chatText); }
+    QString getOrigin() const { return QString::fromUtf8(origin); }
+    QString getDestination() const { return QString::fromUtf8(destination); }
+    const QByteArray& chatTextUtf8() const { return chatText; }
+    const QByteArray& originUtf8() const { return origin; }
+    const QByteArray& destinationUtf8() const { return destination; }
     int getSequenceNumber() const { return sequenceNumber; }
+    // Send time in microseconds since the epoch, 0 if the sender did not stamp it
+    qint64 getTimestamp() const { return timestamp; }
+    // Traced messages collect a TraceHop from every node they pass
+    bool isTraced() const { return traced; }
+    const QVector<TraceHop>& getTraceHops() const { return traceHops; }
+    // NodeTable handles, -1 (NodeTable::InvalidHandle) where not known
+    int originHandle() const { return originNode; }
+    int destinationHandle() const { return destinationNode; }
     
-    void setChatText(const QString& text) { chatText = text; }
-    void setOrigin(const QString& org) { origin = org; }
-    void setDestination(const QString& dest) { destination = dest; }
+    void setChatText(const QString& text) { chatText = text.toUtf8(); }
+    void setOrigin(const QString& org) { origin = org.toUtf8(); originNode = -1; }
+    void setDestination(const QString& dest) { destination = dest.toUtf8(); destinationNode = -1; }
+    void setOriginUtf8(const QByteArray& org) { origin = org; originNode = -1; }
+    void setHandles(int originHandle, int destinationHandle) { originNode = originHandle; destinationNode = destinationHandle; }
     void setSequenceNumber(int seq) { sequenceNumber = seq; }
+    void setTimestamp(qint64 usec) { timestamp = usec; }
+    void setTraced(bool enabled) { traced = enabled; }
+    void addTraceHop(quint16 node, qint64 usec) { traceHops.append({node, usec}); }
     
     bool isValid() const;
     
 private:
-    QString chatText;
-    QString origin;
-    QString destination;
+    QByteArray chatText;
+    QByteArray origin;
+    QByteArray destination;
     int sequenceNumber;
+    int originNode;
+    int destinationNode;
+    qint64 timestamp;
+    bool traced;
+    QVector<TraceHop> traceHops;
+};
+
+Q_DECLARE_METATYPE(Message)
+
+// A run of consecutive sequence numbers
+struct SequenceRange {
+    int first = 0;
+    int length = 0;
 };
 
 QDataStream& operator<<(QDataStream& stream, const Message& message);
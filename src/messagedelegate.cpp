@@ -0,0 +1,78 @@
+#include "messagedelegate.h"
+#include <QAbstractScrollArea>
+#include <QFontMetrics>
+#include <QPainter>
+
+static const int BubblePaddingX = 16;
+static const int BubblePaddingY = 12;
+static const int RowMargin = 8;
+static const int BubbleRadius = 18;
+static const int MaxBubbleTextWidth = 250;
+static const int TextFlags = Qt::TextWordWrap;
+
+MessageDelegate::MessageDelegate(QObject* parent) : QStyledItemDelegate(parent) {}
+
+int MessageDelegate::availableWidth(const QStyleOptionViewItem& option) const {
+    // Size hints are requested before items have a rect, so measure against the viewport
+    if (auto* view = qobject_cast<const QAbstractScrollArea*>(option.widget)) {
+        return view->viewport()->width();
+    }
+    return option.rect.width();
+}
+
+QRect MessageDelegate::textRect(const QStyleOptionViewItem& option, const QString& text, int width) const {
+    // Bubbles take at most 70% of the row, like the old 30% spacer column
+    int maxTextWidth = qMax(1, qMin(MaxBubbleTextWidth, width * 7 / 10 - 2 * BubblePaddingX));
+    QFontMetrics metrics(option.font);
+    return metrics.boundingRect(QRect(0, 0, maxTextWidth, 1 << 20), TextFlags, text);
+}
+
+QSize MessageDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const {
+    int width = availableWidth(option);
+    auto* model = qobject_cast<const ConversationModel*>(index.model());
+    if (model) {
+        int cached = model->cachedHeight(index.row(), width);
+        if (cached >= 0) {
+            return QSize(width, cached);
+        }
+    }
+    
+    QRect text = textRect(option, index.data(Qt::DisplayRole).toString(), width);
+    int height = text.height() + 2 * BubblePaddingY + RowMargin;
+    if (model) {
+        model->cacheHeight(index.row(), width, height);
+    }
+    return QSize(width, height);
+}
+
+void MessageDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const {
+    const QString text = index.data(Qt::DisplayRole).toString();
+    auto kind = ConversationModel::Kind(index.data(ConversationModel::KindRole).toInt());
+    
+    QRect textBounds = textRect(option, text, option.rect.width());
+    QSize bubbleSize(textBounds.width() + 2 * BubblePaddingX, textBounds.height() + 2 * BubblePaddingY);
+    QRect row = option.rect.adjusted(RowMargin, RowMargin / 2, -RowMargin, -RowMargin / 2);
+    
+    QRect bubble(QPoint(row.left(), row.top()), bubbleSize);
+    if (kind == ConversationModel::Sent) {
+        bubble.moveRight(row.right());
+    } else if (kind == ConversationModel::Note) {
+        bubble.moveLeft(row.left() + (row.width() - bubbleSize.width()) / 2);
+    }
+    
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    if (kind != ConversationModel::Note) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(kind == ConversationModel::Sent ? QColor("#007AFF") : QColor("#2A2F32"));
+        painter->drawRoundedRect(bubble, BubbleRadius, BubbleRadius);
+    }
+    
+    QColor textColor = kind == ConversationModel::Sent ? QColor("#FFFFFF")
+                     : kind == ConversationModel::Received ? QColor("#E9EDEF") : QColor("#8696A0");
+    painter->setPen(textColor);
+    painter->setFont(option.font);
+    painter->drawText(bubble.adjusted(BubblePaddingX, BubblePaddingY, -BubblePaddingX, -BubblePaddingY),
+                      TextFlags, text);
+    painter->restore();
+}
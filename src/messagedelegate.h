@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QStyledItemDelegate>
+#include "conversationmodel.h"
+
+// Draws conversation rows as chat bubbles: sent messages in blue on the
+// right, received ones in gray on the left, notes as centered gray text.
+// Text is laid out with QFontMetrics rather than rich text, and measured
+// heights are cached in the ConversationModel per view width.
+class MessageDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    explicit MessageDelegate(QObject* parent = nullptr);
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+private:
+    int availableWidth(const QStyleOptionViewItem& option) const;
+    QRect textRect(const QStyleOptionViewItem& option, const QString& text, int width) const;
+};
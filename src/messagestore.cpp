@@ -0,0 +1,434 @@
+#include "messagestore.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <cstring>
+
+static const quint32 IndexMagic = 0x53434d49; // "SCMI"
+static const quint32 IndexVersion = 1;
+static const qint64 IndexHeaderSize = 16;
+static const qint64 IndexEntrySize = 16;
+static const int InitialIndexCapacity = 4096;
+
+// [u32 body length][u8 direction][u32 sequence][u16 origin length][origin][u16 destination length][destination][text]
+static const int RecordPrefixSize = 4;
+static const int MinimumRecordSize = RecordPrefixSize + 1 + 4 + 2 + 2;
+
+MessageStore::MessageStore()
+    : segmentBytes(DefaultSegmentBytes), storeText(true), indexMap(nullptr), capacity(0), records(0), flushedRecords(0),
+      segmentEnd(0), unflushedBytes(0), segmentNumber(0), readSegmentNumber(0), checkpointedRecords(0) {}
+
+MessageStore::~MessageStore() {
+    close();
+}
+
+QString MessageStore::defaultStorageDirectory() {
+    QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+    dataDir.mkpath("messages");
+    return dataDir.filePath("messages");
+}
+
+bool MessageStore::open(const QString& directory) {
+    close();
+    this->directory = directory;
+    QDir().mkpath(directory);
+
+    index.setFileName(QDir(directory).filePath("index.dat"));
+    if (!index.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open message index" << index.fileName() << ":" << index.errorString();
+        return false;
+    }
+
+    bool fresh = index.size() < IndexHeaderSize;
+    qint64 existing = fresh ? 0 : (index.size() - IndexHeaderSize) / IndexEntrySize;
+    if (!mapIndex(qMax<qint64>(existing, InitialIndexCapacity))) {
+        index.close();
+        return false;
+    }
+
+    if (fresh) {
+        qToBigEndian(IndexMagic, indexMap);
+        qToBigEndian(IndexVersion, indexMap + 4);
+        setRecordCount(0);
+    } else if (qFromBigEndian<quint32>(indexMap) != IndexMagic) {
+        qDebug() << "Not a message index:" << index.fileName();
+        close();
+        return false;
+    }
+    records = qMin(int(qFromBigEndian<quint32>(indexMap + 8)), capacity);
+    flushedRecords = records;
+    checkpointedRecords = records; // nothing to checkpoint until the counters are loaded
+
+    // Pick up anything written after the last index update, including segments
+    // rolled over just before a crash (or every segment, if the index was lost)
+    int lastSegment = 1;
+    if (records > 0) {
+        qint64 offset;
+        int length;
+        readIndexEntry(records - 1, lastSegment, offset, length);
+    }
+    if (!openSegment(lastSegment)) {
+        close();
+        return false;
+    }
+    recoverSegmentTail();
+    while (QFile::exists(segmentPath(segmentNumber + 1))) {
+        if (!openSegment(segmentNumber + 1)) {
+            break;
+        }
+        recoverSegmentTail();
+    }
+
+    loadCheckpoint();
+    qDebug() << "Opened message store" << directory << "with" << records << "records,"
+             << records - checkpointedRecords << "replayed";
+    return true;
+}
+
+void MessageStore::close() {
+    if (!isOpen()) {
+        return;
+    }
+    flush();
+    if (records != checkpointedRecords) {
+        checkpoint();
+    }
+
+    index.unmap(indexMap);
+    indexMap = nullptr;
+    index.close();
+    segment.close();
+    readSegment.close();
+    readSegmentNumber = 0;
+    capacity = 0;
+    records = 0;
+    flushedRecords = 0;
+    unflushedBytes = 0;
+    checkpointedRecords = 0;
+    nextSend.clear();
+    nextExpected.clear();
+}
+
+bool MessageStore::mapIndex(qint64 entries) {
+    if (indexMap) {
+        index.unmap(indexMap);
+        indexMap = nullptr;
+    }
+
+    qint64 size = IndexHeaderSize + entries * IndexEntrySize;
+    if (index.size() < size && !index.resize(size)) {
+        qDebug() << "Failed to grow message index:" << index.errorString();
+        return false;
+    }
+    indexMap = index.map(0, size);
+    if (!indexMap) {
+        qDebug() << "Failed to map message index:" << index.errorString();
+        return false;
+    }
+    capacity = int(entries);
+    return true;
+}
+
+bool MessageStore::openSegment(int number) {
+    segment.close();
+    segment.setFileName(segmentPath(number));
+    if (!segment.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open message segment" << segment.fileName() << ":" << segment.errorString();
+        return false;
+    }
+    segmentNumber = number;
+    segmentEnd = segment.size();
+    return true;
+}
+
+void MessageStore::recoverSegmentTail() {
+    // Index entries past the end of the segment are dropped
+    qint64 end = 0;
+    while (records > 0) {
+        int lastSegment;
+        qint64 offset;
+        int length;
+        readIndexEntry(records - 1, lastSegment, offset, length);
+        if (lastSegment != segmentNumber) {
+            break;
+        }
+        if (offset + length <= segment.size()) {
+            end = offset + length;
+            break;
+        }
+        --records;
+    }
+
+    // Records behind them are indexed; a torn record at the tail is cut off
+    char prefix[RecordPrefixSize];
+    segment.seek(end);
+    while (segment.read(prefix, RecordPrefixSize) == RecordPrefixSize) {
+        int length = RecordPrefixSize + int(qFromBigEndian<quint32>(prefix));
+        if (length < MinimumRecordSize || end + length > segment.size()) {
+            break;
+        }
+        if (records == capacity && !mapIndex(qint64(capacity) * 2)) {
+            break;
+        }
+        writeIndexEntry(records++, segmentNumber, end, length);
+        end += length;
+        segment.seek(end);
+    }
+    if (end < segment.size()) {
+        qDebug() << "Truncating torn record at" << end << "in" << segment.fileName();
+        segment.resize(end);
+        segmentEnd = end;
+    }
+    setRecordCount(records);
+    flushedRecords = records;
+}
+
+void MessageStore::writeIndexEntry(int record, int segment, qint64 offset, int length) {
+    uchar* entry = indexMap + IndexHeaderSize + qint64(record) * IndexEntrySize;
+    qToBigEndian(quint32(segment), entry);
+    qToBigEndian(quint32(length), entry + 4);
+    qToBigEndian(offset, entry + 8);
+}
+
+void MessageStore::readIndexEntry(int record, int& segment, qint64& offset, int& length) const {
+    const uchar* entry = indexMap + IndexHeaderSize + qint64(record) * IndexEntrySize;
+    segment = int(qFromBigEndian<quint32>(entry));
+    length = int(qFromBigEndian<quint32>(entry + 4));
+    offset = qFromBigEndian<qint64>(entry + 8);
+}
+
+void MessageStore::setRecordCount(int count) {
+    // Written after the entries it covers, so a crash never exposes an unwritten entry
+    qToBigEndian(quint32(count), indexMap + 8);
+}
+
+bool MessageStore::append(Direction direction, const Message& message) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    const QByteArray& origin = message.originUtf8();
+    const QByteArray& destination = message.destinationUtf8();
+    static const QByteArray noText;
+    const QByteArray& text = storeText ? message.chatTextUtf8() : noText;
+    int length = MinimumRecordSize + origin.size() + destination.size() + text.size();
+
+    recordBuffer.resize(length);
+    char* out = recordBuffer.data();
+    qToBigEndian(quint32(length - RecordPrefixSize), out);
+    out[4] = char(direction);
+    qToBigEndian(quint32(message.getSequenceNumber()), out + 5);
+    out += 9;
+    qToBigEndian(quint16(origin.size()), out);
+    memcpy(out + 2, origin.constData(), origin.size());
+    out += 2 + origin.size();
+    qToBigEndian(quint16(destination.size()), out);
+    memcpy(out + 2, destination.constData(), destination.size());
+    out += 2 + destination.size();
+    memcpy(out, text.constData(), text.size());
+
+    // Closing the old segment writes out what it still buffers
+    if (segmentEnd > 0 && segmentEnd + length > segmentBytes && !openSegment(segmentNumber + 1)) {
+        return false;
+    }
+    qint64 offset = segmentEnd;
+    // Seeking flushes the write buffer, so it is only done after a read moved the position
+    if (segment.pos() != offset && !segment.seek(offset)) {
+        return false;
+    }
+    if (segment.write(recordBuffer.constData(), length) != length) {
+        qDebug() << "Failed to append to message segment" << segment.fileName() << ":" << segment.errorString();
+        return false;
+    }
+    segmentEnd += length;
+    unflushedBytes += length;
+
+    if (records == capacity && !mapIndex(qint64(capacity) * 2)) {
+        return false;
+    }
+    // The header count moves on only in flush(), once the record is in the file
+    writeIndexEntry(records++, segmentNumber, offset, length);
+
+    Record record;
+    record.direction = direction;
+    record.message = message;
+    applySequence(record);
+    if (unflushedBytes >= FlushBytes) {
+        flush();
+    }
+    if (records - checkpointedRecords >= CheckpointInterval) {
+        checkpoint();
+    }
+    return true;
+}
+
+bool MessageStore::flush() {
+    if (!isOpen()) {
+        return false;
+    }
+    if (!hasUnflushed()) {
+        return true;
+    }
+    if (!segment.flush()) {
+        qDebug() << "Failed to flush message segment" << segment.fileName() << ":" << segment.errorString();
+        return false;
+    }
+    setRecordCount(records);
+    flushedRecords = records;
+    unflushedBytes = 0;
+    return true;
+}
+
+MessageStore::Record MessageStore::read(int record) {
+    Record result;
+    if (!isOpen() || record < 0 || record >= records) {
+        return result;
+    }
+
+    int number;
+    qint64 offset;
+    int length;
+    readIndexEntry(record, number, offset, length);
+    if (number == segmentNumber) {
+        readRecord(segment, offset, length, result);
+        return result;
+    }
+
+    if (readSegmentNumber != number) {
+        readSegment.close();
+        readSegment.setFileName(segmentPath(number));
+        if (!readSegment.open(QIODevice::ReadOnly)) {
+            qDebug() << "Failed to open message segment" << readSegment.fileName() << ":" << readSegment.errorString();
+            readSegmentNumber = 0;
+            return result;
+        }
+        readSegmentNumber = number;
+    }
+    readRecord(readSegment, offset, length, result);
+    return result;
+}
+
+QVector<MessageStore::Record> MessageStore::recent(int count) {
+    QVector<Record> result;
+    int first = qMax(0, records - count);
+    result.reserve(records - first);
+    for (int i = first; i < records; ++i) {
+        result.append(read(i));
+    }
+    return result;
+}
+
+bool MessageStore::readRecord(QFile& file, qint64 offset, int length, Record& record) {
+    if (length < MinimumRecordSize || !file.seek(offset)) {
+        return false;
+    }
+    QByteArray data = file.read(length);
+    if (data.size() != length) {
+        return false;
+    }
+
+    const char* in = data.constData();
+    const char* end = in + length;
+    record.direction = Direction(quint8(in[4]));
+    int sequence = int(qFromBigEndian<quint32>(in + 5));
+    in += 9;
+
+    int originSize = qFromBigEndian<quint16>(in);
+    if (in + 2 + originSize + 2 > end) {
+        return false;
+    }
+    QByteArray origin(in + 2, originSize);
+    in += 2 + originSize;
+
+    int destinationSize = qFromBigEndian<quint16>(in);
+    if (in + 2 + destinationSize > end) {
+        return false;
+    }
+    QByteArray destination(in + 2, destinationSize);
+    in += 2 + destinationSize;
+
+    record.message = Message::fromUtf8(QByteArray(in, int(end - in)), origin, destination, sequence);
+    return true;
+}
+
+bool MessageStore::checkpoint() {
+    // The checkpoint must not cover records that are not in the file yet
+    if (!flush()) {
+        return false;
+    }
+
+    QSaveFile file(QDir(directory).filePath("sequences.dat"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write sequence checkpoint:" << file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << quint32(records) << toNames(nextSend) << toNames(nextExpected);
+    if (!file.commit()) {
+        qDebug() << "Failed to write sequence checkpoint:" << file.errorString();
+        return false;
+    }
+    checkpointedRecords = records;
+    return true;
+}
+
+void MessageStore::loadCheckpoint() {
+    nextSend.clear();
+    nextExpected.clear();
+    checkpointedRecords = 0;
+
+    QFile file(QDir(directory).filePath("sequences.dat"));
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+        quint32 covered;
+        QMap<QString, int> send;
+        QMap<QString, int> expected;
+        stream >> covered >> send >> expected;
+        // A checkpoint ahead of the index is useless; the counters are then rebuilt from every record
+        if (stream.status() == QDataStream::Ok && int(covered) <= records) {
+            checkpointedRecords = int(covered);
+            nextSend = fromNames(send);
+            nextExpected = fromNames(expected);
+        }
+    }
+
+    for (int i = checkpointedRecords; i < records; ++i) {
+        applySequence(read(i));
+    }
+}
+
+void MessageStore::applySequence(const Record& record) {
+    const Message& message = record.message;
+    int next = message.getSequenceNumber() + 1;
+    QMap<QByteArray, int>& sequences = record.direction == Sent ? nextSend : nextExpected;
+    const QByteArray& name = record.direction == Sent ? message.destinationUtf8() : message.originUtf8();
+    auto it = sequences.find(name);
+    if (it == sequences.end()) {
+        sequences.insert(name, qMax(1, next));
+    } else if (it.value() < next) {
+        it.value() = next;
+    }
+}
+
+QMap<QString, int> MessageStore::toNames(const QMap<QByteArray, int>& sequences) {
+    QMap<QString, int> names;
+    for (auto it = sequences.constBegin(); it != sequences.constEnd(); ++it) {
+        names.insert(QString::fromUtf8(it.key()), it.value());
+    }
+    return names;
+}
+
+QMap<QByteArray, int> MessageStore::fromNames(const QMap<QString, int>& sequences) {
+    QMap<QByteArray, int> utf8;
+    for (auto it = sequences.constBegin(); it != sequences.constEnd(); ++it) {
+        utf8.insert(it.key().toUtf8(), it.value());
+    }
+    return utf8;
+}
+
+QString MessageStore::segmentPath(int number) const {
+    return QDir(directory).filePath(QString("segment-%1.log").arg(number, 6, 10, QChar('0')));
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include "message.h"
+
+// Durable record of every message this node sent or delivered, and the
+// sequence state that follows from them. Records are appended to numbered
+// segment files (segment-<n>.log) that roll over at a size limit.
+// index.dat holds one fixed-size (segment, offset, length) entry per record
+// and is memory-mapped, so any record is one read away and nothing is held
+// in memory per message. Sequence counters are checkpointed to
+// sequences.dat; opening the store loads the checkpoint and replays only
+// the records appended after it.
+//
+// append() leaves records in the segment's write buffer; they reach the
+// file, and the index count, on flush(), which the owner calls on a timer
+// and append() calls itself once FlushBytes are waiting. A crash loses at
+// most what was appended since the last flush.
+//
+// With setStoreText(false) records keep their addressing and sequence
+// number but not the text, for owners that already write the text to disk
+// elsewhere (the GUI's scrollback logs).
+class MessageStore {
+public:
+    enum Direction {
+        Sent,
+        Received
+    };
+
+    struct Record {
+        Direction direction = Sent;
+        Message message;
+    };
+
+    static constexpr qint64 DefaultSegmentBytes = 16 * 1024 * 1024;
+    static constexpr int CheckpointInterval = 1024;
+    static constexpr int FlushBytes = 64 * 1024;
+
+    MessageStore();
+    ~MessageStore();
+
+    // Where stores live unless configured otherwise: messages/ under the application's local data directory
+    static QString defaultStorageDirectory();
+
+    void setSegmentBytes(qint64 bytes) { segmentBytes = bytes; }
+    void setStoreText(bool store) { storeText = store; }
+
+    bool open(const QString& directory);
+    void close();
+    bool isOpen() const { return indexMap != nullptr; }
+
+    bool append(Direction direction, const Message& message);
+    bool flush();
+    bool hasUnflushed() const { return records != flushedRecords; }
+    int count() const { return records; }
+    Record read(int record);
+
+    // The newest count records, oldest first
+    QVector<Record> recent(int count);
+
+    // destination -> next sequence number to send, origin -> next sequence number expected
+    QMap<QString, int> nextSendSequences() const { return toNames(nextSend); }
+    QMap<QString, int> nextExpectedSequences() const { return toNames(nextExpected); }
+
+    bool checkpoint();
+
+private:
+    bool mapIndex(qint64 capacity);
+    bool openSegment(int number);
+    void recoverSegmentTail();
+    void writeIndexEntry(int record, int segment, qint64 offset, int length);
+    void readIndexEntry(int record, int& segment, qint64& offset, int& length) const;
+    void setRecordCount(int count);
+    bool readRecord(QFile& file, qint64 offset, int length, Record& record);
+    void loadCheckpoint();
+    void applySequence(const Record& record);
+    QString segmentPath(int number) const;
+    static QMap<QString, int> toNames(const QMap<QByteArray, int>& sequences);
+    static QMap<QByteArray, int> fromNames(const QMap<QString, int>& sequences);
+
+    QString directory;
+    qint64 segmentBytes;
+    bool storeText;
+
+    QFile index;
+    uchar* indexMap;
+    int capacity;
+    int records;
+    int flushedRecords; // the count in the index header
+
+    QFile segment;
+    qint64 segmentEnd; // including what is still buffered, since QFile::size() would flush it
+    qint64 unflushedBytes;
+    QByteArray recordBuffer; // reused by append(), so storing a message does not allocate
+    int segmentNumber;
+
+    // Older segments are only opened to serve reads
+    QFile readSegment;
+    int readSegmentNumber;
+
+    // Keyed by UTF-8 name, as Message carries it, so applying a record converts nothing
+    QMap<QByteArray, int> nextSend;
+    QMap<QByteArray, int> nextExpected;
+    int checkpointedRecords;
+};
@@ -0,0 +1,124 @@
+#include "metricsserver.h"
+#include <QDebug>
+#include <QTcpSocket>
+
+// Nominal histogram bucket bounds in nanoseconds; each is exported as the
+// upper bound of the LatencyHistogram bucket it falls in, in seconds
+static const quint64 BucketBoundsNsec[] = {
+    250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000
+};
+
+static QByteArray escapeLabel(const QString& value) {
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+static QByteArray seconds(quint64 nsec) {
+    return QByteArray::number(double(nsec) / 1e9, 'g', 6);
+}
+
+MetricsServer::MetricsServer(const NetworkMetrics& metrics, const QString& nodeId, QObject* parent)
+    : QObject(parent), metrics(metrics), nodeId(nodeId) {
+    server = new QTcpServer(this);
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(int port, const QHostAddress& address) {
+    if (!server->listen(address, port)) {
+        qDebug() << "Failed to start metrics endpoint on" << address.toString() << "port" << port
+                 << ":" << server->errorString();
+        return false;
+    }
+    qDebug() << "Serving metrics on" << QString("http://%1:%2/metrics").arg(address.toString()).arg(port);
+    return true;
+}
+
+void MetricsServer::onNewConnection() {
+    while (server->hasPendingConnections()) {
+        QTcpSocket* socket = server->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            // Only the request line matters; wait until it is complete
+            if (!socket->canReadLine()) {
+                return;
+            }
+            QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+            socket->readAll();
+            disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+            bool found = request.size() >= 2 && request[0] == "GET"
+                         && (request[1] == "/metrics" || request[1] == "/");
+            QByteArray body = found ? render(metrics, nodeId) : QByteArray("not found\n");
+            QByteArray response = found ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.0 404 Not Found\r\n";
+            response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+            response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+            response += "Connection: close\r\n\r\n";
+            response += body;
+            socket->write(response);
+            socket->disconnectFromHost();
+        });
+    }
+}
+
+QByteArray MetricsServer::render(const NetworkMetrics& metrics, const QString& nodeId) {
+    QByteArray out;
+    QByteArray node = "node=\"" + escapeLabel(nodeId) + "\"";
+
+    auto header = [&out](const char* name, const char* type, const char* help) {
+        out += QByteArray("# HELP simplechat_") + name + " " + help + "\n";
+        out += QByteArray("# TYPE simplechat_") + name + " " + type + "\n";
+    };
+    auto counter = [&](const char* name, const char* help, quint64 value) {
+        header(name, "counter", help);
+        out += QByteArray("simplechat_") + name + "{" + node + "} " + QByteArray::number(value) + "\n";
+    };
+    auto gauge = [&](const char* name, const char* help, qint64 value) {
+        header(name, "gauge", help);
+        out += QByteArray("simplechat_") + name + "{" + node + "} " + QByteArray::number(value) + "\n";
+    };
+    auto histogram = [&](const char* name, const char* help, const LatencyHistogram& histogram) {
+        header(name, "histogram", help);
+        LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+        QByteArray prefix = QByteArray("simplechat_") + name;
+
+        // A nominal bound usually falls inside a histogram bucket, which cannot be split, so
+        // the exported bound is moved up to that bucket's upper end; every count is then exact
+        int bucket = 0;
+        quint64 cumulative = 0;
+        for (quint64 nominal : BucketBoundsNsec) {
+            int last = LatencyHistogram::bucketFor(nominal);
+            while (bucket <= last) {
+                cumulative += snapshot.buckets[bucket++];
+            }
+            out += prefix + "_bucket{" + node + ",le=\"" + seconds(LatencyHistogram::bucketUpperBound(last)) + "\"} "
+                   + QByteArray::number(cumulative) + "\n";
+        }
+        out += prefix + "_bucket{" + node + ",le=\"+Inf\"} " + QByteArray::number(snapshot.count) + "\n";
+        out += prefix + "_sum{" + node + "} " + seconds(snapshot.total) + "\n";
+        out += prefix + "_count{" + node + "} " + QByteArray::number(snapshot.count) + "\n";
+    };
+
+    counter("frames_received_total", "Frames read from all connections.", metrics.framesReceived.loadRelaxed());
+    counter("bytes_received_total", "Bytes read from all connections, length prefixes included.",
+            metrics.bytesReceived.loadRelaxed());
+    counter("frames_sent_total", "Frames written to all connections, batched or not.", metrics.framesSent.loadRelaxed());
+    counter("bytes_sent_total", "Bytes written to all connections, length prefixes included.",
+            metrics.bytesSent.loadRelaxed());
+    counter("forwarded_total", "Frames passed on towards another node.", metrics.forwarded.loadRelaxed());
+    counter("delivered_total", "Messages delivered to this node in sequence order.", metrics.delivered.loadRelaxed());
+    counter("decode_errors_total", "Frames dropped because they could not be decoded.",
+            metrics.decodeErrors.loadRelaxed());
+    counter("reconnects_total", "Neighbor links that came back up after going down.", metrics.reconnects.loadRelaxed());
+    gauge("outbound_queue_frames", "Frames waiting in outbound queues for a neighbor to come up.",
+          metrics.queuedFrames.loadRelaxed());
+    gauge("reorder_buffered_messages", "Messages waiting for an earlier sequence number.",
+          metrics.reorderBuffered.loadRelaxed());
+    histogram("decode_seconds", "Time to fully decode a frame that was not cut through.", metrics.decodeNsec);
+    histogram("forward_latency_seconds", "Time from reading a transit frame to handing it to the next hop.",
+              metrics.forwardNsec);
+    return out;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include "networkmetrics.h"
+
+// Serves a node's NetworkMetrics in the Prometheus text format at
+// http://<address>:<port>/metrics. Each request gets a fresh snapshot; the
+// server only reads atomics, so it can run on a different thread from the
+// NetworkManager that owns the metrics (which has to outlive it).
+class MetricsServer : public QObject {
+    Q_OBJECT
+
+public:
+    MetricsServer(const NetworkMetrics& metrics, const QString& nodeId, QObject* parent = nullptr);
+
+    bool listen(int port, const QHostAddress& address = QHostAddress(QHostAddress::LocalHost));
+
+    static QByteArray render(const NetworkMetrics& metrics, const QString& nodeId);
+
+private slots:
+    void onNewConnection();
+
+private:
+    const NetworkMetrics& metrics;
+    QString nodeId;
+    QTcpServer* server;
+};
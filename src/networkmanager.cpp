@@ -1,80 +1,369 @@
 #include "networkmanager.h"
-#include <QDataStream>
+#include "logging.h"
+#include "wireformat.h"
 #include <QHostAddress>
 #include <QDebug>
+#include <QDir>
+#include <QtEndian>
+#include <chrono>
+#include <cstring>
+
+// A gap is given NackDelayMsec to fill by itself before it is NACKed, then re-NACKed every
+// NackRetryMsec; after MaxNackAttempts it is skipped, so delivery stalls for about 2 s at most
+static const int GapCheckIntervalMsec = 50;
+static const int NackDelayMsec = 100;
+static const int NackRetryMsec = 400;
+static const int MaxNackAttempts = 5;
+static const int MaxNackRanges = 32;
+
+// A NACK never asks for more than the requester's reorder window, so one NACK resends at most
+// that many, and one requester at most NackResendBudget per NackBudgetWindowMsec
+static const int MaxResendsPerNack = ReorderBuffer::DefaultWindow;
+static const int NackResendBudget = 4 * ReorderBuffer::DefaultWindow;
+static const int NackBudgetWindowMsec = 1000;
+
+// Deliveries within this window share one cumulative ACK per origin
+static const int AckDelayMsec = 10;
+
+// Stored messages reach the file together, at most this long after the first of them
+static const int StoreFlushMsec = 50;
+
+static qint64 wallClockUsec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Trace hops use the monotonic clock, which processes on one host share
+static qint64 monotonicUsec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Per-node tables grow on first use of a handle
+template <typename T>
+static T& atHandle(QVector<T>& table, int handle) {
+    if (handle >= table.size()) {
+        table.resize(handle + 1);
+    }
+    return table[handle];
+}
+
+template <typename T>
+static void remapHandles(QVector<T>& table, const QVector<int>& handles) {
+    QVector<T> remapped;
+    for (int old = 0; old < table.size() && old < handles.size(); ++old) {
+        if (handles[old] != NodeTable::InvalidHandle) {
+            atHandle(remapped, handles[old]) = std::move(table[old]);
+        }
+    }
+    table = std::move(remapped);
+}
+
+template <typename T>
+static void remapHandles(QMap<int, T>& table, const QVector<int>& handles) {
+    QMap<int, T> remapped;
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        if (it.key() < handles.size() && handles[it.key()] != NodeTable::InvalidHandle) {
+            remapped.insert(handles[it.key()], it.value());
+        }
+    }
+    table = remapped;
+}
 
 NetworkManager::NetworkManager(QObject* parent) 
-    : QObject(parent), server(nullptr), neighborSocket(nullptr), 
-      serverPort(0), neighborPort(0), currentPortIndex(-1) {
+    : QObject(parent), transportBackend(Transport::QtSockets), transport(nullptr),
+      serverPort(0), routingMode(RingRouter::ShortestDirection),
+      selfHandle(NodeTable::InvalidHandle), preferredWireVersion(WireFormat::Version),
+      batchWindowUsec(0), batchMaxBytes(FrameBatcher::DefaultMaxBatchBytes),
+      queuePolicy(OutboundQueue::SpillToDisk), queueMemoryLimit(OutboundQueue::DefaultMemoryLimit),
+      queueDiskLimit(OutboundQueue::DefaultDiskLimit), timestampsEnabled(false),
+      traceInterval(0), sentSinceTrace(0) {
     
-    retryTimer = new QTimer(this);
-    retryTimer->setSingleShot(true);
-    connect(retryTimer, &QTimer::timeout, this, &NetworkManager::retryConnection);
+    gapTimer = new QTimer(this);
+    connect(gapTimer, &QTimer::timeout, this, &NetworkManager::onGapTimer);
+    ackTimer = new QTimer(this);
+    ackTimer->setSingleShot(true);
+    connect(ackTimer, &QTimer::timeout, this, &NetworkManager::flushAcks);
+    storeTimer = new QTimer(this);
+    storeTimer->setSingleShot(true);
+    connect(storeTimer, &QTimer::timeout, this, &NetworkManager::flushStore);
+    clock.start();
 }
 
 NetworkManager::~NetworkManager() {
-    if (neighborSocket) {
-        neighborSocket->disconnectFromHost();
+    // Links persist their outbound queues as they are destroyed
+    qDeleteAll(links);
+    qDeleteAll(deliveryTrackers);
+    
+    if (transport) {
+        transport->close();
+    }
+}
+
+void NetworkManager::setNodeId(const QString& nodeId) {
+    this->nodeId = nodeId;
+    nodeIdUtf8 = nodeId.toUtf8();
+    selfHandle = nodeTable.handleOf(nodeId);
+}
+
+bool NetworkManager::setTransportBackend(Transport::Backend backend) {
+    if (!Transport::isAvailable(backend)) {
+        qDebug() << "The" << Transport::backendName(backend) << "transport is not available on this platform";
+        return false;
     }
-    if (server) {
-        server->close();
+    if (transport && transport->backend() != backend) {
+        qDebug() << "The transport has to be chosen before the server starts";
+        return false;
     }
+    transportBackend = backend;
+    return true;
 }
 
-bool NetworkManager::startServer(int port) {
-    if (server) {
-        server->close();
-        delete server;
+Transport* NetworkManager::ensureTransport() {
+    if (!transport) {
+        transport = Transport::create(transportBackend, this);
+        if (!transport) {
+            qDebug() << "The" << Transport::backendName(transportBackend) << "transport failed, using qt";
+            transport = Transport::create(Transport::QtSockets, this);
+        }
+        connect(transport, &Transport::newConnection, this, &NetworkManager::onNewConnection);
+        qDebug() << "Using the" << Transport::backendName(transport->backend()) << "transport";
     }
-    
-    server = new QTcpServer(this);
-    connect(server, &QTcpServer::newConnection, this, &NetworkManager::onNewConnection);
-    
-    if (!server->listen(QHostAddress::LocalHost, port)) {
-        qDebug() << "Failed to start server on port" << port << ":" << server->errorString();
+    return transport;
+}
+
+bool NetworkManager::startServer(int port, const QHostAddress& address) {
+    ensureTransport()->close();
+    if (!transport->listen(address, quint16(port))) {
+        qDebug() << "Failed to start server on" << address.toString() << "port" << port << ":" << transport->errorString();
         return false;
     }
     
     serverPort = port;
-    qDebug() << "Server started on port" << port;
+    qDebug() << "Server started on" << address.toString() << "port" << port;
     return true;
 }
 
-void NetworkManager::connectToNeighbor(const QString& host, int port) {
-    neighborHost = host;
-    neighborPort = port;
+void NetworkManager::setRingTopology(const RingConfig& ring) {
+    this->ring = ring;
+    int selfIndex = ring.indexOfNode(nodeId);
     
-    if (neighborSocket) {
-        neighborSocket->disconnectFromHost();
-        neighborSocket->deleteLater();
+    // Ring members get the same wire handles on every node
+    QStringList previousNames;
+    for (int handle = 0; handle < nodeTable.size(); ++handle) {
+        previousNames.append(nodeTable.nameOf(handle));
     }
+    nodeTable.setRingMembers(ring.nodeIds());
+    selfHandle = nodeTable.handleOf(nodeId);
+    remapNodeState(previousNames);
+    
+    qDeleteAll(links);
+    links.clear();
     
-    neighborSocket = new QTcpSocket(this);
-    connect(neighborSocket, &QTcpSocket::connected, this, &NetworkManager::connectionEstablished);
-    connect(neighborSocket, &QTcpSocket::readyRead, this, &NetworkManager::onDataReceived);
-    connect(neighborSocket, &QTcpSocket::disconnected, this, &NetworkManager::onDisconnected);
-    connect(neighborSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
-            this, &NetworkManager::onConnectionError);
+    if (selfIndex == -1) {
+        qDebug() << "Node" << nodeId << "is not a member of the configured ring";
+        return;
+    }
     
-    qDebug() << "Attempting to connect to neighbor at" << host << ":" << port;
-    neighborSocket->connectToHost(host, port);
+    router.configure(ring.size(), selfIndex, routingMode);
+    for (int peerIndex : router.neighbors()) {
+        const RingMember& peer = ring.member(peerIndex);
+        // Add delay before connecting to allow all servers to start
+        createLink(peerIndex, peer)->connectTo(peer.host, peer.port, 2000);
+    }
+}
+
+void NetworkManager::remapNodeState(const QStringList& previousNames) {
+    // Handles change when the ring is set, so state restored or built up before then follows its node
+    QVector<int> handles;
+    handles.reserve(previousNames.size());
+    for (const QString& name : previousNames) {
+        handles.append(name.isEmpty() ? NodeTable::InvalidHandle : nodeTable.intern(name));
+    }
+    remapHandles(lastSequenceNumbers, handles);
+    remapHandles(reorderBuffers, handles);
+    remapHandles(retransmitBuffers, handles);
+    remapHandles(nackBudgets, handles);
+    // Trackers are owned here, so any whose node has no handle any more is deleted rather than dropped
+    for (int old = 0; old < deliveryTrackers.size(); ++old) {
+        if (old >= handles.size() || handles[old] == NodeTable::InvalidHandle) {
+            delete deliveryTrackers[old];
+        }
+    }
+    remapHandles(deliveryTrackers, handles);
+    remapHandles(gaps, handles);
+    remapHandles(pendingAcks, handles);
 }
 
-void NetworkManager::setRingTopology(const QList<int>& ports, int currentPort) {
-    ringPorts = ports;
-    currentPortIndex = ringPorts.indexOf(currentPort);
+PeerLink* NetworkManager::createLink(int peerIndex, const RingMember& peer) {
+    PeerLink* link = new PeerLink(peerIndex, peer.nodeId, ensureTransport(), this);
+    link->getBatcher()->setWindowUsec(batchWindowUsec);
+    link->getBatcher()->setMaxBatchBytes(batchMaxBytes);
     
-    if (currentPortIndex != -1 && !ringPorts.isEmpty()) {
-        int nextIndex = (currentPortIndex + 1) % ringPorts.size();
-        int nextPort = ringPorts[nextIndex];
-        
-        if (nextPort != currentPort) {
-            // Add delay before connecting to allow all servers to start
-            QTimer::singleShot(2000, this, [this, nextPort]() {
-                connectToNeighbor("localhost", nextPort);
-            });
+    OutboundQueue& queue = link->getQueue();
+    queue.setPolicy(queuePolicy);
+    queue.setMemoryLimit(queueMemoryLimit);
+    queue.setDiskLimit(queueDiskLimit);
+    if (!queueDirectory.isEmpty()) {
+        queue.open(QDir(queueDirectory).filePath(QString("outbound-%1-%2.log").arg(nodeId, peer.nodeId)));
+    }
+    
+    connect(link, &PeerLink::connected, this, &NetworkManager::onLinkConnected);
+    connect(link, &PeerLink::disconnected, this, &NetworkManager::onLinkDisconnected);
+    connect(link, &PeerLink::readyRead, this, &NetworkManager::onLinkReadyRead);
+    connect(link, &PeerLink::bytesWritten, this, &NetworkManager::onLinkBytesWritten);
+    connect(link->getBatcher(), &FrameBatcher::batchFlushed, this, &NetworkManager::batchFlushed);
+    connect(link->getBatcher(), &FrameBatcher::batchFlushed, this, [this](int frames, int bytes) {
+        metrics.framesSent.fetchAndAddRelaxed(quint64(frames));
+        metrics.bytesSent.fetchAndAddRelaxed(quint64(bytes));
+    });
+    
+    links.insert(peerIndex, link);
+    updateQueueGauge();
+    return link;
+}
+
+PeerLink* NetworkManager::linkForConnection(Connection* connection) const {
+    for (PeerLink* link : links) {
+        if (link->getConnection() == connection) {
+            return link;
         }
     }
+    return nullptr;
+}
+
+PeerLink* NetworkManager::linkTowards(int destinationHandle) const {
+    // A destination outside the ring can only be found by going all the way round
+    int hop = nodeTable.isShared(destinationHandle) ? router.nextHop(destinationHandle) : router.successor();
+    return links.value(hop, nullptr);
+}
+
+QString NetworkManager::getNextHopForDestination(const QString& destination) const {
+    if (destination == nodeId) {
+        return QString();
+    }
+    PeerLink* link = linkTowards(nodeTable.handleOf(destination));
+    return link ? link->getPeerId() : QString();
+}
+
+int NetworkManager::getNeighborWireVersion() const {
+    PeerLink* link = links.value(router.successor(), nullptr);
+    return link ? link->getWireVersion() : WireFormat::LegacyVersion;
+}
+
+void NetworkManager::setBatchWindowUsec(int usec) {
+    batchWindowUsec = usec;
+    for (PeerLink* link : links) {
+        link->getBatcher()->setWindowUsec(usec);
+    }
+}
+
+void NetworkManager::setBatchMaxBytes(int bytes) {
+    batchMaxBytes = bytes;
+    for (PeerLink* link : links) {
+        link->getBatcher()->setMaxBatchBytes(bytes);
+    }
+}
+
+FrameBatcher::Stats NetworkManager::getBatchStats() const {
+    FrameBatcher::Stats total;
+    for (PeerLink* link : links) {
+        const FrameBatcher::Stats& stats = link->getBatcher()->stats();
+        total.batches += stats.batches;
+        total.frames += stats.frames;
+        total.bytes += stats.bytes;
+        total.largestBatchFrames = qMax(total.largestBatchFrames, stats.largestBatchFrames);
+    }
+    return total;
+}
+
+void NetworkManager::setOutboundQueuePolicy(OutboundQueue::OverflowPolicy policy) {
+    queuePolicy = policy;
+    for (PeerLink* link : links) {
+        link->getQueue().setPolicy(policy);
+    }
+}
+
+void NetworkManager::setOutboundQueueLimits(qint64 memoryBytes, qint64 diskBytes) {
+    queueMemoryLimit = memoryBytes;
+    queueDiskLimit = diskBytes;
+    for (PeerLink* link : links) {
+        link->getQueue().setMemoryLimit(memoryBytes);
+        link->getQueue().setDiskLimit(diskBytes);
+    }
+}
+
+void NetworkManager::updateQueueGauge() {
+    metrics.queuedFrames.storeRelaxed(getOutboundQueueSize());
+}
+
+int NetworkManager::getOutboundQueueSize() const {
+    int size = 0;
+    for (PeerLink* link : links) {
+        size += link->getQueue().size();
+    }
+    return size;
+}
+
+bool NetworkManager::openMessageStore(const QString& directory) {
+    if (!store.open(QDir(directory).filePath(nodeId))) {
+        return false;
+    }
+    
+    const QMap<QString, int> next = store.nextSendSequences();
+    for (auto it = next.constBegin(); it != next.constEnd(); ++it) {
+        atHandle(lastSequenceNumbers, nodeTable.intern(it.key())) = it.value() - 1;
+    }
+    const QMap<QString, int> expected = store.nextExpectedSequences();
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        atHandle(reorderBuffers, nodeTable.intern(it.key())) = ReorderBuffer(ReorderBuffer::DefaultWindow, it.value());
+    }
+    qDebug() << "Restored sequence state for" << next.size() << "destinations and"
+             << expected.size() << "origins";
+    return true;
+}
+
+void NetworkManager::onLinkConnected() {
+    PeerLink* link = qobject_cast<PeerLink*>(sender());
+    if (!link) return;
+    if (link->getConnectionCount() > 1) {
+        metrics.reconnects.fetchAndAddRelaxed(1);
+    }
+    
+    // Start in the legacy format and offer an upgrade; a legacy neighbor drops the hello as invalid
+    if (preferredWireVersion > WireFormat::LegacyVersion) {
+        WireFormat::encodeHello(WireFormat::HelloFrame, quint8(preferredWireVersion), nodeId, nodeTable,
+                                link->getBatcher()->beginFrame());
+        link->getBatcher()->endFrame();
+    }
+    
+    emit connectionEstablished(link->getPeerId());
+    
+    if (!link->getQueue().isEmpty()) {
+        qDebug() << "Replaying" << link->getQueue().size() << "queued frames to" << link->getPeerId();
+        drainOutboundQueue(link);
+    }
+}
+
+void NetworkManager::onLinkDisconnected() {
+    PeerLink* link = qobject_cast<PeerLink*>(sender());
+    if (link) {
+        emit connectionLost(link->getPeerId());
+    }
+}
+
+void NetworkManager::onLinkReadyRead() {
+    PeerLink* link = qobject_cast<PeerLink*>(sender());
+    if (link && link->getConnection()) {
+        processReceivedData(link->getConnection(), link->getReceiveBuffer());
+    }
+}
+
+void NetworkManager::onLinkBytesWritten() {
+    PeerLink* link = qobject_cast<PeerLink*>(sender());
+    if (link && !link->getQueue().isEmpty()) {
+        drainOutboundQueue(link);
+    }
 }
 
 void NetworkManager::sendMessage(const Message& message) {
@@ -85,202 +374,624 @@ void NetworkManager::sendMessage(const Message& message) {
     
     // Create message with proper sequence number (per destination)
     Message msgToSend = message;
-    msgToSend.setOrigin(nodeId); // Ensure origin is set to current node
+    msgToSend.setOriginUtf8(nodeIdUtf8); // Ensure origin is set to current node
     
-    const QString& destination = msgToSend.getDestination();
-    if (!nextSequenceNumbers.contains(destination)) {
-        nextSequenceNumbers[destination] = 1;
-    }
+    int destination = nodeTable.intern(msgToSend.getDestination());
+    msgToSend.setHandles(selfHandle, destination);
+    msgToSend.setSequenceNumber(++atHandle(lastSequenceNumbers, destination));
     
-    msgToSend.setSequenceNumber(nextSequenceNumbers[destination]++);
+    SC_LOG(Trace, "send", LogField("to", msgToSend.destinationUtf8()),
+           LogField("seq", msgToSend.getSequenceNumber()));
     
-    qDebug() << "Sending message from" << msgToSend.getOrigin() 
-             << "to" << msgToSend.getDestination() 
-             << "with sequence number" << msgToSend.getSequenceNumber();
+    // Recorded before it leaves, so the number is never handed out twice
+    storeMessage(MessageStore::Sent, msgToSend);
     
-    if (msgToSend.getDestination() == nodeId) {
+    if (msgToSend.destinationUtf8() == nodeIdUtf8) {
         deliverMessage(msgToSend);
+        return;
+    }
+    
+    if (timestampsEnabled) {
+        msgToSend.setTimestamp(wallClockUsec());
+    }
+    if (traceInterval > 0 && ++sentSinceTrace >= traceInterval) {
+        sentSinceTrace = 0;
+        msgToSend.setTraced(true);
+        msgToSend.addTraceHop(quint16(selfHandle), monotonicUsec());
+    }
+    DeliveryTracker*& tracker = atHandle(deliveryTrackers, destination);
+    if (!tracker) {
+        tracker = new DeliveryTracker();
+    }
+    tracker->messageSent(msgToSend.getSequenceNumber(), clock.nsecsElapsed() / 1000);
+    
+    atHandle(retransmitBuffers, destination).add(msgToSend);
+    if (!forwardMessage(msgToSend)) {
+        emit sendRejected(msgToSend);
+    }
+}
+
+bool NetworkManager::forwardMessage(const Message& message) {
+    int destination = message.destinationHandle();
+    if (destination == NodeTable::InvalidHandle) {
+        // Legacy frames and inline names carry no handle
+        destination = nodeTable.handleOfUtf8(message.destinationUtf8());
+    }
+    PeerLink* link = linkTowards(destination);
+    if (!link) {
+        SC_LOG(Debug, "no-route", LogField("to", message.destinationUtf8()));
+        return false;
+    }
+    
+    // Anything already queued goes first, so new traffic joins the back of the queue
+    if (!link->isConnected() || !link->getQueue().isEmpty()) {
+        SC_LOG(Trace, "queue", LogField("to", message.destinationUtf8()), LogField("via", link->getPeerId()));
+        QByteArray frame;
+        WireFormat::encodeMessage(message, nodeTable, frame);
+        return enqueueOutbound(link, frame);
+    }
+    
+    // Encode straight into the outgoing batch behind its length prefix
+    QByteArray& batch = link->getBatcher()->beginFrame();
+    if (link->getWireVersion() > WireFormat::LegacyVersion) {
+        WireFormat::encodeMessage(message, nodeTable, batch);
     } else {
-        forwardMessage(msgToSend);
+        WireFormat::encodeLegacy(message, batch);
     }
+    link->getBatcher()->endFrame();
+    
+    SC_LOG(Trace, "forward", LogField("from", message.originUtf8()), LogField("to", message.destinationUtf8()),
+           LogField("seq", message.getSequenceNumber()), LogField("via", link->getPeerId()));
+    return true;
 }
 
-void NetworkManager::forwardMessage(const Message& message) {
-    if (!neighborSocket || neighborSocket->state() != QAbstractSocket::ConnectedState) {
-        qDebug() << "No connection to neighbor, queuing message. Socket state:" 
-                 << (neighborSocket ? neighborSocket->state() : -1);
-        messageQueue.enqueue(message);
+void NetworkManager::forwardFrame(const char* data, int size, quint8 version, bool traced, int destinationHandle) {
+    PeerLink* link = linkTowards(destinationHandle);
+    if (!link) {
+        SC_LOG(Debug, "no-route", LogField("to", nodeTable.utf8NameOf(destinationHandle)), LogField("bytes", size));
         return;
     }
     
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream << message;
+    if (!link->isConnected() || !link->getQueue().isEmpty()) {
+        // Queued frames are kept in the binary format, so transit frames can wait as they are
+        QByteArray frame(data, size);
+        if (traced) {
+            WireFormat::appendTraceHop(frame, quint16(selfHandle), monotonicUsec());
+        }
+        enqueueOutbound(link, frame);
+        return;
+    }
     
-    QByteArray sizeData;
-    QDataStream sizeStream(&sizeData, QIODevice::WriteOnly);
-    sizeStream << (quint32)data.size();
+    if (link->getWireVersion() >= version) {
+        if (traced) {
+            // Still no decode: copy the frame into the batch and add this hop at its end
+            QByteArray& batch = link->getBatcher()->beginFrame();
+            batch.append(data, size);
+            WireFormat::appendTraceHop(batch, quint16(selfHandle), monotonicUsec());
+            link->getBatcher()->endFrame();
+            return;
+        }
+        // Cut-through: pass the original bytes on untouched
+        link->getBatcher()->enqueue(data, size);
+        return;
+    }
     
-    neighborSocket->write(sizeData);
-    neighborSocket->write(data);
-    neighborSocket->flush();
+    // The neighbor still speaks the legacy format, so decode and re-encode
+    Message message;
+    if (WireFormat::decodeMessage(data, size, nodeTable, message) && message.isValid()) {
+        if (traced) {
+            message.addTraceHop(quint16(selfHandle), monotonicUsec());
+        }
+        forwardMessage(message);
+    }
+}
+
+bool NetworkManager::enqueueOutbound(PeerLink* link, const QByteArray& frame) {
+    OutboundQueue& queue = link->getQueue();
+    if (!queue.enqueue(frame)) {
+        SC_LOG(Debug, "queue-full", LogField("via", link->getPeerId()),
+               LogField("dropped", queue.droppedFrames()));
+        return false;
+    }
+    updateQueueGauge();
+    return true;
+}
+
+void NetworkManager::drainOutboundQueue(PeerLink* link) {
+    static const qint64 DrainHighWaterMark = 1024 * 1024;
+    
+    // Replay in order, pausing whenever the socket has enough unsent data; bytesWritten resumes it
+    OutboundQueue& queue = link->getQueue();
+    while (!queue.isEmpty() && link->isConnected()) {
+        if (link->getConnection()->bytesToWrite() > DrainHighWaterMark) {
+            return;
+        }
+        QByteArray frame = queue.dequeue();
+        if (frame.isEmpty()) {
+            // Nothing could be read back (a damaged segment); stop rather than spin
+            break;
+        }
+        writeQueuedFrame(link, frame);
+    }
+    link->getBatcher()->flush();
+    updateQueueGauge();
+}
+
+void NetworkManager::writeQueuedFrame(PeerLink* link, const QByteArray& frame) {
+    WireFormat::FrameHeader header;
+    if (!WireFormat::readHeader(frame.constData(), frame.size(), header)) {
+        // Staged in the legacy format before a reconnect; every neighbor reads that
+        if (!WireFormat::isBinaryFrame(frame.constData(), frame.size())) {
+            link->getBatcher()->enqueue(frame.constData(), frame.size());
+        }
+        return;
+    }
+    
+    if (link->getWireVersion() >= header.version) {
+        link->getBatcher()->enqueue(frame.constData(), frame.size());
+        return;
+    }
+    
+    Message message;
+    if (WireFormat::decodeMessage(frame.constData(), frame.size(), nodeTable, message)) {
+        QByteArray& batch = link->getBatcher()->beginFrame();
+        WireFormat::encodeLegacy(message, batch);
+        link->getBatcher()->endFrame();
+    }
+}
+
+void NetworkManager::writeFrame(Connection* connection, const char* data, int size) {
+    char prefix[sizeof(quint32)];
+    qToBigEndian(quint32(size), prefix);
     
-    qDebug() << "Forwarded message from" << message.getOrigin() << "to" << message.getDestination() 
-             << "via" << neighborHost << ":" << neighborPort;
+    QByteArray frame;
+    frame.reserve(int(sizeof(prefix)) + size);
+    frame.append(prefix, sizeof(prefix));
+    frame.append(data, size);
+    connection->write(frame);
+    // Batched frames are counted as their batch is flushed
+    metrics.framesSent.fetchAndAddRelaxed(1);
+    metrics.bytesSent.fetchAndAddRelaxed(quint64(frame.size()));
 }
 
 void NetworkManager::deliverMessage(const Message& message) {
+    metrics.delivered.fetchAndAddRelaxed(1);
+    storeMessage(MessageStore::Received, message);
     emit messageReceived(message);
 }
 
-void NetworkManager::onNewConnection() {
-    while (server->hasPendingConnections()) {
-        QTcpSocket* clientSocket = server->nextPendingConnection();
-        connect(clientSocket, &QTcpSocket::readyRead, this, &NetworkManager::onDataReceived);
-        connect(clientSocket, &QTcpSocket::disconnected, clientSocket, &QTcpSocket::deleteLater);
-        
-        socketBuffers[clientSocket] = QByteArray();
-        qDebug() << "New client connected from" << clientSocket->peerAddress().toString();
+void NetworkManager::storeMessage(MessageStore::Direction direction, const Message& message) {
+    store.append(direction, message);
+    if (store.hasUnflushed() && !storeTimer->isActive()) {
+        storeTimer->start(StoreFlushMsec);
     }
 }
 
+void NetworkManager::flushStore() {
+    store.flush();
+}
+
+void NetworkManager::onNewConnection(Connection* connection) {
+    connect(connection, &Connection::readyRead, this, &NetworkManager::onDataReceived);
+    connect(connection, &Connection::disconnected, this, &NetworkManager::onDisconnected);
+    connect(connection, &Connection::disconnected, connection, &QObject::deleteLater);
+    
+    connectionBuffers[connection] = ReceiveBuffer();
+    qDebug() << "New client connected from" << connection->peerAddress();
+}
+
 void NetworkManager::onDataReceived() {
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
-    if (!socket) return;
+    Connection* connection = qobject_cast<Connection*>(sender());
+    if (!connection) return;
     
-    processReceivedData(socket);
+    processReceivedData(connection, connectionBuffers[connection]);
 }
 
-void NetworkManager::processReceivedData(QTcpSocket* socket) {
-    QByteArray& buffer = socketBuffers[socket];
-    buffer.append(socket->readAll());
+void NetworkManager::processReceivedData(Connection* connection, ReceiveBuffer& buffer) {
+    connection->readInto(buffer);
     
-    while (buffer.size() >= sizeof(quint32)) {
-        QDataStream sizeStream(buffer);
-        quint32 messageSize;
-        sizeStream >> messageSize;
-        
-        if (buffer.size() < sizeof(quint32) + messageSize) {
-            break;
+    // Frames are parsed in place; nothing is copied or shifted per frame
+    const char* frame;
+    int frameSize;
+    while (buffer.nextFrame(frame, frameSize)) {
+        metrics.framesReceived.fetchAndAddRelaxed(1);
+        metrics.bytesReceived.fetchAndAddRelaxed(quint64(ReceiveBuffer::PrefixSize + frameSize));
+        processFrame(connection, frame, frameSize);
+    }
+    if (buffer.hasError()) {
+        // Nothing after a bad length prefix can be framed again
+        metrics.decodeErrors.fetchAndAddRelaxed(1);
+        SC_LOG(Warning, "oversized-frame", LogField("peer", connection->peerAddress()));
+        connection->disconnectFromHost();
+    }
+}
+
+void NetworkManager::processFrame(Connection* connection, const char* data, int size) {
+    qint64 frameStart = clock.nsecsElapsed();
+    Message message;
+    bool decoded;
+    if (WireFormat::isBinaryFrame(data, size)) {
+        WireFormat::FrameHeader header;
+        if (!WireFormat::readHeader(data, size, header)) {
+            return;
         }
-        
-        buffer.remove(0, sizeof(quint32));
-        QByteArray messageData = buffer.left(messageSize);
-        buffer.remove(0, messageSize);
-        
-        QDataStream messageStream(messageData);
-        Message message;
-        messageStream >> message;
-        
-        if (message.isValid()) {
-            qDebug() << "Received message from" << message.getOrigin() 
-                     << "to" << message.getDestination() 
-                     << "with sequence number" << message.getSequenceNumber();
-            
-            if (message.getDestination() == nodeId) {
-                // Process message with sequence ordering
-                processOrderedMessage(message);
-            } else {
-                // Forward message to next hop in ring
-                forwardMessage(message);
+        if (!WireFormat::isRoutedType(header.type)) {
+            processControlFrame(connection, data, size);
+            return;
+        }
+        int destination;
+        if (peekDestinationHandle(data, size, destination) && destination != selfHandle) {
+            if (isUnroutable(header.origin, destination)) {
+                SC_LOG(Debug, "unroutable", LogField("to", nodeTable.utf8NameOf(destination)), LogField("bytes", size));
+                return;
             }
+            // Transit traffic only needs the destination, so skip the full decode
+            bool traced = header.type == WireFormat::ChatFrame && (header.flags & WireFormat::Traced);
+            forwardFrame(data, size, header.version, traced, destination);
+            recordForward(frameStart);
+            return;
+        }
+        if (header.type == WireFormat::NackFrame) {
+            processNack(data, size);
+            return;
+        }
+        if (header.type == WireFormat::AckFrame) {
+            processAck(data, size);
+            return;
         }
+        decoded = WireFormat::decodeMessage(data, size, nodeTable, message);
+    } else {
+        decoded = WireFormat::decodeLegacy(data, size, message);
     }
-}
-
-void NetworkManager::onDisconnected() {
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
-    if (socket) {
-        socketBuffers.remove(socket);
+    metrics.decodeNsec.record(quint64(clock.nsecsElapsed() - frameStart));
+    if (!decoded) {
+        metrics.decodeErrors.fetchAndAddRelaxed(1);
+        SC_LOG(Debug, "decode-error", LogField("bytes", size));
+        return;
+    }
+    
+    if (message.isValid()) {
+        SC_LOG(Trace, "recv", LogField("from", message.originUtf8()), LogField("to", message.destinationUtf8()),
+               LogField("seq", message.getSequenceNumber()));
         
-        if (socket == neighborSocket) {
-            qDebug() << "Lost connection to neighbor, will retry";
-            emit connectionLost();
-            retryTimer->start(3000);
+        if (message.destinationUtf8() == nodeIdUtf8) {
+            if (message.isTraced()) {
+                message.addTraceHop(quint16(selfHandle), monotonicUsec());
+                traceWriter.write(message, nodeTable);
+            }
+            // Process message with sequence ordering
+            int origin = message.originHandle();
+            if (origin == NodeTable::InvalidHandle) {
+                origin = nodeTable.handleOfUtf8(message.originUtf8());
+            }
+            if (origin == NodeTable::InvalidHandle) {
+                if (!nodeTable.hasLocalRoom()) {
+                    SC_LOG(Debug, "unknown-origin", LogField("from", message.originUtf8()));
+                    return;
+                }
+                origin = nodeTable.intern(message.getOrigin());
+            }
+            processOrderedMessage(std::move(message), origin);
+        } else {
+            int origin = message.originHandle();
+            if (origin == NodeTable::InvalidHandle) {
+                origin = nodeTable.handleOfUtf8(message.originUtf8());
+            }
+            int destination = message.destinationHandle();
+            if (destination == NodeTable::InvalidHandle) {
+                destination = nodeTable.handleOfUtf8(message.destinationUtf8());
+            }
+            if (isUnroutable(origin, destination)) {
+                SC_LOG(Debug, "unroutable", LogField("from", message.originUtf8()),
+                       LogField("to", message.destinationUtf8()));
+                return;
+            }
+            // Relays add their hop here as the cut-through path does, so decoded frames keep a full timeline
+            if (message.isTraced()) {
+                message.addTraceHop(quint16(selfHandle), monotonicUsec());
+            }
+            // Forward message to next hop in ring
+            forwardMessage(message);
+            recordForward(frameStart);
         }
     }
 }
 
-void NetworkManager::onConnectionError() {
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
-    if (socket == neighborSocket) {
-        qDebug() << "Connection error:" << socket->errorString();
-        retryTimer->start(3000);
+void NetworkManager::recordForward(qint64 frameStart) {
+    metrics.forwarded.fetchAndAddRelaxed(1);
+    metrics.forwardNsec.record(quint64(clock.nsecsElapsed() - frameStart));
+}
+
+bool NetworkManager::isUnroutable(int origin, int destination) const {
+    // A destination outside the ring goes all the way round in case some node there
+    // knows it. Back at its origin it has passed every node, and a frame whose
+    // origin is not a member has no origin to stop it, so either would circle forever.
+    return !nodeTable.isShared(destination) && (origin == selfHandle || !nodeTable.isShared(origin));
+}
+
+bool NetworkManager::peekDestinationHandle(const char* data, int size, int& destination) const {
+    quint16 handle;
+    const char* name;
+    int nameSize;
+    if (!WireFormat::peekDestination(data, size, handle, name, nameSize)) {
+        // Let the full decode reject it
+        return false;
     }
+    
+    if (handle != WireFormat::InlineHandle) {
+        destination = handle;
+        return true;
+    }
+    // Only names outside the ring travel inline, so anything but our own name has no ring handle
+    bool isSelf = nameSize == nodeIdUtf8.size() && std::memcmp(name, nodeIdUtf8.constData(), nameSize) == 0;
+    destination = isSelf ? selfHandle : NodeTable::InvalidHandle;
+    return true;
 }
 
-void NetworkManager::retryConnection() {
-    if (!neighborHost.isEmpty() && neighborPort > 0) {
-        qDebug() << "Retrying connection to neighbor" << neighborHost << ":" << neighborPort;
-        connectToNeighbor(neighborHost, neighborPort);
+void NetworkManager::processControlFrame(Connection* connection, const char* data, int size) {
+    WireFormat::FrameHeader header;
+    WireFormat::readHeader(data, size, header);
+    
+    if (header.type == WireFormat::HelloFrame) {
+        // Answer with the highest version both sides understand
+        QString peer;
+        WireFormat::decodeHelloOrigin(data, size, nodeTable, peer);
+        quint8 version = qMin(header.version, WireFormat::Version);
+        
+        QByteArray ack;
+        WireFormat::encodeHello(WireFormat::HelloAckFrame, version, nodeId, nodeTable, ack);
+        writeFrame(connection, ack.constData(), ack.size());
+        qDebug() << "Negotiated wire version" << version << "with" << peer;
+    } else if (header.type == WireFormat::HelloAckFrame) {
+        if (PeerLink* link = linkForConnection(connection)) {
+            link->setWireVersion(qMin(header.version, quint8(preferredWireVersion)));
+            qDebug() << "Link to" << link->getPeerId() << "upgraded to wire version" << link->getWireVersion();
+        }
     }
 }
 
-void NetworkManager::addPeer(const QString& peerId, int port) {
-    peerPorts[peerId] = port;
+void NetworkManager::onDisconnected() {
+    Connection* connection = qobject_cast<Connection*>(sender());
+    if (connection) {
+        connectionBuffers.remove(connection);
+    }
 }
 
 // Sequence ordering mechanism implementation
-void NetworkManager::processOrderedMessage(const Message& message) {
-    const QString& origin = message.getOrigin();
+void NetworkManager::processOrderedMessage(Message message, int originHandle) {
     int sequenceNumber = message.getSequenceNumber();
     
-    // Initialize expected sequence number for new origin
-    if (!expectedSequenceNumbers.contains(origin)) {
-        expectedSequenceNumbers[origin] = 1;
+    // A new origin starts out expecting sequence number 1
+    ReorderBuffer& buffer = atHandle(reorderBuffers, originHandle);
+    
+    // Reused from call to call, so releasing messages does not allocate
+    QVector<Message>& ready = releasedMessages;
+    ready.clear();
+    int bufferedBefore = buffer.buffered();
+    switch (buffer.insert(std::move(message), ready)) {
+    case ReorderBuffer::Delivered:
+        break;
+    case ReorderBuffer::Buffered:
+        SC_LOG(Debug, "out-of-order", LogField("from", nodeTable.utf8NameOf(originHandle)),
+               LogField("seq", sequenceNumber), LogField("expected", buffer.expected()));
+        break;
+    case ReorderBuffer::Duplicate:
+        SC_LOG(Debug, "duplicate", LogField("from", nodeTable.utf8NameOf(originHandle)),
+               LogField("seq", sequenceNumber));
+        break;
+    case ReorderBuffer::OutOfWindow:
+        // It will be NACKed and sent again
+        SC_LOG(Debug, "beyond-window", LogField("from", nodeTable.utf8NameOf(originHandle)),
+               LogField("seq", sequenceNumber), LogField("expected", buffer.expected()));
+        break;
+    }
+    metrics.reorderBuffered.fetchAndAddRelaxed(buffer.buffered() - bufferedBefore);
+    
+    for (const Message& inOrder : ready) {
+        deliverMessage(inOrder);
+    }
+    if (!ready.isEmpty()) {
+        scheduleAck(originHandle, buffer.expected() - 1, ready.last());
+    }
+    // Drop the references now so pooled payload buffers can be reused
+    ready.clear();
+    trackGap(originHandle);
+}
+
+void NetworkManager::trackGap(int origin) {
+    const ReorderBuffer& buffer = reorderBuffers[origin];
+    if (!buffer.hasGap()) {
+        gaps.remove(origin);
+        return;
     }
     
-    if (isSequenceExpected(message)) {
-        // Deliver message immediately if it's the expected sequence
-        qDebug() << "Delivering message with expected sequence" << sequenceNumber 
-                 << "from" << origin;
-        deliverMessage(message);
+    GapState& gap = gaps[origin];
+    if (gap.expected != buffer.expected()) {
+        // A new gap, or progress on the old one: give it a moment to fill by itself
+        gap.expected = buffer.expected();
+        gap.nextNackAt = clock.elapsed() + NackDelayMsec;
+        gap.nacksSent = 0;
+    }
+    if (!gapTimer->isActive()) {
+        gapTimer->start(GapCheckIntervalMsec);
+    }
+}
+
+void NetworkManager::onGapTimer() {
+    qint64 now = clock.elapsed();
+    QVector<int> skipped;
+    for (auto it = gaps.begin(); it != gaps.end();) {
+        int origin = it.key();
+        GapState& gap = it.value();
+        if (now < gap.nextNackAt) {
+            ++it;
+            continue;
+        }
         
-        // Update expected sequence number
-        expectedSequenceNumbers[origin] = sequenceNumber + 1;
+        ReorderBuffer& buffer = reorderBuffers[origin];
+        if (gap.nacksSent < MaxNackAttempts) {
+            sendNack(origin, buffer.missingRanges(MaxNackRanges));
+            ++gap.nacksSent;
+            gap.nextNackAt = now + NackRetryMsec;
+            ++it;
+            continue;
+        }
         
-        // Check for any pending messages that can now be delivered
-        deliverPendingMessages(origin);
-    } else {
-        // Store message for later delivery
-        qDebug() << "Storing out-of-order message with sequence" << sequenceNumber 
-                 << "from" << origin << "(expected:" << expectedSequenceNumbers[origin] << ")";
-        pendingMessages[origin][sequenceNumber] = message;
+        // The origin never filled the gap; deliver what is behind it rather than stall forever
+        QVector<Message> ready;
+        int bufferedBefore = buffer.buffered();
+        SequenceRange lost;
+        lost.first = buffer.expected();
+        lost.length = buffer.skipGap(ready);
+        metrics.reorderBuffered.fetchAndAddRelaxed(buffer.buffered() - bufferedBefore);
+        SC_LOG(Info, "gap-skipped", LogField("origin", nodeTable.nameOf(origin)),
+               LogField("first", lost.first), LogField("lost", lost.length));
+        for (const Message& inOrder : ready) {
+            deliverMessage(inOrder);
+        }
+        if (!ready.isEmpty()) {
+            // The skipped range rides along so the sender does not count it as delivered
+            QVector<SequenceRange>& skippedRanges = pendingAcks[origin].skipped;
+            if (lost.length > 0) {
+                if (skippedRanges.size() >= MaxNackRanges) {
+                    skippedRanges.removeFirst();
+                }
+                skippedRanges.append(lost);
+            }
+            scheduleAck(origin, buffer.expected() - 1, ready.last());
+        }
+        skipped.append(origin);
+        it = gaps.erase(it);
+    }
+    
+    for (int origin : skipped) {
+        trackGap(origin);
+    }
+    if (gaps.isEmpty()) {
+        gapTimer->stop();
     }
 }
 
-void NetworkManager::deliverPendingMessages(const QString& origin) {
-    if (!pendingMessages.contains(origin)) {
+void NetworkManager::sendNack(int origin, const QVector<SequenceRange>& missing) {
+    PeerLink* link = linkTowards(origin);
+    if (missing.isEmpty() || !link || !link->isConnected() || link->getWireVersion() == WireFormat::LegacyVersion) {
+        // Not worth queuing; the gap timer asks again
         return;
     }
     
-    QMap<int, Message>& originMessages = pendingMessages[origin];
-    int expected = expectedSequenceNumbers[origin];
+    QString originName = nodeTable.nameOf(origin);
+    WireFormat::encodeNack(nodeId, originName, missing, nodeTable, link->getBatcher()->beginFrame());
+    link->getBatcher()->endFrame();
+    SC_LOG(Debug, "nack-sent", LogField("to", nodeTable.utf8NameOf(origin)), LogField("ranges", missing.size()),
+           LogField("first", missing.first().first));
+}
+
+void NetworkManager::processNack(const char* data, int size) {
+    QString requester;
+    QVector<SequenceRange> missing;
+    if (!WireFormat::decodeNack(data, size, nodeTable, requester, missing)) {
+        SC_LOG(Debug, "nack-decode-error", LogField("bytes", size));
+        return;
+    }
     
-    // Deliver consecutive messages starting from expected sequence
-    while (originMessages.contains(expected)) {
-        const Message& pendingMsg = originMessages[expected];
-        qDebug() << "Delivering pending message with sequence" << expected << "from" << origin;
-        
-        deliverMessage(pendingMsg);
-        originMessages.remove(expected);
-        expectedSequenceNumbers[origin] = ++expected;
+    int handle = nodeTable.handleOf(requester);
+    if (handle < 0 || handle >= retransmitBuffers.size() || retransmitBuffers[handle].isEmpty()) {
+        SC_LOG(Debug, "nack-unknown", LogField("from", requester));
+        return;
+    }
+    const RetransmitBuffer& buffer = retransmitBuffers[handle];
+    
+    NackBudget& budget = atHandle(nackBudgets, handle);
+    qint64 nowMsec = clock.elapsed();
+    if (nowMsec - budget.windowStartMsec >= NackBudgetWindowMsec) {
+        budget.windowStartMsec = nowMsec;
+        budget.resent = 0;
     }
     
-    // Clean up empty maps
-    if (originMessages.isEmpty()) {
-        pendingMessages.remove(origin);
+    // Every sequence looked at counts, found or not, so a NACK full of huge ranges stays cheap
+    int allowed = qMin(MaxResendsPerNack, NackResendBudget - budget.resent);
+    int resent = 0;
+    int unavailable = 0;
+    for (const SequenceRange& range : missing) {
+        int length = qMin(range.length, allowed - resent - unavailable);
+        for (int offset = 0; offset < length; ++offset) {
+            Message message;
+            if (buffer.find(range.first + offset, message)) {
+                // Handles are refreshed, since they may predate a ring change
+                message.setHandles(selfHandle, handle);
+                forwardMessage(message);
+                ++resent;
+            } else {
+                ++unavailable;
+            }
+        }
     }
+    budget.resent += resent + unavailable;
+    SC_LOG(Debug, "nack", LogField("from", requester), LogField("resent", resent),
+           LogField("unavailable", unavailable), LogField("capped", resent + unavailable >= allowed));
 }
 
-bool NetworkManager::isSequenceExpected(const Message& message) const {
-    const QString& origin = message.getOrigin();
-    int sequenceNumber = message.getSequenceNumber();
+void NetworkManager::scheduleAck(int origin, int cumulative, const Message& newest) {
+    PendingAck& ack = pendingAcks[origin];
+    ack.cumulative = cumulative;
+    if (newest.getTimestamp() > 0) {
+        ack.oneWayUsec = qMax<qint64>(0, wallClockUsec() - newest.getTimestamp());
+    }
+    if (!ackTimer->isActive()) {
+        ackTimer->start(AckDelayMsec);
+    }
+}
+
+void NetworkManager::flushAcks() {
+    for (auto it = pendingAcks.begin(); it != pendingAcks.end();) {
+        if (sendAck(it.key(), it.value()) || it.value().skipped.isEmpty()) {
+            it = pendingAcks.erase(it);
+        } else {
+            // Cumulative, so the next ACK covers the rest, but the skipped ranges have to wait for it
+            it.value().oneWayUsec = -1;
+            ++it;
+        }
+    }
+}
+
+bool NetworkManager::sendAck(int origin, const PendingAck& ack) {
+    PeerLink* link = linkTowards(origin);
+    if (!link || !link->isConnected() || link->getWireVersion() == WireFormat::LegacyVersion) {
+        return false;
+    }
     
-    if (!expectedSequenceNumbers.contains(origin)) {
-        // First message from this origin should have sequence number 1
-        return sequenceNumber == 1;
+    WireFormat::encodeAck(nodeId, nodeTable.nameOf(origin), ack.cumulative, ack.oneWayUsec, ack.skipped,
+                          nodeTable, link->getBatcher()->beginFrame());
+    link->getBatcher()->endFrame();
+    return true;
+}
+
+void NetworkManager::processAck(const char* data, int size) {
+    QString acker;
+    int cumulative;
+    qint64 oneWayUsec;
+    QVector<SequenceRange> skipped;
+    if (!WireFormat::decodeAck(data, size, nodeTable, acker, cumulative, oneWayUsec, skipped)) {
+        SC_LOG(Debug, "ack-decode-error", LogField("bytes", size));
+        return;
     }
     
-    return sequenceNumber == expectedSequenceNumbers.value(origin);
-}
\ No newline at end of file
+    int handle = nodeTable.handleOf(acker);
+    DeliveryTracker* tracker = handle >= 0 ? deliveryTrackers.value(handle, nullptr) : nullptr;
+    if (!tracker) {
+        return;
+    }
+    int settled = tracker->acknowledge(cumulative, clock.nsecsElapsed() / 1000, oneWayUsec, skipped);
+    SC_LOG(Trace, "ack", LogField("from", acker), LogField("settled", settled), LogField("cumulative", cumulative),
+           LogField("skipped", skipped.size()));
+}
+
+QMap<QString, DeliveryTracker::Stats> NetworkManager::getDeliveryStats() const {
+    QMap<QString, DeliveryTracker::Stats> stats;
+    for (int handle = 0; handle < deliveryTrackers.size(); ++handle) {
+        if (deliveryTrackers[handle]) {
+            stats.insert(nodeTable.nameOf(handle), deliveryTrackers[handle]->stats());
+        }
+    }
+    return stats;
+}
@@ -1,12 +1,26 @@
 #pragma once
 
 #include <QObject>
-#include <QTcpServer>
-#include <QTcpSocket>
+#include <QHostAddress>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QMap>
 #include <QQueue>
 #include "message.h"
+#include "nodetable.h"
+#include "receivebuffer.h"
+#include "reorderbuffer.h"
+#include "retransmitbuffer.h"
+#include "deliverytracker.h"
+#include "framebatcher.h"
+#include "messagestore.h"
+#include "networkmetrics.h"
+#include "outboundqueue.h"
+#include "peerlink.h"
+#include "ringconfig.h"
+#include "tracewriter.h"
+#include "transport.h"
+#include "ringrouter.h"
 
 class NetworkManager : public QObject {
     Q_OBJECT
@@ -15,57 +29,175 @@ public:
     explicit NetworkManager(QObject* parent = nullptr);
     ~NetworkManager();
     
-    bool startServer(int port);
-    void connectToNeighbor(const QString& host, int port);
+    bool startServer(int port, const QHostAddress& address = QHostAddress(QHostAddress::LocalHost));
     void sendMessage(const Message& message);
     
-    void setNodeId(const QString& nodeId) { this->nodeId = nodeId; }
+    // Socket layer for the server and every link; choose it before startServer().
+    // The transport is created on the thread that starts the server.
+    bool setTransportBackend(Transport::Backend backend);
+    Transport::Backend getTransportBackend() const { return transport ? transport->backend() : transportBackend; }
+    
+    void setNodeId(const QString& nodeId);
     QString getNodeId() const { return nodeId; }
     
-    void addPeer(const QString& peerId, int port);
-    void setRingTopology(const QList<int>& ports, int currentPort);
+    // This node must be a member (matched by node ID); it opens a link to every
+    // neighbor the routing mode needs. Set the routing mode first.
+    void setRingTopology(const RingConfig& ring);
+    void setRoutingMode(RingRouter::Mode mode) { routingMode = mode; }
+    RingRouter::Mode getRoutingMode() const { return routingMode; }
+    
+    // Node ID of the member a message for destination is handed to; empty if it stays here
+    QString getNextHopForDestination(const QString& destination) const;
+    
+    // Highest wire format version offered to neighbors (0 keeps the legacy QVariantMap framing)
+    void setPreferredWireVersion(int version) { preferredWireVersion = version; }
+    int getNeighborWireVersion() const;
+    
+    // Outgoing batching: frames queued within the window (0 = same event-loop turn)
+    // or up to the byte threshold go out in a single write
+    void setBatchWindowUsec(int usec);
+    void setBatchMaxBytes(int bytes);
+    FrameBatcher::Stats getBatchStats() const;
+    
+    // Frames for a neighbor that is down wait in <directory>/outbound-<node>-<neighbor>.log
+    // and are replayed in order on reconnect
+    void setOutboundQueueDirectory(const QString& directory) { queueDirectory = directory; }
+    void setOutboundQueuePolicy(OutboundQueue::OverflowPolicy policy);
+    void setOutboundQueueLimits(qint64 memoryBytes, qint64 diskBytes);
+    int getOutboundQueueSize() const;
+    
+    // Stamp outgoing messages with the send time so destinations can report one-way latency
+    // (assumes synchronized clocks); round-trip latency is measured either way
+    void setTimestampsEnabled(bool enabled) { timestampsEnabled = enabled; }
+    
+    // Every Nth message sent from here (0 = none) records a hop at each node it passes;
+    // traced messages that arrive here have their timelines written to the trace file
+    void setTraceInterval(int messages) { traceInterval = messages; }
+    bool openTraceFile(const QString& path) { return traceWriter.open(path); }
+    QMap<QString, DeliveryTracker::Stats> getDeliveryStats() const; // destination -> stats
+    
+    // Counters, gauges and timings safe to read from any thread, e.g. by MetricsServer
+    const NetworkMetrics& getMetrics() const { return metrics; }
+    
+    // Sent and delivered messages are recorded in <directory>/<node>; opening it restores
+    // the sequence counters so peers see numbering continue across a restart
+    bool openMessageStore(const QString& directory);
+    MessageStore& getMessageStore() { return store; }
 
 signals:
     void messageReceived(const Message& message);
-    void connectionEstablished();
-    void connectionLost();
+    void connectionEstablished(const QString& peerId);
+    void connectionLost(const QString& peerId);
+    void batchFlushed(int frames, int bytes);
+    void sendRejected(const Message& message);
 
 private slots:
-    void onNewConnection();
+    void onLinkConnected();
+    void onLinkDisconnected();
+    void onLinkReadyRead();
+    void onLinkBytesWritten();
+    void onNewConnection(Connection* connection);
     void onDataReceived();
     void onDisconnected();
-    void onConnectionError();
-    void retryConnection();
+    void onGapTimer();
+    void flushAcks();
+    void flushStore();
 
 private:
-    void forwardMessage(const Message& message);
+    PeerLink* createLink(int peerIndex, const RingMember& peer);
+    PeerLink* linkForConnection(Connection* connection) const;
+    PeerLink* linkTowards(int destinationHandle) const;
+    bool forwardMessage(const Message& message);
+    void storeMessage(MessageStore::Direction direction, const Message& message);
+    bool enqueueOutbound(PeerLink* link, const QByteArray& frame);
+    void drainOutboundQueue(PeerLink* link);
+    void writeQueuedFrame(PeerLink* link, const QByteArray& frame);
     void deliverMessage(const Message& message);
-    void processReceivedData(QTcpSocket* socket);
-    QString getNextHopForDestination(const QString& destination);
+    void processReceivedData(Connection* connection, ReceiveBuffer& buffer);
+    void processFrame(Connection* connection, const char* data, int size);
+    void processControlFrame(Connection* connection, const char* data, int size);
+    bool peekDestinationHandle(const char* data, int size, int& destination) const;
+    bool isUnroutable(int origin, int destination) const;
+    void forwardFrame(const char* data, int size, quint8 version, bool traced, int destinationHandle);
+    void recordForward(qint64 frameStart);
+    void updateQueueGauge();
+    void writeFrame(Connection* connection, const char* data, int size);
+    Transport* ensureTransport();
     
-    QTcpServer* server;
-    QTcpSocket* neighborSocket;
-    QMap<QTcpSocket*, QByteArray> socketBuffers;
-    QTimer* retryTimer;
+    Transport::Backend transportBackend;
+    Transport* transport;
+    QMap<Connection*, ReceiveBuffer> connectionBuffers;
+    QMap<int, PeerLink*> links; // ring index -> outgoing link
     
     QString nodeId;
     int serverPort;
-    QString neighborHost;
-    int neighborPort;
     
-    QMap<QString, int> peerPorts;
-    QList<int> ringPorts;
-    int currentPortIndex;
+    RingConfig ring;
+    RingRouter router;
+    RingRouter::Mode routingMode;
+    
+    NodeTable nodeTable;
+    int selfHandle;
+    QByteArray nodeIdUtf8;
+    int preferredWireVersion;
+    
+    int batchWindowUsec;
+    int batchMaxBytes;
+    QString queueDirectory;
+    OutboundQueue::OverflowPolicy queuePolicy;
+    qint64 queueMemoryLimit;
+    qint64 queueDiskLimit;
+    
+    MessageStore store;
+    QTimer* storeTimer; // flushes the store StoreFlushMsec after the first unflushed append
+    NetworkMetrics metrics;
+    
+    // Per-node sequencing and delivery state lives in tables indexed by NodeTable handle;
+    // node IDs are interned once where frames are decoded or messages are sent
+    QVector<int> lastSequenceNumbers; // destination -> last sequence number sent
+    
+    // Sequence ordering: a bounded reorder window per origin; a gap that is still open
+    // after NackDelayMsec is NACKed to the origin, and skipped after MaxNackAttempts
+    struct GapState {
+        int expected = 0; // head of the gap being waited on
+        qint64 nextNackAt = 0;
+        int nacksSent = 0;
+    };
+    QVector<ReorderBuffer> reorderBuffers; // origin -> reorder window
+    QMap<int, GapState> gaps; // origin -> open gap
+    QVector<Message> releasedMessages;
+    QTimer* gapTimer;
+    QElapsedTimer clock;
+    
+    // Recently sent messages, resent when their destination NACKs them
+    QVector<RetransmitBuffer> retransmitBuffers; // destination -> buffer
+    struct NackBudget {
+        qint64 windowStartMsec = 0;
+        int resent = 0;
+    };
+    QVector<NackBudget> nackBudgets; // requester -> resends in the current window
     
-    QMap<QString, int> nextSequenceNumbers; // destination -> next sequence number
-    QMap<QString, int> lastSequenceNumbers;
-    QQueue<Message> messageQueue;
+    void remapNodeState(const QStringList& previousNames);
+    void processOrderedMessage(Message message, int origin);
+    void trackGap(int origin);
+    void sendNack(int origin, const QVector<SequenceRange>& missing);
+    void processNack(const char* data, int size);
     
-    // Sequence ordering mechanism
-    QMap<QString, QMap<int, Message>> pendingMessages; // origin -> sequence -> message
-    QMap<QString, int> expectedSequenceNumbers; // origin -> next expected sequence
+    // Destinations acknowledge cumulatively, one ACK per origin every AckDelayMsec
+    struct PendingAck {
+        int cumulative = 0;
+        qint64 oneWayUsec = -1;
+        QVector<SequenceRange> skipped; // given up as lost; kept until an ACK carries them
+    };
+    QMap<int, PendingAck> pendingAcks; // origin -> ACK to send
+    QTimer* ackTimer;
+    QVector<DeliveryTracker*> deliveryTrackers; // destination -> outstanding messages and latency
+    bool timestampsEnabled;
+    int traceInterval;
+    int sentSinceTrace;
+    TraceWriter traceWriter;
     
-    void processOrderedMessage(const Message& message);
-    void deliverPendingMessages(const QString& origin);
-    bool isSequenceExpected(const Message& message) const;
-};
\ No newline at end of file
+    void scheduleAck(int origin, int cumulative, const Message& newest);
+    bool sendAck(int origin, const PendingAck& ack);
+    void processAck(const char* data, int size);
+};
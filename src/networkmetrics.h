@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include "latencyhistogram.h"
+
+// Per-node traffic metrics. NetworkManager updates them on its own thread
+// and an exporter reads them from any other, so every field is an atomic
+// (or an atomic histogram) and neither side takes a lock. The timing
+// histograms hold nanoseconds.
+struct NetworkMetrics {
+    QAtomicInteger<quint64> framesReceived;
+    QAtomicInteger<quint64> bytesReceived;
+    QAtomicInteger<quint64> framesSent;    // every frame written, through a batcher or directly
+    QAtomicInteger<quint64> bytesSent;
+    QAtomicInteger<quint64> forwarded;     // frames passed on towards another node
+    QAtomicInteger<quint64> delivered;     // messages delivered here, in order
+    QAtomicInteger<quint64> decodeErrors;
+    QAtomicInteger<quint64> reconnects;    // links that came back after going down
+
+    // Gauges
+    QAtomicInteger<qint64> queuedFrames;   // waiting in outbound queues for a neighbor
+    QAtomicInteger<qint64> reorderBuffered; // waiting for an earlier sequence number
+
+    LatencyHistogram decodeNsec;           // full decode of every frame not cut through
+    LatencyHistogram forwardNsec;          // frame read to handed on towards the next hop
+};
@@ -0,0 +1,62 @@
+#include "nodetable.h"
+#include <QDebug>
+
+NodeTable::NodeTable() : sharedCount(0) {}
+
+void NodeTable::setRingMembers(const QStringList& nodeIds) {
+    names.clear();
+    utf8Names.clear();
+    handles.clear();
+    utf8Handles.clear();
+
+    // Keep a slot for every member (even unnamed ones) so handles line up with ring positions
+    for (const QString& nodeId : nodeIds) {
+        if (names.size() >= MaxSharedHandles) {
+            // RingConfig rejects rings this large, so only a caller that skipped it gets here
+            qDebug() << "Ring has" << nodeIds.size() << "members; only the first" << MaxSharedHandles
+                     << "get shared handles";
+            break;
+        }
+        QByteArray utf8 = nodeId.toUtf8();
+        if (!nodeId.isEmpty() && !handles.contains(nodeId)) {
+            handles.insert(nodeId, names.size());
+            utf8Handles.insert(utf8, names.size());
+        }
+        names.append(nodeId);
+        utf8Names.append(utf8);
+    }
+    sharedCount = names.size();
+}
+
+int NodeTable::intern(const QString& nodeId) {
+    if (nodeId.isEmpty()) {
+        return InvalidHandle;
+    }
+
+    auto it = handles.constFind(nodeId);
+    if (it != handles.constEnd()) {
+        return it.value();
+    }
+
+    int handle = names.size();
+    QByteArray utf8 = nodeId.toUtf8();
+    names.append(nodeId);
+    utf8Names.append(utf8);
+    handles.insert(nodeId, handle);
+    utf8Handles.insert(utf8, handle);
+    return handle;
+}
+
+QString NodeTable::nameOf(int handle) const {
+    if (handle < 0 || handle >= names.size()) {
+        return QString();
+    }
+    return names.at(handle);
+}
+
+QByteArray NodeTable::utf8NameOf(int handle) const {
+    if (handle < 0 || handle >= utf8Names.size()) {
+        return QByteArray();
+    }
+    return utf8Names.at(handle);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+
+// Maps node identifiers to small integer handles. Handles for ring members
+// follow ring order, so they are identical on every node and can be put on
+// the wire; anything interned later only has meaning locally.
+class NodeTable {
+public:
+    static constexpr int InvalidHandle = -1;
+    static constexpr int MaxSharedHandles = 0xFFFF;
+    // Names learned from the network are capped so peers cannot grow the table without bound
+    static constexpr int MaxLocalHandles = 4096;
+
+    NodeTable();
+
+    void setRingMembers(const QStringList& nodeIds);
+    int intern(const QString& nodeId);
+
+    int handleOf(const QString& nodeId) const { return handles.value(nodeId, InvalidHandle); }
+    int handleOfUtf8(const QByteArray& nodeId) const { return utf8Handles.value(nodeId, InvalidHandle); }
+    QString nameOf(int handle) const;
+    // Shared with the table, so decoded messages can refer to it without a copy
+    QByteArray utf8NameOf(int handle) const;
+    bool isShared(int handle) const { return handle >= 0 && handle < sharedCount; }
+    int size() const { return names.size(); }
+    int ringSize() const { return sharedCount; }
+    bool hasLocalRoom() const { return names.size() - sharedCount < MaxLocalHandles; }
+
+private:
+    QVector<QString> names;
+    QVector<QByteArray> utf8Names;
+    QHash<QString, int> handles;
+    QHash<QByteArray, int> utf8Handles;
+    int sharedCount;
+};
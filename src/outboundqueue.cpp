@@ -0,0 +1,221 @@
+#include "outboundqueue.h"
+#include <QDebug>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+static const int RecordPrefixSize = 4;
+
+OutboundQueue::OutboundQueue()
+    : memoryUsed(0), memoryLimit(DefaultMemoryLimit), diskLimit(DefaultDiskLimit),
+      policy(SpillToDisk), readOffset(HeaderSize), diskFrames(0), dropped(0) {}
+
+QString OutboundQueue::defaultStorageDirectory() {
+    QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+    dataDir.mkpath(".");
+    return dataDir.path();
+}
+
+bool OutboundQueue::open(const QString& path) {
+    segment.close();
+    segment.setFileName(path);
+    if (!segment.open(QIODevice::ReadWrite)) {
+        qDebug() << "Failed to open outbound queue segment" << path << ":" << segment.errorString();
+        return false;
+    }
+
+    diskFrames = 0;
+    readOffset = HeaderSize;
+    if (segment.size() < HeaderSize) {
+        segment.resize(0);
+        writeReadOffset();
+        return true;
+    }
+
+    char header[HeaderSize];
+    segment.seek(0);
+    segment.read(header, HeaderSize);
+    readOffset = qBound(HeaderSize, qFromBigEndian<qint64>(header), segment.size());
+
+    // Count the frames a previous run left behind; a torn record at the tail is cut off
+    qint64 offset = readOffset;
+    segment.seek(offset);
+    char prefix[RecordPrefixSize];
+    while (segment.read(prefix, RecordPrefixSize) == RecordPrefixSize) {
+        qint64 length = qFromBigEndian<quint32>(prefix);
+        if (offset + RecordPrefixSize + length > segment.size()) {
+            break;
+        }
+        offset += RecordPrefixSize + length;
+        segment.seek(offset);
+        ++diskFrames;
+    }
+    if (offset < segment.size()) {
+        segment.resize(offset);
+    }
+
+    if (diskFrames > 0) {
+        qDebug() << "Recovered" << diskFrames << "queued frames from" << path;
+    }
+    return true;
+}
+
+bool OutboundQueue::enqueue(const QByteArray& frame) {
+    if (diskFrames > 0) {
+        // Frames are already waiting on disk, so this one has to queue up behind them
+        if (spill(frame)) {
+            return true;
+        }
+        ++dropped;
+        return false;
+    }
+
+    if (memoryUsed + frame.size() <= memoryLimit) {
+        memory.enqueue(frame);
+        memoryUsed += frame.size();
+        return true;
+    }
+
+    switch (policy) {
+    case SpillToDisk:
+        if (spill(frame)) {
+            return true;
+        }
+        break;
+    case DropOldest:
+        while (!memory.isEmpty() && memoryUsed + frame.size() > memoryLimit) {
+            memoryUsed -= memory.dequeue().size();
+            ++dropped;
+        }
+        if (memoryUsed + frame.size() <= memoryLimit) {
+            memory.enqueue(frame);
+            memoryUsed += frame.size();
+            return true;
+        }
+        break;
+    case RejectNew:
+        break;
+    }
+
+    ++dropped;
+    return false;
+}
+
+QByteArray OutboundQueue::dequeue() {
+    if (memory.isEmpty()) {
+        refill();
+    }
+    if (memory.isEmpty()) {
+        return QByteArray();
+    }
+
+    QByteArray frame = memory.dequeue();
+    memoryUsed -= frame.size();
+    return frame;
+}
+
+void OutboundQueue::requeue(const QList<QByteArray>& frames) {
+    for (int i = frames.size() - 1; i >= 0; --i) {
+        memory.prepend(frames[i]);
+        memoryUsed += frames[i].size();
+    }
+}
+
+void OutboundQueue::persist() {
+    if (memory.isEmpty() || !segment.isOpen()) {
+        return;
+    }
+
+    // Memory frames are older than anything on disk, so write them first and append the rest
+    QString path = segment.fileName();
+    // Written aside and renamed over the segment on commit(), so a crash leaves either file intact
+    QSaveFile rewritten(path);
+    if (!rewritten.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to persist outbound queue:" << rewritten.errorString();
+        return;
+    }
+
+    char header[HeaderSize];
+    qToBigEndian(HeaderSize, header);
+    rewritten.write(header, HeaderSize);
+
+    char prefix[RecordPrefixSize];
+    for (const QByteArray& frame : memory) {
+        qToBigEndian(quint32(frame.size()), prefix);
+        rewritten.write(prefix, RecordPrefixSize);
+        rewritten.write(frame);
+    }
+
+    segment.seek(readOffset);
+    while (!segment.atEnd()) {
+        rewritten.write(segment.read(64 * 1024));
+    }
+    segment.close();
+    if (!rewritten.commit()) {
+        qDebug() << "Failed to persist outbound queue:" << rewritten.errorString();
+        open(path);
+        return;
+    }
+
+    int persisted = memory.size();
+    memory.clear();
+    memoryUsed = 0;
+    open(path);
+    qDebug() << "Persisted" << persisted << "queued frames to" << path;
+}
+
+bool OutboundQueue::spill(const QByteArray& frame) {
+    if (!segment.isOpen()) {
+        return false;
+    }
+    if (segment.size() - readOffset + RecordPrefixSize + frame.size() > diskLimit) {
+        return false;
+    }
+
+    char prefix[RecordPrefixSize];
+    qToBigEndian(quint32(frame.size()), prefix);
+    segment.seek(segment.size());
+    segment.write(prefix, RecordPrefixSize);
+    segment.write(frame);
+    ++diskFrames;
+    return true;
+}
+
+void OutboundQueue::refill() {
+    if (diskFrames == 0) {
+        return;
+    }
+
+    segment.seek(readOffset);
+    char prefix[RecordPrefixSize];
+    // At least one frame, so a queue whose limit is below one frame still drains
+    while (diskFrames > 0 && (memory.isEmpty() || memoryUsed < memoryLimit)) {
+        if (segment.read(prefix, RecordPrefixSize) != RecordPrefixSize) {
+            diskFrames = 0;
+            break;
+        }
+        quint32 length = qFromBigEndian<quint32>(prefix);
+        QByteArray frame = segment.read(length);
+        readOffset += RecordPrefixSize + length;
+        --diskFrames;
+
+        memory.enqueue(frame);
+        memoryUsed += frame.size();
+    }
+
+    // Once the segment is fully drained it starts over from an empty file
+    if (diskFrames == 0) {
+        segment.resize(0);
+        readOffset = HeaderSize;
+    }
+    writeReadOffset();
+}
+
+void OutboundQueue::writeReadOffset() {
+    char header[HeaderSize];
+    qToBigEndian(readOffset, header);
+    segment.seek(0);
+    segment.write(header, HeaderSize);
+    segment.flush();
+}
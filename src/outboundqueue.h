@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QQueue>
+#include <QString>
+
+// Frames waiting for the neighbor link. The head of the queue lives in
+// memory up to a byte limit; past that, frames are appended to an on-disk
+// segment log and read back in order as the memory part drains. Once a
+// frame has gone to disk every later frame follows it there, so ordering
+// is preserved. The segment starts with the read offset, so frames left
+// over from a previous run are replayed after a restart.
+class OutboundQueue {
+public:
+    enum OverflowPolicy {
+        SpillToDisk,
+        DropOldest,
+        RejectNew
+    };
+
+    static constexpr qint64 DefaultMemoryLimit = 4 * 1024 * 1024;
+    static constexpr qint64 DefaultDiskLimit = 256 * 1024 * 1024;
+
+    OutboundQueue();
+
+    void setPolicy(OverflowPolicy policy) { this->policy = policy; }
+    void setMemoryLimit(qint64 bytes) { memoryLimit = bytes; }
+    void setDiskLimit(qint64 bytes) { diskLimit = bytes; }
+    OverflowPolicy getPolicy() const { return policy; }
+
+    // Where segments live unless configured otherwise: the application's local data directory
+    static QString defaultStorageDirectory();
+    
+    bool open(const QString& path);
+    void persist();
+
+    // Returns false if the frame was rejected by the overflow policy
+    bool enqueue(const QByteArray& frame);
+    QByteArray dequeue();
+    // Puts frames that were dequeued but never sent back at the head, in order.
+    // They are older than anything queued, so they may go over the memory limit.
+    void requeue(const QList<QByteArray>& frames);
+
+    bool isEmpty() const { return memory.isEmpty() && diskFrames == 0; }
+    int size() const { return memory.size() + diskFrames; }
+    qint64 memoryBytes() const { return memoryUsed; }
+    int spilledFrames() const { return diskFrames; }
+    quint64 droppedFrames() const { return dropped; }
+
+private:
+    static constexpr qint64 HeaderSize = 8;
+
+    bool spill(const QByteArray& frame);
+    void refill();
+    void writeReadOffset();
+
+    QQueue<QByteArray> memory;
+    qint64 memoryUsed;
+    qint64 memoryLimit;
+    qint64 diskLimit;
+    OverflowPolicy policy;
+
+    QFile segment;
+    qint64 readOffset;
+    int diskFrames;
+    quint64 dropped;
+};
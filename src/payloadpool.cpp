@@ -0,0 +1,49 @@
+#include "payloadpool.h"
+#include <cstring>
+
+// Buffers come back roughly in the order they went out, so the one after the last
+// handed out is nearly always free; past this many busy ones, the pool grows instead
+static const int MaxProbes = 8;
+
+PayloadPool::PayloadPool(int maxBuffers)
+    : maxBuffers(qMax(1, maxBuffers)), next(0), reused(0), allocated(0) {
+    buffers.reserve(this->maxBuffers);
+}
+
+PayloadPool& PayloadPool::local() {
+    thread_local PayloadPool pool;
+    return pool;
+}
+
+QByteArray PayloadPool::copy(const char* data, int size) {
+    if (size <= 0) {
+        return QByteArray();
+    }
+    if (size > MaxPooledBytes) {
+        ++allocated;
+        return QByteArray(data, size);
+    }
+
+    for (int probe = 0; probe < MaxProbes && probe < buffers.size(); ++probe) {
+        QByteArray& buffer = buffers[next];
+        next = (next + 1) % buffers.size();
+        if (buffer.isDetached()) {
+            // Only the pool refers to it, so writing in place neither copies nor races a reader
+            buffer.resize(size);
+            std::memcpy(buffer.data(), data, size);
+            ++reused;
+            return buffer;
+        }
+    }
+
+    ++allocated;
+    if (buffers.size() == maxBuffers) {
+        return QByteArray(data, size);
+    }
+    QByteArray buffer;
+    // A reserved capacity is kept when a later, smaller payload resizes the buffer
+    buffer.reserve(qMax(size, MinBufferBytes));
+    buffer.append(data, size);
+    buffers.append(buffer);
+    return buffer;
+}
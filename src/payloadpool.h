@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+// Recycles the UTF-8 buffers that decoded messages share. Every buffer
+// handed out is a shallow copy of one the pool keeps; once the last
+// Message referring to it is gone the pool holds the only reference again,
+// and the buffer (with its capacity) is reused for the next payload. At
+// steady state decoding therefore copies bytes but allocates nothing.
+// A pool belongs to one thread, but its buffers can be released anywhere.
+class PayloadPool {
+public:
+    static constexpr int DefaultBuffers = 1024;
+    static constexpr int MinBufferBytes = 256;
+    // Larger payloads are rare enough to get their own allocation
+    static constexpr int MaxPooledBytes = 64 * 1024;
+
+    explicit PayloadPool(int maxBuffers = DefaultBuffers);
+
+    // The calling thread's pool
+    static PayloadPool& local();
+
+    QByteArray copy(const char* data, int size);
+
+    int size() const { return buffers.size(); }
+    quint64 reusedCount() const { return reused; }
+    quint64 allocatedCount() const { return allocated; }
+
+private:
+    QVector<QByteArray> buffers;
+    int maxBuffers;
+    int next;
+    quint64 reused;
+    quint64 allocated;
+};
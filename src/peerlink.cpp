@@ -0,0 +1,93 @@
+#include "peerlink.h"
+#include <QDebug>
+#include "wireformat.h"
+#include <algorithm>
+
+static const int RetryDelayMsec = 3000;
+
+PeerLink::PeerLink(int peerIndex, const QString& peerId, Transport* transport, QObject* parent)
+    : QObject(parent), peerIndex(peerIndex), peerId(peerId), port(0), transport(transport), connection(nullptr),
+      wireVersion(WireFormat::LegacyVersion), connectionCount(0) {
+    
+    batcher = new FrameBatcher(this);
+    
+    retryTimer = new QTimer(this);
+    retryTimer->setSingleShot(true);
+    connect(retryTimer, &QTimer::timeout, this, &PeerLink::reconnect);
+}
+
+PeerLink::~PeerLink() {
+    // Whatever is still waiting for the peer goes to disk for the next run
+    queue.persist();
+    
+    if (connection) {
+        connection->disconnectFromHost();
+    }
+}
+
+void PeerLink::connectTo(const QString& host, int port, int delayMsec) {
+    this->host = host;
+    this->port = port;
+    
+    if (delayMsec > 0) {
+        retryTimer->start(delayMsec);
+    } else {
+        reconnect();
+    }
+}
+
+bool PeerLink::isConnected() const {
+    return connection && connection->isConnected();
+}
+
+void PeerLink::reconnect() {
+    if (host.isEmpty() || port <= 0) {
+        return;
+    }
+    
+    if (connection) {
+        connection->disconnect(this);
+        connection->disconnectFromHost();
+        connection->deleteLater();
+    }
+    
+    connection = transport->createConnection(this);
+    // Frames staged for the old connection but never written go back to the head of the queue.
+    // Hellos belong to the old connection; the new one negotiates again.
+    QList<QByteArray> staged = batcher->takeFrames();
+    staged.erase(std::remove_if(staged.begin(), staged.end(), [](const QByteArray& frame) {
+        WireFormat::FrameHeader header;
+        return WireFormat::readHeader(frame.constData(), frame.size(), header)
+               && !WireFormat::isRoutedType(header.type);
+    }), staged.end());
+    queue.requeue(staged);
+    batcher->setDevice(connection);
+    receiveBuffer = ReceiveBuffer();
+    wireVersion = WireFormat::LegacyVersion;
+    
+    connect(connection, &Connection::connected, this, &PeerLink::onConnected);
+    connect(connection, &Connection::readyRead, this, &PeerLink::readyRead);
+    connect(connection, &Connection::bytesWritten, this, &PeerLink::bytesWritten);
+    connect(connection, &Connection::disconnected, this, &PeerLink::onDisconnected);
+    connect(connection, &Connection::errorOccurred, this, &PeerLink::onError);
+    
+    qDebug() << "Attempting to connect to" << peerId << "at" << host << ":" << port;
+    connection->connectToHost(host, quint16(port));
+}
+
+void PeerLink::onConnected() {
+    qDebug() << "Connected to" << peerId << "at" << host << ":" << port;
+    ++connectionCount;
+    emit connected();
+}
+
+void PeerLink::onDisconnected() {
+    qDebug() << "Lost connection to" << peerId << ", will retry";
+    emit disconnected();
+    retryTimer->start(RetryDelayMsec);
+}
+
+void PeerLink::onError() {
+    qDebug() << "Connection error to" << peerId << ":" << connection->errorString();
+    retryTimer->start(RetryDelayMsec);
+}
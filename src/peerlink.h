@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include "framebatcher.h"
+#include "outboundqueue.h"
+#include "receivebuffer.h"
+#include "transport.h"
+
+// One outgoing connection to another ring member. Frames for the peer go
+// through the link's batcher while it is up and wait in its outbound queue
+// while it is down; after an error or disconnect the link reconnects by
+// itself. Replies on the connection (hello acks) come in through its
+// receive buffer.
+class PeerLink : public QObject {
+    Q_OBJECT
+
+public:
+    PeerLink(int peerIndex, const QString& peerId, Transport* transport, QObject* parent = nullptr);
+    ~PeerLink();
+    
+    void connectTo(const QString& host, int port, int delayMsec = 0);
+    bool isConnected() const;
+    
+    int getPeerIndex() const { return peerIndex; }
+    QString getPeerId() const { return peerId; }
+    QString getHost() const { return host; }
+    int getPort() const { return port; }
+    
+    Connection* getConnection() const { return connection; }
+    FrameBatcher* getBatcher() const { return batcher; }
+    OutboundQueue& getQueue() { return queue; }
+    ReceiveBuffer& getReceiveBuffer() { return receiveBuffer; }
+    
+    // Negotiated per connection; every new connection starts out legacy
+    int getWireVersion() const { return wireVersion; }
+    void setWireVersion(int version) { wireVersion = version; }
+    
+    // Times the link has come up; anything above one is a reconnect
+    int getConnectionCount() const { return connectionCount; }
+
+signals:
+    void connected();
+    void disconnected();
+    void readyRead();
+    void bytesWritten();
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onError();
+    void reconnect();
+
+private:
+    int peerIndex;
+    QString peerId;
+    QString host;
+    int port;
+    
+    Transport* transport;
+    Connection* connection;
+    FrameBatcher* batcher;
+    OutboundQueue queue;
+    ReceiveBuffer receiveBuffer;
+    QTimer* retryTimer;
+    int wireVersion;
+    int connectionCount;
+};
@@ -0,0 +1,91 @@
+#include "posixsocket.h"
+#include <QHostInfo>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <unistd.h>
+
+bool PosixSocket::toSockaddr(const QHostAddress& address, quint16 port, sockaddr_storage& storage, socklen_t& length) {
+    std::memset(&storage, 0, sizeof(storage));
+    if (address.protocol() == QAbstractSocket::AnyIPProtocol) {
+        // QHostAddress::Any: the IPv6 wildcard, which listen() makes dual-stack
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        in6->sin6_addr = in6addr_any;
+        length = sizeof(sockaddr_in6);
+        return true;
+    }
+    if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+        sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&storage);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        in->sin_addr.s_addr = htonl(address.toIPv4Address());
+        length = sizeof(sockaddr_in);
+        return true;
+    }
+    if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        Q_IPV6ADDR ip = address.toIPv6Address();
+        std::memcpy(&in6->sin6_addr, &ip, sizeof(ip));
+        length = sizeof(sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+bool PosixSocket::resolve(const QString& host, QHostAddress& address, QString& error) {
+    address = QHostAddress(host);
+    if (!address.isNull()) {
+        return true;
+    }
+    const QList<QHostAddress> addresses = QHostInfo::fromName(host).addresses();
+    if (addresses.isEmpty()) {
+        error = QString("Host %1 not found").arg(host);
+        return false;
+    }
+    address = addresses.first();
+    return true;
+}
+
+int PosixSocket::listen(const QHostAddress& address, quint16 port, int flags, QString& error) {
+    sockaddr_storage storage;
+    socklen_t length;
+    if (!toSockaddr(address, port, storage, length)) {
+        error = QString("Unsupported address %1").arg(address.toString());
+        return -1;
+    }
+
+    bool anyProtocol = address.protocol() == QAbstractSocket::AnyIPProtocol;
+    int fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+    if (fd < 0 && anyProtocol && errno == EAFNOSUPPORT) {
+        // No IPv6 on this host; the IPv4 wildcard is all that Any can mean
+        return listen(QHostAddress(QHostAddress::AnyIPv4), port, flags, error);
+    }
+    if (fd < 0) {
+        error = errorString(errno);
+        return -1;
+    }
+    if (anyProtocol) {
+        // Accept IPv4 too, as QTcpServer does for QHostAddress::Any
+        setOption(fd, IPPROTO_IPV6, IPV6_V6ONLY, 0);
+    }
+    setOption(fd, SOL_SOCKET, SO_REUSEADDR, 1);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        error = errorString(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void PosixSocket::setOption(int fd, int level, int option, int value) {
+    ::setsockopt(fd, level, option, &value, sizeof(value));
+}
+
+QString PosixSocket::errorString(int error) {
+    return QString::fromLocal8Bit(std::strerror(error));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QHostAddress>
+#include <QString>
+#include <sys/socket.h>
+
+// Socket plumbing shared by the Linux transport backends
+class PosixSocket {
+public:
+    // QHostAddress::Any becomes the IPv6 wildcard
+    static bool toSockaddr(const QHostAddress& address, quint16 port, sockaddr_storage& storage, socklen_t& length);
+    // Hosts are usually literal addresses; names are resolved synchronously
+    static bool resolve(const QString& host, QHostAddress& address, QString& error);
+    // A bound, listening socket (flags as for socket(), e.g. SOCK_NONBLOCK), or -1 with error set.
+    // QHostAddress::Any listens on both IPv4 and IPv6, or on IPv4 alone where IPv6 is unavailable.
+    static int listen(const QHostAddress& address, quint16 port, int flags, QString& error);
+    static void setOption(int fd, int level, int option, int value);
+    static QString errorString(int error);
+};
@@ -0,0 +1,83 @@
+#include "qttransport.h"
+#include "receivebuffer.h"
+
+QtConnection::QtConnection(QObject* parent) : Connection(parent), socket(new QTcpSocket(this)) {
+    attach();
+}
+
+QtConnection::QtConnection(QTcpSocket* socket, QObject* parent) : Connection(parent), socket(socket) {
+    socket->setParent(this);
+    attach();
+    if (socket->state() == QAbstractSocket::ConnectedState) {
+        open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    }
+}
+
+void QtConnection::attach() {
+    connect(socket, &QTcpSocket::connected, this, &QtConnection::onConnected);
+    connect(socket, &QTcpSocket::disconnected, this, &QtConnection::onDisconnected);
+    connect(socket, &QTcpSocket::readyRead, this, &QtConnection::readyRead);
+    connect(socket, &QTcpSocket::bytesWritten, this, &QtConnection::bytesWritten);
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred), this, [this]() {
+        setErrorString(socket->errorString());
+        emit errorOccurred();
+    });
+}
+
+void QtConnection::onConnected() {
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    emit connected();
+}
+
+void QtConnection::onDisconnected() {
+    close();
+    emit disconnected();
+}
+
+void QtConnection::connectToHost(const QString& host, quint16 port) {
+    socket->connectToHost(host, port);
+}
+
+void QtConnection::disconnectFromHost() {
+    socket->disconnectFromHost();
+}
+
+bool QtConnection::isConnected() const {
+    return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+QString QtConnection::peerAddress() const {
+    return socket->peerAddress().toString();
+}
+
+qint64 QtConnection::readInto(ReceiveBuffer& buffer) {
+    // Straight from the socket's buffer, skipping this device's read path
+    return buffer.readFrom(socket);
+}
+
+qint64 QtConnection::readData(char* data, qint64 maxSize) {
+    return socket->read(data, maxSize);
+}
+
+qint64 QtConnection::writeData(const char* data, qint64 size) {
+    return socket->write(data, size);
+}
+
+QtTransport::QtTransport(QObject* parent) : Transport(parent) {
+    server = new QTcpServer(this);
+    connect(server, &QTcpServer::newConnection, this, &QtTransport::onNewConnection);
+}
+
+bool QtTransport::listen(const QHostAddress& address, quint16 port) {
+    return server->listen(address, port);
+}
+
+void QtTransport::close() {
+    server->close();
+}
+
+void QtTransport::onNewConnection() {
+    while (server->hasPendingConnections()) {
+        emit newConnection(new QtConnection(server->nextPendingConnection(), this));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "transport.h"
+
+// Connection over a QTcpSocket
+class QtConnection : public Connection {
+    Q_OBJECT
+
+public:
+    explicit QtConnection(QObject* parent = nullptr);
+    // Takes over an accepted socket
+    explicit QtConnection(QTcpSocket* socket, QObject* parent = nullptr);
+
+    void connectToHost(const QString& host, quint16 port) override;
+    void disconnectFromHost() override;
+    bool isConnected() const override;
+    QString peerAddress() const override;
+    qint64 readInto(ReceiveBuffer& buffer) override;
+
+    qint64 bytesAvailable() const override { return socket->bytesAvailable(); }
+    qint64 bytesToWrite() const override { return socket->bytesToWrite(); }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+private:
+    void attach();
+    void onConnected();
+    void onDisconnected();
+
+    QTcpSocket* socket;
+};
+
+// QTcpServer/QTcpSocket backend, available everywhere
+class QtTransport : public Transport {
+    Q_OBJECT
+
+public:
+    explicit QtTransport(QObject* parent = nullptr);
+
+    Backend backend() const override { return QtSockets; }
+    bool listen(const QHostAddress& address, quint16 port) override;
+    void close() override;
+    QString errorString() const override { return server->errorString(); }
+    Connection* createConnection(QObject* parent = nullptr) override { return new QtConnection(parent); }
+
+private slots:
+    void onNewConnection();
+
+private:
+    QTcpServer* server;
+};
@@ -0,0 +1,81 @@
+#include "receivebuffer.h"
+#include <QtEndian>
+#include <cstring>
+
+ReceiveBuffer::ReceiveBuffer() : readPos(0), writePos(0), error(false) {}
+
+qint64 ReceiveBuffer::readFrom(QIODevice* device) {
+    qint64 available = device->bytesAvailable();
+    if (available <= 0) {
+        return 0;
+    }
+
+    reserve(int(available));
+    qint64 bytesRead = device->read(storage.data() + writePos, available);
+    if (bytesRead > 0) {
+        writePos += int(bytesRead);
+    }
+    return bytesRead;
+}
+
+void ReceiveBuffer::append(const char* data, int size) {
+    reserve(size);
+    std::memcpy(storage.data() + writePos, data, size);
+    writePos += size;
+}
+
+char* ReceiveBuffer::prepareWrite(int minBytes, int& room) {
+    reserve(minBytes);
+    room = storage.size() - writePos;
+    return storage.data() + writePos;
+}
+
+bool ReceiveBuffer::nextFrame(const char*& data, int& size) {
+    int available = writePos - readPos;
+    if (error || available < PrefixSize) {
+        return false;
+    }
+
+    const char* start = storage.constData() + readPos;
+    quint32 frameSize = qFromBigEndian<quint32>(start);
+    if (frameSize > quint32(MaxFrameSize)) {
+        error = true;
+        return false;
+    }
+    if (quint32(available - PrefixSize) < frameSize) {
+        return false;
+    }
+
+    data = start + PrefixSize;
+    size = int(frameSize);
+    readPos += PrefixSize + size;
+
+    // Rewinding an empty buffer is free and keeps the next read at the front
+    if (readPos == writePos) {
+        readPos = 0;
+        writePos = 0;
+    }
+    return true;
+}
+
+void ReceiveBuffer::reserve(int bytes) {
+    if (storage.size() - writePos >= bytes) {
+        return;
+    }
+
+    // Out of tail room: compact unread bytes to the front, growing if that is still not enough
+    int unread = writePos - readPos;
+    if (readPos > 0) {
+        std::memmove(storage.data(), storage.constData() + readPos, unread);
+        readPos = 0;
+        writePos = unread;
+    }
+
+    if (storage.size() - writePos < bytes) {
+        int capacity = qMax(storage.size(), InitialCapacity);
+        while (capacity - writePos < bytes) {
+            capacity *= 2;
+        }
+        storage.resize(capacity);
+    }
+}
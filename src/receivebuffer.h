@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+
+// Per-connection receive buffer for length-prefixed frames. Data is read
+// straight into free space behind a write cursor and frames are handed out
+// in place from a read cursor, so consuming a frame costs nothing; unread
+// bytes are only moved to the front when the tail runs out of room.
+class ReceiveBuffer {
+public:
+    static constexpr int InitialCapacity = 64 * 1024;
+    static constexpr int PrefixSize = 4;
+    // Larger length prefixes are treated as a corrupt or hostile stream
+    static constexpr int MaxFrameSize = 16 * 1024 * 1024;
+
+    ReceiveBuffer();
+
+    qint64 readFrom(QIODevice* device);
+    void append(const char* data, int size);
+
+    // For readers that fill the buffer themselves (e.g. with readv): returns the write
+    // cursor with at least minBytes of room (room is set to all of it); commitWrite()
+    // then accounts for what was actually written
+    char* prepareWrite(int minBytes, int& room);
+    void commitWrite(int bytes) { writePos += bytes; }
+
+    // Points data at the next complete frame body (without its length prefix).
+    // The pointer stays valid until the next readFrom() or append(). A prefix
+    // above MaxFrameSize makes this and every later call fail with hasError() set.
+    bool nextFrame(const char*& data, int& size);
+    bool hasError() const { return error; }
+
+    int bytesAvailable() const { return writePos - readPos; }
+    int capacity() const { return storage.size(); }
+
+private:
+    void reserve(int bytes);
+
+    QByteArray storage;
+    int readPos;
+    int writePos;
+    bool error;
+};
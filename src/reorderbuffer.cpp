@@ -0,0 +1,74 @@
+#include "reorderbuffer.h"
+
+ReorderBuffer::ReorderBuffer(int window, int expected)
+    : window(qMax(1, window)), expectedSequence(expected), highestSeen(expected - 1), bufferedCount(0) {}
+
+ReorderBuffer::Result ReorderBuffer::insert(Message message, QVector<Message>& ready) {
+    int sequence = message.getSequenceNumber();
+    if (sequence < expectedSequence) {
+        return Duplicate;
+    }
+    highestSeen = qMax(highestSeen, sequence);
+
+    if (sequence == expectedSequence) {
+        ready.append(std::move(message));
+        ++expectedSequence;
+        release(ready);
+        return Delivered;
+    }
+    if (sequence - expectedSequence >= window) {
+        return OutOfWindow;
+    }
+    if (isBuffered(sequence)) {
+        return Duplicate;
+    }
+
+    if (pending.isEmpty()) {
+        pending.resize(window);
+    }
+    slotFor(sequence) = std::move(message);
+    ++bufferedCount;
+    return Buffered;
+}
+
+QVector<SequenceRange> ReorderBuffer::missingRanges(int maxRanges) const {
+    QVector<SequenceRange> ranges;
+    int last = qMin(highestSeen, expectedSequence + window - 1);
+    int sequence = expectedSequence;
+    while (sequence <= last && ranges.size() < maxRanges) {
+        if (isBuffered(sequence)) {
+            ++sequence;
+            continue;
+        }
+        SequenceRange range;
+        range.first = sequence;
+        while (sequence <= last && !isBuffered(sequence)) {
+            ++sequence;
+        }
+        range.length = sequence - range.first;
+        ranges.append(range);
+    }
+    return ranges;
+}
+
+int ReorderBuffer::skipGap(QVector<Message>& ready) {
+    // Never further than one window, however far ahead the newest sequence seen is
+    int limit = expectedSequence + window;
+    int skipped = 0;
+    while (expectedSequence <= highestSeen && expectedSequence < limit && !isBuffered(expectedSequence)) {
+        ++expectedSequence;
+        ++skipped;
+    }
+    release(ready);
+    return skipped;
+}
+
+void ReorderBuffer::release(QVector<Message>& ready) {
+    while (bufferedCount > 0 && isBuffered(expectedSequence)) {
+        Message& slot = slotFor(expectedSequence);
+        ready.append(std::move(slot));
+        slot = Message();
+        --bufferedCount;
+        ++expectedSequence;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QVector>
+#include "message.h"
+
+// Restores per-origin sequence order within a bounded window. Messages
+// ahead of the next expected sequence number wait in a ring array indexed
+// by sequence modulo the window, allocated the first time a message has to
+// wait; anything further ahead than the window is dropped (and requested
+// again later) so memory stays fixed. Gaps are reported as ranges for
+// NACKs, and a gap that is never filled can be skipped so delivery does
+// not stall behind it forever.
+class ReorderBuffer {
+public:
+    enum Result {
+        Delivered,
+        Buffered,
+        Duplicate,
+        OutOfWindow
+    };
+
+    static constexpr int DefaultWindow = 256;
+
+    explicit ReorderBuffer(int window = DefaultWindow, int expected = 1);
+
+    // Messages that are now in order, this one included, are moved to the end of ready
+    Result insert(Message message, QVector<Message>& ready);
+
+    int expected() const { return expectedSequence; }
+    int buffered() const { return bufferedCount; }
+    bool hasGap() const { return highestSeen >= expectedSequence; }
+
+    // Missing runs from the expected sequence up to the newest one seen, within the window
+    QVector<SequenceRange> missingRanges(int maxRanges) const;
+
+    // Gives up on the missing run at the head and releases what follows it; returns how many were skipped
+    int skipGap(QVector<Message>& ready);
+
+private:
+    Message& slotFor(int sequence) { return pending[sequence % window]; }
+    const Message& slotFor(int sequence) const { return pending[sequence % window]; }
+    bool isBuffered(int sequence) const {
+        return !pending.isEmpty() && slotFor(sequence).getSequenceNumber() == sequence;
+    }
+    void release(QVector<Message>& ready);
+
+    int window;
+    QVector<Message> pending;
+    int expectedSequence;
+    int highestSeen;
+    int bufferedCount;
+};
@@ -0,0 +1,22 @@
+#include "retransmitbuffer.h"
+
+RetransmitBuffer::RetransmitBuffer(int capacity) : slotCount(qMax(1, capacity)) {}
+
+void RetransmitBuffer::add(const Message& message) {
+    if (sent.isEmpty()) {
+        sent.resize(slotCount);
+    }
+    sent[message.getSequenceNumber() % slotCount] = message;
+}
+
+bool RetransmitBuffer::find(int sequence, Message& message) const {
+    if (sequence < 1 || sent.isEmpty()) {
+        return false;
+    }
+    const Message& slot = sent[sequence % slotCount];
+    if (slot.getSequenceNumber() != sequence) {
+        return false;
+    }
+    message = slot;
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QVector>
+#include "message.h"
+
+// The most recent messages sent to one destination, kept so they can be
+// resent when the destination reports a gap. A ring array indexed by
+// sequence modulo the capacity: each message overwrites the one sent
+// capacity messages before it. Nothing is allocated until the first message.
+class RetransmitBuffer {
+public:
+    static constexpr int DefaultCapacity = 1024;
+
+    explicit RetransmitBuffer(int capacity = DefaultCapacity);
+
+    void add(const Message& message);
+    bool find(int sequence, Message& message) const;
+    int capacity() const { return slotCount; }
+    bool isEmpty() const { return sent.isEmpty(); }
+
+private:
+    int slotCount;
+    QVector<Message> sent;
+};
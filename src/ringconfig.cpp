@@ -0,0 +1,117 @@
+#include "ringconfig.h"
+#include <QFile>
+
+QHostAddress RingMember::listenAddress() const {
+    if (host == "localhost" || QHostAddress(host).isLoopback()) {
+        return QHostAddress(QHostAddress::LocalHost);
+    }
+    return QHostAddress(QHostAddress::Any);
+}
+
+RingConfig RingConfig::localRing(int size, int basePort) {
+    RingConfig ring;
+    for (int i = 0; i < size; ++i) {
+        RingMember member;
+        member.nodeId = QString("Node%1").arg(i + 1);
+        member.host = "127.0.0.1";
+        member.port = basePort + i;
+        ring.ringMembers.append(member);
+    }
+    return ring;
+}
+
+bool RingConfig::load(const QString& path, QString& error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QString("cannot open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    return parse(QString::fromUtf8(file.readAll()), error);
+}
+
+bool RingConfig::parse(const QString& text, QString& error) {
+    ringMembers.clear();
+    QHash<QString, int> memberOfNode;
+    QHash<QString, int> memberOfEndpoint;
+    
+    const QStringList lines = text.split('\n');
+    for (int lineNumber = 0; lineNumber < lines.size(); ++lineNumber) {
+        QString line = lines[lineNumber].section('#', 0, 0).trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        
+        QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        int separator = fields.size() == 2 ? fields[1].lastIndexOf(':') : -1;
+        bool portOk = false;
+        RingMember member;
+        if (separator > 0) {
+            member.nodeId = fields[0];
+            member.host = fields[1].left(separator);
+            member.port = fields[1].mid(separator + 1).toInt(&portOk);
+        }
+        if (!portOk || member.port < 1 || member.port > 65535) {
+            error = QString("line %1: expected \"<nodeId> <host>:<port>\"").arg(lineNumber + 1);
+            return false;
+        }
+        if (!addMember(member, memberOfNode, memberOfEndpoint, error)) {
+            error = QString("line %1: %2").arg(lineNumber + 1).arg(error);
+            return false;
+        }
+    }
+    
+    if (ringMembers.isEmpty()) {
+        error = "ring has no members";
+        return false;
+    }
+    return true;
+}
+
+bool RingConfig::addMember(const RingMember& member, QHash<QString, int>& memberOfNode,
+                           QHash<QString, int>& memberOfEndpoint, QString& error) {
+    if (ringMembers.size() >= MaxMembers) {
+        error = QString("ring has more than %1 members").arg(MaxMembers);
+        return false;
+    }
+    if (memberOfNode.contains(member.nodeId)) {
+        error = QString("duplicate node %1").arg(member.nodeId);
+        return false;
+    }
+    QString endpoint = QString("%1:%2").arg(member.host).arg(member.port);
+    auto existing = memberOfEndpoint.constFind(endpoint);
+    if (existing != memberOfEndpoint.constEnd()) {
+        error = QString("%1 and %2 share %3").arg(ringMembers[existing.value()].nodeId, member.nodeId, endpoint);
+        return false;
+    }
+    memberOfNode.insert(member.nodeId, ringMembers.size());
+    memberOfEndpoint.insert(endpoint, ringMembers.size());
+    ringMembers.append(member);
+    return true;
+}
+
+QStringList RingConfig::nodeIds() const {
+    QStringList ids;
+    ids.reserve(ringMembers.size());
+    for (const RingMember& member : ringMembers) {
+        ids.append(member.nodeId);
+    }
+    return ids;
+}
+
+int RingConfig::indexOfNode(const QString& nodeId) const {
+    for (int i = 0; i < ringMembers.size(); ++i) {
+        if (ringMembers[i].nodeId == nodeId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int RingConfig::indexOfPort(int port) const {
+    for (int i = 0; i < ringMembers.size(); ++i) {
+        if (ringMembers[i].port == port) {
+            return i;
+        }
+    }
+    return -1;
+}
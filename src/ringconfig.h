@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "nodetable.h"
+
+struct RingMember {
+    QString nodeId;
+    QString host;
+    int port = 0;
+    
+    // Loopback members only listen on loopback; anything else listens on all interfaces
+    QHostAddress listenAddress() const;
+};
+
+// Ring membership in ring order: each member forwards to the one after it and
+// the last wraps around to the first. Loaded from a file with one member per
+// line ("<nodeId> <host>:<port>", '#' starts a comment) or generated as a
+// local ring of consecutive ports.
+class RingConfig {
+public:
+    static constexpr int DefaultBasePort = 9001;
+    static constexpr int DefaultRingSize = 4;
+    // Every member needs a handle that fits the wire header
+    static constexpr int MaxMembers = NodeTable::MaxSharedHandles;
+    
+    // NodeN on 127.0.0.1:<basePort + N - 1>
+    static RingConfig localRing(int size = DefaultRingSize, int basePort = DefaultBasePort);
+    
+    bool load(const QString& path, QString& error);
+    bool parse(const QString& text, QString& error);
+    
+    int size() const { return ringMembers.size(); }
+    bool isEmpty() const { return ringMembers.isEmpty(); }
+    const RingMember& member(int index) const { return ringMembers[index]; }
+    const QList<RingMember>& members() const { return ringMembers; }
+    QStringList nodeIds() const;
+    
+    int indexOfNode(const QString& nodeId) const;
+    int indexOfPort(int port) const;
+    int nextIndex(int index) const { return (index + 1) % ringMembers.size(); }
+
+private:
+    // The indexes (node id -> member, "host:port" -> member) find duplicates without comparing every pair
+    bool addMember(const RingMember& member, QHash<QString, int>& memberOfNode,
+                   QHash<QString, int>& memberOfEndpoint, QString& error);
+    
+    QList<RingMember> ringMembers;
+};
@@ -0,0 +1,77 @@
+#include "ringrouter.h"
+#include <QtGlobal>
+
+RingRouter::RingRouter() : ringSize(0), selfIndex(-1), mode(ShortestDirection) {}
+
+void RingRouter::configure(int ringSize, int selfIndex, Mode mode) {
+    this->ringSize = ringSize;
+    this->selfIndex = selfIndex;
+    this->mode = mode;
+}
+
+int RingRouter::successor() const {
+    return ringSize > 0 ? (selfIndex + 1) % ringSize : -1;
+}
+
+int RingRouter::predecessor() const {
+    return ringSize > 0 ? (selfIndex + ringSize - 1) % ringSize : -1;
+}
+
+int RingRouter::clockwiseDistance(int to) const {
+    return (to - selfIndex + ringSize) % ringSize;
+}
+
+QList<int> RingRouter::neighbors() const {
+    QList<int> members;
+    if (ringSize < 2 || selfIndex < 0) {
+        return members;
+    }
+    members.append(successor());
+    // On a ring of two the predecessor is the successor, and ties never go counter-clockwise anyway
+    if (mode == ShortestDirection && ringSize > 2) {
+        members.append(predecessor());
+    } else if (mode == Finger) {
+        for (int distance = 2; distance < ringSize; distance *= 2) {
+            members.append((selfIndex + distance) % ringSize);
+        }
+    }
+    return members;
+}
+
+int RingRouter::nextHop(int destination) const {
+    if (destination < 0 || destination >= ringSize || destination == selfIndex) {
+        return -1;
+    }
+    if (mode == Clockwise) {
+        return successor();
+    }
+    int clockwise = clockwiseDistance(destination);
+    if (mode == Finger) {
+        // Longest finger that does not pass the destination: the highest power of two in the distance
+        int finger = 1;
+        while (finger * 2 <= clockwise) {
+            finger *= 2;
+        }
+        return (selfIndex + finger) % ringSize;
+    }
+    return clockwise <= ringSize - clockwise ? successor() : predecessor();
+}
+
+int RingRouter::hopCount(int destination) const {
+    if (destination < 0 || destination >= ringSize) {
+        return -1;
+    }
+    int clockwise = clockwiseDistance(destination);
+    if (mode == Clockwise) {
+        return clockwise;
+    }
+    if (mode == Finger) {
+        // Each hop clears the highest set bit of the remaining distance
+        int hops = 0;
+        for (int remaining = clockwise; remaining > 0; remaining &= remaining - 1) {
+            ++hops;
+        }
+        return hops;
+    }
+    return qMin(clockwise, ringSize - clockwise);
+}
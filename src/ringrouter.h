@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QList>
+
+// Next-hop selection on a ring of members addressed by ring index. In
+// Clockwise mode every frame goes to the successor; in ShortestDirection
+// mode it goes whichever way round is fewer hops (ties go clockwise), so a
+// frame keeps travelling in the direction its origin picked. In Finger mode
+// each node also links to the members 2, 4, 8, ... places clockwise of it
+// and takes the longest finger that does not overshoot, Chord style, which
+// reaches any member in at most log2(N) hops.
+class RingRouter {
+public:
+    enum Mode {
+        Clockwise,
+        ShortestDirection,
+        Finger
+    };
+
+    RingRouter();
+
+    void configure(int ringSize, int selfIndex, Mode mode);
+    Mode getMode() const { return mode; }
+    int getRingSize() const { return ringSize; }
+    int getSelfIndex() const { return selfIndex; }
+
+    int successor() const;
+    int predecessor() const;
+    int clockwiseDistance(int to) const;
+
+    // Members this node keeps an outgoing link to
+    QList<int> neighbors() const;
+
+    // Member to hand the frame to, or -1 if the destination is this node or not a member
+    int nextHop(int destination) const;
+    int hopCount(int destination) const;
+
+private:
+    int ringSize;
+    int selfIndex;
+    Mode mode;
+};
@@ -0,0 +1,250 @@
+#include "scrollbacklog.h"
+#include <QDebug>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include <QtEndian>
+#include <functional>
+
+static const int RecordHeaderSize = 5;
+static const int IndexEntrySize = 8;
+
+// Runs queued writes for every scrollback log, in the order they were queued
+class ScrollbackWriter : public QThread {
+public:
+    static ScrollbackWriter& instance() {
+        static ScrollbackWriter writer;
+        return writer;
+    }
+
+    ~ScrollbackWriter() override {
+        // Whatever is still queued is written before the thread exits
+        {
+            QMutexLocker locker(&mutex);
+            stopping = true;
+            wake.wakeAll();
+        }
+        wait();
+    }
+
+    void post(std::function<void()> job) {
+        QMutexLocker locker(&mutex);
+        jobs.enqueue(std::move(job));
+        wake.wakeAll();
+    }
+
+    // Blocks until every job queued so far has run
+    void drain() {
+        QMutexLocker locker(&mutex);
+        while (!jobs.isEmpty() || busy) {
+            idle.wait(&mutex);
+        }
+    }
+
+protected:
+    void run() override {
+        QMutexLocker locker(&mutex);
+        for (;;) {
+            while (jobs.isEmpty() && !stopping) {
+                wake.wait(&mutex);
+            }
+            if (jobs.isEmpty()) {
+                return;
+            }
+            std::function<void()> job = jobs.dequeue();
+            busy = true;
+            locker.unlock();
+            job();
+            locker.relock();
+            busy = false;
+            if (jobs.isEmpty()) {
+                idle.wakeAll();
+            }
+        }
+    }
+
+private:
+    ScrollbackWriter() {
+        setObjectName("scrollback-writer");
+        start();
+    }
+
+    QMutex mutex;
+    QWaitCondition wake;
+    QWaitCondition idle;
+    QQueue<std::function<void()>> jobs;
+    bool busy = false;
+    bool stopping = false;
+};
+
+ScrollbackLog::ScrollbackLog() : records(0), logEnd(0), written(0) {}
+
+ScrollbackLog::~ScrollbackLog() {
+    // Queued writes refer to this log's files
+    if (log.isOpen()) {
+        ScrollbackWriter::instance().drain();
+    }
+}
+
+bool ScrollbackLog::open(const QString& path) {
+    if (log.isOpen()) {
+        ScrollbackWriter::instance().drain();
+    }
+    log.close();
+    index.close();
+    logReader.close();
+    indexReader.close();
+    log.setFileName(path + ".log");
+    index.setFileName(path + ".idx");
+    logReader.setFileName(log.fileName());
+    indexReader.setFileName(index.fileName());
+    if (!log.open(QIODevice::ReadWrite) || !index.open(QIODevice::ReadWrite) ||
+        !logReader.open(QIODevice::ReadOnly) || !indexReader.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open scrollback" << path << ":" << log.errorString() << index.errorString();
+        log.close();
+        index.close();
+        logReader.close();
+        indexReader.close();
+        return false;
+    }
+    
+    // Recovery runs here, before the writer thread can touch the files
+    records = int(index.size() / IndexEntrySize);
+    if (!indexMatchesLog()) {
+        rebuildIndex();
+    }
+    logEnd = log.size();
+    written.storeRelease(records);
+    return true;
+}
+
+bool ScrollbackLog::indexMatchesLog() {
+    if (index.size() % IndexEntrySize != 0) {
+        return false;
+    }
+    if (records == 0) {
+        return log.size() == 0;
+    }
+    
+    // The last indexed record has to end exactly where the log does
+    qint64 offset = offsetOf(records - 1);
+    char header[RecordHeaderSize];
+    if (offset < 0 || !logReader.seek(offset) || logReader.read(header, RecordHeaderSize) != RecordHeaderSize) {
+        return false;
+    }
+    return offset + RecordHeaderSize + qFromBigEndian<quint32>(header) == log.size();
+}
+
+void ScrollbackLog::rebuildIndex() {
+    // Walk the record headers only; a torn record at the tail is cut off
+    QByteArray offsets;
+    qint64 offset = 0;
+    char header[RecordHeaderSize];
+    log.seek(0);
+    while (log.read(header, RecordHeaderSize) == RecordHeaderSize) {
+        qint64 end = offset + RecordHeaderSize + qFromBigEndian<quint32>(header);
+        if (end > log.size()) {
+            break;
+        }
+        char entry[IndexEntrySize];
+        qToBigEndian(offset, entry);
+        offsets.append(entry, IndexEntrySize);
+        offset = end;
+        log.seek(offset);
+    }
+    log.resize(offset);
+    
+    index.resize(0);
+    index.seek(0);
+    index.write(offsets);
+    index.flush();
+    records = int(offsets.size() / IndexEntrySize);
+    qDebug() << "Rebuilt scrollback index for" << log.fileName() << "with" << records << "records";
+}
+
+qint64 ScrollbackLog::offsetOf(int record) {
+    char entry[IndexEntrySize];
+    if (!indexReader.seek(qint64(record) * IndexEntrySize) ||
+        indexReader.read(entry, IndexEntrySize) != IndexEntrySize) {
+        return -1;
+    }
+    return qFromBigEndian<qint64>(entry);
+}
+
+bool ScrollbackLog::append(const QVector<ConversationModel::Entry>& entries) {
+    if (!log.isOpen() || entries.isEmpty()) {
+        return false;
+    }
+    
+    // One write to each file per batch
+    QByteArray recordData;
+    QByteArray indexData;
+    qint64 offset = logEnd;
+    for (const ConversationModel::Entry& entry : entries) {
+        QByteArray text = entry.text.toUtf8();
+        char header[RecordHeaderSize];
+        qToBigEndian(quint32(text.size()), header);
+        header[4] = char(entry.kind);
+        
+        char indexEntry[IndexEntrySize];
+        qToBigEndian(offset + recordData.size(), indexEntry);
+        indexData.append(indexEntry, IndexEntrySize);
+        
+        recordData.append(header, RecordHeaderSize);
+        recordData.append(text);
+    }
+    
+    int firstRecord = records;
+    records += entries.size();
+    logEnd += recordData.size();
+    ScrollbackWriter::instance().post([this, offset, firstRecord, recordData, indexData]() {
+        write(offset, firstRecord, recordData, indexData);
+    });
+    return true;
+}
+
+void ScrollbackLog::write(qint64 offset, int firstRecord, const QByteArray& recordData, const QByteArray& indexData) {
+    log.seek(offset);
+    index.seek(qint64(firstRecord) * IndexEntrySize);
+    if (log.write(recordData) != recordData.size() || index.write(indexData) != indexData.size()) {
+        qDebug() << "Failed to append to scrollback" << log.fileName();
+        return;
+    }
+    log.flush();
+    index.flush();
+    written.storeRelease(firstRecord + int(indexData.size() / IndexEntrySize));
+}
+
+QVector<ConversationModel::Entry> ScrollbackLog::read(int first, int count) {
+    QVector<ConversationModel::Entry> entries;
+    first = qMax(0, first);
+    count = qMin(count, records - first);
+    if (count <= 0) {
+        return entries;
+    }
+    if (first + count > written.loadAcquire()) {
+        ScrollbackWriter::instance().drain();
+        // Short only if a write failed
+        count = qMin(count, written.loadAcquire() - first);
+        if (count <= 0) {
+            return entries;
+        }
+    }
+    
+    qint64 offset = offsetOf(first);
+    if (offset < 0 || !logReader.seek(offset)) {
+        return entries;
+    }
+    
+    // Records are contiguous, so a page is one seek and a sequential read
+    entries.reserve(count);
+    char header[RecordHeaderSize];
+    while (entries.size() < count && logReader.read(header, RecordHeaderSize) == RecordHeaderSize) {
+        ConversationModel::Entry entry;
+        entry.kind = ConversationModel::Kind(quint8(header[4]));
+        entry.text = QString::fromUtf8(logReader.read(qFromBigEndian<quint32>(header)));
+        entries.append(entry);
+    }
+    return entries;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "conversationmodel.h"
+
+// Append-only history of one conversation on disk. Records go to <path>.log
+// as [u32 text length][u8 kind][UTF-8 text]; <path>.idx holds one 8-byte
+// big-endian log offset per record, so record i is found with one read of
+// the index and nothing is held in memory per message. An index that does
+// not match the log after a crash is rebuilt from the log on open.
+//
+// append() only encodes the records; a writer thread shared by every log
+// writes and flushes them, so the UI thread never waits on the disk to add
+// a message. read() uses its own file handles and waits for the writer only
+// when asked for records it has not written yet.
+class ScrollbackLog {
+public:
+    ScrollbackLog();
+    ~ScrollbackLog();
+
+    bool open(const QString& path);
+    bool isOpen() const { return log.isOpen(); }
+
+    // Queues the entries for the writer thread
+    bool append(const QVector<ConversationModel::Entry>& entries);
+    // Includes records the writer thread has not written yet
+    int count() const { return records; }
+
+    // Up to count records starting at first, oldest first
+    QVector<ConversationModel::Entry> read(int first, int count);
+
+private:
+    bool indexMatchesLog();
+    void rebuildIndex();
+    qint64 offsetOf(int record);
+    void write(qint64 offset, int firstRecord, const QByteArray& recordData, const QByteArray& indexData);
+
+    // Written only by the writer thread once open() returns
+    QFile log;
+    QFile index;
+    // Read only by the owning thread
+    QFile logReader;
+    QFile indexReader;
+    int records;
+    qint64 logEnd; // including records still queued
+    QAtomicInt written; // records the writer thread has flushed
+};
@@ -3,57 +3,127 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QDebug>
+#include <QDir>
+#include <QStandardPaths>
 
-const QList<int> SimpleChat::RING_PORTS = {9001, 9002, 9003, 9004};
+// About one display frame at 60 Hz
+static const int UiFlushIntervalMsec = 16;
 
-SimpleChat::SimpleChat(int port, QObject* parent) 
-    : QObject(parent), serverPort(port) {
+SimpleChat::SimpleChat(const RingConfig& ring, int selfIndex, QObject* parent) 
+    : QObject(parent), ring(ring), self(ring.member(selfIndex)),
+      historyRows(ConversationModel::DefaultWindowRows) {
     
-    nodeId = generateNodeId(port);
+    nodeId = self.nodeId;
+    listenAddress = self.listenAddress();
     
     window = new ChatWindow();
     window->setNodeId(nodeId);
+    window->setAvailableNodes(ring.nodeIds());
     
-    networkManager = new NetworkManager(this);
+    // Conversation history beyond the in-memory window is paged from here
+    QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+    dataDir.mkpath("scrollback");
+    window->setScrollbackDirectory(dataDir.filePath("scrollback"));
+    
+    uiFlushTimer = new QTimer(this);
+    uiFlushTimer->setSingleShot(true);
+    uiFlushTimer->setTimerType(Qt::PreciseTimer);
+    connect(uiFlushTimer, &QTimer::timeout, this, &SimpleChat::flushReceivedMessages);
+    
+    // The network manager lives on its own thread so forwarding never waits on the UI;
+    // everything it reports arrives here through queued signals
+    qRegisterMetaType<Message>();
+    networkThread = new QThread(this);
+    networkThread->setObjectName(QString("network-%1").arg(nodeId));
+    
+    networkManager = new NetworkManager();
     networkManager->setNodeId(nodeId);
     
     connect(window, &ChatWindow::messageEntered, this, &SimpleChat::onMessageEntered);
     connect(networkManager, &NetworkManager::messageReceived, this, &SimpleChat::onMessageReceived);
     connect(networkManager, &NetworkManager::connectionEstablished, this, &SimpleChat::onConnectionEstablished);
     connect(networkManager, &NetworkManager::connectionLost, this, &SimpleChat::onConnectionLost);
+    connect(networkManager, &NetworkManager::sendRejected, this, &SimpleChat::onSendRejected);
     
-    if (!networkManager->startServer(port)) {
-        QMessageBox::critical(nullptr, "Error", QString("Failed to start server on port %1").arg(port));
-        QApplication::exit(1);
-        return;
-    }
+    // Messages queued while a neighbor is down survive a restart in these segments
+    networkManager->setOutboundQueueDirectory(OutboundQueue::defaultStorageDirectory());
     
-    setupRingTopology();
-    
-    window->appendMessage(QString("SimpleChat Node %1 started on port %2").arg(nodeId).arg(port));
-    window->appendMessage("Available nodes: Node1 (9001), Node2 (9002), Node3 (9003), Node4 (9004)");
-    window->appendMessage("Select destination from dropdown and type your message");
-    window->appendMessage("Messages will be routed through the ring network");
+    // The scrollback logs already hold every conversation's text; the store keeps the sequence state
+    networkManager->getMessageStore().setStoreText(false);
 }
 
 SimpleChat::~SimpleChat() {
+    // The network manager is deleted on its own thread once the thread's event loop exits
+    networkThread->quit();
+    networkThread->wait();
     delete window;
 }
 
-void SimpleChat::show() {
-    window->show();
+bool SimpleChat::start() {
+    // Conversations from the last run are back before anything new arrives
+    restoreHistory();
+    
+    networkManager->moveToThread(networkThread);
+    connect(networkThread, &QThread::finished, networkManager, &QObject::deleteLater);
+    networkThread->start();
+    
+    // From here on the network manager is only touched from its own thread
+    bool started = false;
+    QMetaObject::invokeMethod(networkManager, [this]() {
+        return networkManager->startServer(self.port, listenAddress);
+    }, Qt::BlockingQueuedConnection, &started);
+    
+    if (!started) {
+        QMessageBox::critical(nullptr, "Error", QString("Failed to start server on port %1").arg(self.port));
+        return false;
+    }
+    
+    QMetaObject::invokeMethod(networkManager, [this]() {
+        networkManager->setRingTopology(ring);
+    }, Qt::QueuedConnection);
+    
+    window->appendMessage(QString("SimpleChat Node %1 started on port %2").arg(nodeId).arg(self.port));
+    if (ring.size() <= 8) {
+        QStringList nodes;
+        for (const RingMember& member : ring.members()) {
+            nodes.append(QString("%1 (%2)").arg(member.nodeId).arg(member.port));
+        }
+        window->appendMessage("Available nodes: " + nodes.join(", "));
+    } else {
+        window->appendMessage(QString("Ring of %1 nodes").arg(ring.size()));
+    }
+    window->appendMessage("Select destination from dropdown and type your message");
+    window->appendMessage("Messages will be routed through the ring network");
+    return true;
 }
 
-QString SimpleChat::generateNodeId(int port) {
-    int nodeNumber = RING_PORTS.indexOf(port) + 1;
-    if (nodeNumber > 0) {
-        return QString("Node%1").arg(nodeNumber);
+void SimpleChat::restoreHistory() {
+    MessageStore& store = networkManager->getMessageStore();
+    if (!store.isOpen() || store.count() == 0) {
+        return;
+    }
+    
+    QMap<QString, QVector<ConversationModel::Entry>> byPeer;
+    for (const MessageStore::Record& record : store.recent(historyRows)) {
+        const Message& message = record.message;
+        if (message.getChatText().isEmpty()) {
+            // Stored without text; the scrollback has it
+            continue;
+        }
+        if (record.direction == MessageStore::Sent) {
+            byPeer[message.getDestination()].append({message.getChatText(), ConversationModel::Sent});
+        } else {
+            byPeer[message.getOrigin()].append({message.getChatText(), ConversationModel::Received});
+        }
+    }
+    for (auto it = byPeer.constBegin(); it != byPeer.constEnd(); ++it) {
+        window->restoreConversation(it.key(), it.value());
     }
-    return QString("Node%1").arg(port);
+    window->appendMessage(QString("Restored %1 stored messages from the previous run").arg(store.count()));
 }
 
-void SimpleChat::setupRingTopology() {
-    networkManager->setRingTopology(RING_PORTS, serverPort);
+void SimpleChat::show() {
+    window->show();
 }
 
 void SimpleChat::onMessageEntered(const QString& text, const QString& destination) {
@@ -71,24 +141,53 @@ void SimpleChat::onMessageEntered(const QString& text, const QString& destinatio
     // Create message with placeholder sequence number (NetworkManager will assign the correct one)
     Message message(trimmedText, nodeId, destination, 1);
     qDebug() << "Sending message from" << nodeId << "to" << destination << ":" << trimmedText;
-    networkManager->sendMessage(message);
+    QMetaObject::invokeMethod(networkManager, [this, message]() {
+        networkManager->sendMessage(message);
+    }, Qt::QueuedConnection);
     
-    // Add to conversation with destination node as sent message
+    // Anything received before this message is shown first so the conversation stays in order
+    flushReceivedMessages();
     window->appendSentMessage(destination, trimmedText);
 }
 
 void SimpleChat::onMessageReceived(const Message& message) {
-    // Add to conversation with sender node as received message
-    window->appendReceivedMessage(message.getOrigin(), message.getChatText());
-    qDebug() << "Message delivered from" << message.getOrigin() << ":" << message.getChatText();
+    // Applied to the window once per display frame instead of one layout and repaint per message
+    pendingReceived.append(message);
+    if (!uiFlushTimer->isActive()) {
+        uiFlushTimer->start(UiFlushIntervalMsec);
+    }
+}
+
+void SimpleChat::flushReceivedMessages() {
+    uiFlushTimer->stop();
+    if (pendingReceived.isEmpty()) {
+        return;
+    }
+    
+    // Group by sender so every conversation gets a single append and scroll
+    QMap<QString, QStringList> byOrigin;
+    for (const Message& message : pendingReceived) {
+        byOrigin[message.getOrigin()].append(message.getChatText());
+    }
+    for (auto it = byOrigin.constBegin(); it != byOrigin.constEnd(); ++it) {
+        window->appendReceivedMessages(it.key(), it.value());
+    }
+    
+    qDebug() << "Delivered" << pendingReceived.size() << "messages from" << byOrigin.size() << "nodes";
+    pendingReceived.clear();
+}
+
+void SimpleChat::onConnectionEstablished(const QString& peerId) {
+    window->appendMessage(QString("Connected to ring network via %1").arg(peerId));
 }
 
-void SimpleChat::onConnectionEstablished() {
-    window->appendMessage("Connected to ring network");
+void SimpleChat::onConnectionLost(const QString& peerId) {
+    window->appendMessage(QString("Lost connection to %1, attempting to reconnect...").arg(peerId));
 }
 
-void SimpleChat::onConnectionLost() {
-    window->appendMessage("Lost connection to ring network, attempting to reconnect...");
+void SimpleChat::onSendRejected(const Message& message) {
+    window->appendMessage(QString("Message to %1 was not sent: outbound queue is full")
+                          .arg(message.getDestination()));
 }
 
 void SimpleChat::setDestinationNode(const QString& destination) {
@@ -1,36 +1,53 @@
 #pragma once
 
 #include <QObject>
+#include <QThread>
 #include <QTimer>
+#include <QVector>
 #include "chatwindow.h"
 #include "networkmanager.h"
+#include "ringconfig.h"
 #include "message.h"
 
 class SimpleChat : public QObject {
     Q_OBJECT
 
 public:
-    explicit SimpleChat(int port, QObject* parent = nullptr);
+    SimpleChat(const RingConfig& ring, int selfIndex, QObject* parent = nullptr);
     ~SimpleChat();
     
+    // Defaults to the member's listenAddress()
+    void setListenAddress(const QHostAddress& address) { listenAddress = address; }
+    void setHistoryRows(int rows) { historyRows = rows; window->setHistoryRows(rows); }
+    bool start();
     void show();
     void setDestinationNode(const QString& destination);
+    
+    // Only safe to configure directly before start(); afterwards it runs on the network thread
+    NetworkManager* getNetworkManager() const { return networkManager; }
 
 private slots:
     void onMessageEntered(const QString& text, const QString& destination);
     void onMessageReceived(const Message& message);
-    void onConnectionEstablished();
-    void onConnectionLost();
+    void onConnectionEstablished(const QString& peerId);
+    void onConnectionLost(const QString& peerId);
+    void onSendRejected(const Message& message);
+    void flushReceivedMessages();
 
 private:
-    void setupRingTopology();
-    QString generateNodeId(int port);
+    void restoreHistory();
     
     ChatWindow* window;
     NetworkManager* networkManager;
-    int serverPort;
+    QThread* networkThread;
+    RingConfig ring;
+    RingMember self;
+    QHostAddress listenAddress;
     QString nodeId;
     QString destinationNode;
+    int historyRows;
     
-    static const QList<int> RING_PORTS;
+    // Received messages wait here until the next display frame
+    QVector<Message> pendingReceived;
+    QTimer* uiFlushTimer;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "tracewriter.h"
+#include <QDebug>
+
+static QByteArray jsonString(const QByteArray& utf8) {
+    QByteArray quoted = "\"";
+    for (char c : utf8) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (quint8(c) < 0x20) {
+            quoted += ' ';
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+static QByteArray hopName(const NodeTable& nodes, quint16 node) {
+    QByteArray name = nodes.utf8NameOf(node);
+    return name.isEmpty() ? QByteArray("?") : name;
+}
+
+TraceWriter::TraceWriter() : tracks(0), unflushed(0) {}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const QString& path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open trace file" << path << ":" << file.errorString();
+        return false;
+    }
+    // The closing bracket is optional in the array format, so a crash still leaves a loadable file
+    file.write("[\n");
+    tracks = 0;
+    unflushed = 0;
+    sinceFlush.start();
+    return true;
+}
+
+void TraceWriter::close() {
+    if (file.isOpen()) {
+        file.write("\n]\n");
+        file.close();
+    }
+}
+
+void TraceWriter::write(const Message& message, const NodeTable& nodes) {
+    if (!file.isOpen() || message.getTraceHops().size() < 2) {
+        return;
+    }
+    if (tracks > 0) {
+        file.write(",\n");
+    }
+    ++tracks;
+    file.write(traceEvents(message, nodes, tracks));
+    if (++unflushed >= FlushEvents || sinceFlush.hasExpired(FlushIntervalMsec)) {
+        flush();
+    }
+}
+
+void TraceWriter::flush() {
+    if (file.isOpen()) {
+        file.flush();
+    }
+    unflushed = 0;
+    sinceFlush.restart();
+}
+
+QByteArray TraceWriter::traceEvents(const Message& message, const NodeTable& nodes, int track) {
+    const QVector<TraceHop>& hops = message.getTraceHops();
+    QByteArray tid = QByteArray::number(track);
+    QByteArray label = message.originUtf8() + " #" + QByteArray::number(message.getSequenceNumber())
+                       + " -> " + message.destinationUtf8();
+
+    QByteArray events = "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid
+                        + ",\"args\":{\"name\":" + jsonString(label) + "}}";
+    for (int i = 0; i + 1 < hops.size(); ++i) {
+        QByteArray from = hopName(nodes, hops[i].node);
+        QByteArray to = hopName(nodes, hops[i + 1].node);
+        events += ",\n{\"name\":" + jsonString(from + " -> " + to) + ",\"cat\":\"hop\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                  + tid + ",\"ts\":" + QByteArray::number(hops[i].usec)
+                  + ",\"dur\":" + QByteArray::number(qMax<qint64>(0, hops[i + 1].usec - hops[i].usec))
+                  + ",\"args\":{\"hop\":" + QByteArray::number(i + 1)
+                  + ",\"seq\":" + QByteArray::number(message.getSequenceNumber()) + "}}";
+    }
+    return events;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include "message.h"
+#include "nodetable.h"
+
+// Writes the hop timelines of traced messages to a Chrome trace file (JSON
+// array format, for chrome://tracing or ui.perfetto.dev). Each message gets
+// its own track, "<origin> #<seq> -> <destination>", with one slice per hop
+// from the time a node recorded the message to the time the next node did.
+// Hop times come from each host's monotonic clock, so slices are exact on
+// one host and only as good as clock agreement across hosts. The file is
+// flushed every FlushEvents messages or FlushIntervalMsec, whichever comes
+// first, so a running node's trace can be opened while it is still writing.
+class TraceWriter {
+public:
+    static constexpr int FlushEvents = 64;
+    static constexpr int FlushIntervalMsec = 1000;
+
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(const QString& path);
+    bool isOpen() const { return file.isOpen(); }
+    void close();
+
+    void write(const Message& message, const NodeTable& nodes);
+    void flush();
+
+    // The events for one message, comma separated; track is the Chrome tid
+    static QByteArray traceEvents(const Message& message, const NodeTable& nodes, int track);
+
+private:
+    QFile file;
+    int tracks;
+    int unflushed;
+    QElapsedTimer sinceFlush;
+};
@@ -0,0 +1,86 @@
+#include "transport.h"
+#include "qttransport.h"
+#include "receivebuffer.h"
+#ifdef SIMPLECHAT_HAVE_EPOLL
+#include "epolltransport.h"
+#endif
+#ifdef SIMPLECHAT_HAVE_IO_URING
+#include "uringtransport.h"
+#endif
+
+qint64 Connection::readInto(ReceiveBuffer& buffer) {
+    return buffer.readFrom(this);
+}
+
+Transport* Transport::create(Backend backend, QObject* parent) {
+    switch (backend) {
+    case QtSockets:
+        return new QtTransport(parent);
+    case Epoll:
+#ifdef SIMPLECHAT_HAVE_EPOLL
+        return new EpollTransport(parent);
+#else
+        return nullptr;
+#endif
+    case IoUring:
+#ifdef SIMPLECHAT_HAVE_IO_URING
+    {
+        // The constructor says why when the kernel will not set the ring up
+        UringTransport* transport = new UringTransport(parent);
+        if (!transport->isValid()) {
+            delete transport;
+            return nullptr;
+        }
+        return transport;
+    }
+#else
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+bool Transport::isAvailable(Backend backend) {
+    switch (backend) {
+    case QtSockets:
+        return true;
+    case Epoll:
+#ifdef SIMPLECHAT_HAVE_EPOLL
+        return true;
+#else
+        return false;
+#endif
+    case IoUring:
+#ifdef SIMPLECHAT_HAVE_IO_URING
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool Transport::parseBackend(const QString& name, Backend& backend) {
+    if (name == "qt") {
+        backend = QtSockets;
+    } else if (name == "epoll") {
+        backend = Epoll;
+    } else if (name == "uring") {
+        backend = IoUring;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString Transport::backendName(Backend backend) {
+    switch (backend) {
+    case QtSockets:
+        return "qt";
+    case Epoll:
+        return "epoll";
+    case IoUring:
+        return "uring";
+    }
+    return QString();
+}
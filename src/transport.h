@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QHostAddress>
+#include <QIODevice>
+#include <QObject>
+#include <QString>
+
+class ReceiveBuffer;
+
+// A stream connection handed out by a Transport. It is a sequential
+// QIODevice, so FrameBatcher writes to it like any socket; readInto() fills
+// a ReceiveBuffer, and backends override it to read without going through
+// QIODevice's buffering.
+class Connection : public QIODevice {
+    Q_OBJECT
+
+public:
+    // A closing connection whose peer stops reading is closed anyway after this
+    static constexpr int CloseTimeoutMsec = 5000;
+
+    explicit Connection(QObject* parent = nullptr) : QIODevice(parent) {}
+
+    virtual void connectToHost(const QString& host, quint16 port) = 0;
+    // Like QAbstractSocket: what was already written is sent before the connection closes
+    virtual void disconnectFromHost() = 0;
+    virtual bool isConnected() const = 0;
+    virtual QString peerAddress() const = 0;
+
+    virtual qint64 readInto(ReceiveBuffer& buffer);
+
+    bool isSequential() const override { return true; }
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred();
+};
+
+// Listens for and opens Connections. NetworkManager only talks to this
+// interface, so the socket layer underneath can be swapped: QtSockets runs
+// everywhere, Epoll is a leaner Linux backend for headless and relay nodes,
+// and IoUring takes system calls off the receive path for busy relays.
+// Transports register with the event loop of the thread they are created
+// on and have to stay there.
+class Transport : public QObject {
+    Q_OBJECT
+
+public:
+    enum Backend {
+        QtSockets,
+        Epoll,
+        IoUring
+    };
+
+    explicit Transport(QObject* parent = nullptr) : QObject(parent) {}
+
+    // nullptr when the backend is not built in, or the kernel refuses it (io_uring)
+    static Transport* create(Backend backend, QObject* parent = nullptr);
+    // Built in; whether the kernel supports it shows only when create() is tried
+    static bool isAvailable(Backend backend);
+    static bool parseBackend(const QString& name, Backend& backend);
+    static QString backendName(Backend backend);
+
+    virtual Backend backend() const = 0;
+    virtual bool listen(const QHostAddress& address, quint16 port) = 0;
+    virtual void close() = 0;
+    virtual QString errorString() const = 0;
+
+    // An unconnected outgoing connection; connectToHost() starts it
+    virtual Connection* createConnection(QObject* parent = nullptr) = 0;
+
+signals:
+    // Accepted connections are open and connected; the receiver takes ownership
+    void newConnection(Connection* connection);
+};
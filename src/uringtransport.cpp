@@ -0,0 +1,703 @@
+#include "uringtransport.h"
+#include <QMetaObject>
+#include <QTimer>
+#include "logging.h"
+#include "posixsocket.h"
+#include "receivebuffer.h"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static char* mapMemory(size_t size) {
+    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<char*>(memory);
+}
+
+UringConnection::UringConnection(UringTransport* transport, QObject* parent)
+    : Connection(parent), transport(transport), id(0), fd(-1), state(Unconnected), addressLength(0),
+      receiveArmed(false), peerClosed(false), receivedBytes(0), sendInFlight(false), unsentBytes(0) {}
+
+UringConnection::UringConnection(UringTransport* transport, int fd, const QString& peer, QObject* parent)
+    : Connection(parent), transport(transport), id(0), fd(fd), state(Unconnected), peer(peer), addressLength(0),
+      receiveArmed(false), peerClosed(false), receivedBytes(0), sendInFlight(false), unsentBytes(0) {
+    PosixSocket::setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    id = transport->attach(this);
+    start();
+}
+
+UringConnection::~UringConnection() {
+    closeSocket();
+}
+
+void UringConnection::connectToHost(const QString& host, quint16 port) {
+    closeSocket();
+    if (!transport) {
+        fail("Transport is gone");
+        return;
+    }
+
+    QHostAddress resolved;
+    QString resolveError;
+    if (!PosixSocket::resolve(host, resolved, resolveError)) {
+        fail(resolveError);
+        return;
+    }
+    if (!PosixSocket::toSockaddr(resolved, port, address, addressLength)) {
+        fail(QString("Unsupported address %1").arg(resolved.toString()));
+        return;
+    }
+
+    // Blocking sockets: io_uring waits for readiness itself, and older kernels hand EAGAIN back for non-blocking ones
+    fd = ::socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fail(PosixSocket::errorString(errno));
+        return;
+    }
+    PosixSocket::setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    peer = resolved.toString();
+
+    io_uring_sqe* sqe = transport->nextSqe();
+    if (!sqe) {
+        fail("io_uring submission queue is full");
+        return;
+    }
+    id = transport->attach(this);
+    io_uring_prep_connect(sqe, fd, reinterpret_cast<sockaddr*>(&address), addressLength);
+    io_uring_sqe_set_data64(sqe, UringTransport::userData(UringTransport::Connect, id));
+    state = Connecting;
+    transport->submit();
+}
+
+void UringConnection::disconnectFromHost() {
+    if (state == Unconnected || state == Closing) {
+        return;
+    }
+    if (state == Connected && unsentBytes > 0 && transport) {
+        // Like QAbstractSocket: what was written still goes out, then the socket closes
+        state = Closing;
+        quint32 closingId = id;
+        QTimer::singleShot(CloseTimeoutMsec, this, [this, closingId]() {
+            if (state == Closing && id == closingId) {
+                finishClose();
+            }
+        });
+        return;
+    }
+    bool wasConnected = state == Connected;
+    closeSocket();
+    if (wasConnected) {
+        emit disconnected();
+    }
+}
+
+void UringConnection::finishClose() {
+    closeSocket();
+    emit disconnected();
+}
+
+void UringConnection::start() {
+    state = Connected;
+    peerClosed = false;
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    armReceive();
+}
+
+void UringConnection::armReceive() {
+    io_uring_sqe* sqe = transport->nextSqe();
+    if (!sqe) {
+        failLater("io_uring submission queue is full");
+        return;
+    }
+    if (transport->multishotReceive) {
+        io_uring_prep_recv_multishot(sqe, fd, nullptr, 0, 0);
+    } else {
+        io_uring_prep_recv(sqe, fd, nullptr, 0, 0);
+    }
+    // The kernel picks a buffer from the ring when data arrives
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = UringTransport::BufferGroup;
+    io_uring_sqe_set_data64(sqe, UringTransport::userData(UringTransport::Receive, id));
+    receiveArmed = true;
+}
+
+void UringConnection::onConnected(int result) {
+    if (result < 0) {
+        fail(PosixSocket::errorString(-result));
+        return;
+    }
+    start();
+    emit connected();
+}
+
+void UringConnection::onReceived(int result, quint32 flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        receiveArmed = false;
+    }
+
+    if (result > 0) {
+        received.append({quint16(flags >> IORING_CQE_BUFFER_SHIFT), 0, result});
+        receivedBytes += result;
+        transport->markReadable(id);
+    } else if (result == 0) {
+        // End of stream; acted on once the reader has had everything before it
+        peerClosed = true;
+        transport->markReadable(id);
+        return;
+    } else if (result == -ENOBUFS) {
+        // Re-armed as soon as a reader hands buffers back
+        transport->starved.append(id);
+        return;
+    } else if (result == -EINVAL && transport->multishotReceive) {
+        // The kernel lacks multishot receive; one receive per completion from here on
+        SC_LOG(Info, "uring-single-receive", LogField("fd", fd));
+        transport->multishotReceive = false;
+    } else if (result == -ECANCELED) {
+        return;
+    } else if (result < 0) {
+        fail(PosixSocket::errorString(-result));
+        return;
+    }
+
+    if (state == Connected && !receiveArmed) {
+        armReceive();
+    }
+}
+
+void UringConnection::notifyReadable() {
+    if (receivedBytes > 0) {
+        emit readyRead();
+    }
+    if (state != Unconnected && peerClosed) {
+        finishClose();
+    }
+}
+
+qint64 UringConnection::readInto(ReceiveBuffer& buffer) {
+    if (!transport || received.isEmpty()) {
+        return 0;
+    }
+    qint64 total = receivedBytes;
+    for (const Received& chunk : received) {
+        buffer.append(transport->receiveBuffer(chunk.buffer) + chunk.offset, chunk.length);
+        transport->recycle(chunk.buffer);
+    }
+    received.resize(0);
+    receivedBytes = 0;
+    return total;
+}
+
+qint64 UringConnection::readData(char* data, qint64 maxSize) {
+    if (received.isEmpty()) {
+        return state == Connected ? 0 : -1;
+    }
+    qint64 copied = 0;
+    while (copied < maxSize && !received.isEmpty()) {
+        Received& chunk = received.first();
+        int length = int(qMin<qint64>(chunk.length, maxSize - copied));
+        std::memcpy(data + copied, transport->receiveBuffer(chunk.buffer) + chunk.offset, size_t(length));
+        copied += length;
+        chunk.offset += length;
+        chunk.length -= length;
+        if (chunk.length == 0) {
+            transport->recycle(chunk.buffer);
+            received.removeFirst();
+        }
+    }
+    receivedBytes -= copied;
+    return copied;
+}
+
+qint64 UringConnection::writeData(const char* data, qint64 size) {
+    if (state != Connected || !transport) {
+        return -1;
+    }
+    queueSend(data, size);
+    sendNext();
+    transport->submit();
+    return size;
+}
+
+void UringConnection::queueSend(const char* data, qint64 size) {
+    unsentBytes += size;
+    // Once anything waits in the backlog, later bytes queue behind it
+    if (!backlog.isEmpty()) {
+        backlog.append(data, int(size));
+        return;
+    }
+    while (size > 0) {
+        if (outgoing.isEmpty() || outgoing.last().submitted
+            || outgoing.last().offset + outgoing.last().length == UringTransport::SendSlotSize) {
+            int slot = transport->acquireSlot();
+            if (slot < 0) {
+                backlog.append(data, int(size));
+                return;
+            }
+            outgoing.append({slot, 0, 0, false});
+        }
+        Outgoing& tail = outgoing.last();
+        int room = UringTransport::SendSlotSize - tail.offset - tail.length;
+        int chunk = int(qMin<qint64>(size, room));
+        std::memcpy(transport->slotData(tail.slot) + tail.offset + tail.length, data, size_t(chunk));
+        tail.length += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void UringConnection::fillFromBacklog() {
+    if (backlog.isEmpty()) {
+        return;
+    }
+    QByteArray waiting;
+    waiting.swap(backlog);
+    unsentBytes -= waiting.size();
+    queueSend(waiting.constData(), waiting.size());
+}
+
+void UringConnection::sendNext() {
+    // One send at a time keeps the stream in order; short sends are resubmitted from where they stopped
+    if (sendInFlight || outgoing.isEmpty() || !transport) {
+        return;
+    }
+    io_uring_sqe* sqe = transport->nextSqe();
+    if (!sqe) {
+        failLater("io_uring submission queue is full");
+        return;
+    }
+
+    Outgoing& head = outgoing.first();
+    const char* data = transport->slotData(head.slot) + head.offset;
+    if (transport->zeroCopySend && head.length >= UringTransport::ZeroCopyMinBytes) {
+        if (transport->registeredBuffers) {
+            io_uring_prep_send_zc_fixed(sqe, fd, data, size_t(head.length), MSG_NOSIGNAL, 0, unsigned(head.slot));
+        } else {
+            io_uring_prep_send_zc(sqe, fd, data, size_t(head.length), MSG_NOSIGNAL, 0);
+        }
+    } else {
+        io_uring_prep_send(sqe, fd, data, size_t(head.length), MSG_NOSIGNAL);
+    }
+    io_uring_sqe_set_data64(sqe, UringTransport::userData(UringTransport::Send, id, head.slot));
+    transport->retainSlot(head.slot);
+    head.submitted = true;
+    sendInFlight = true;
+}
+
+void UringConnection::onSent(int result) {
+    sendInFlight = false;
+    if (result == -ECANCELED) {
+        return;
+    }
+    if (result < 0) {
+        fail(PosixSocket::errorString(-result));
+        return;
+    }
+    if (outgoing.isEmpty()) {
+        return;
+    }
+
+    Outgoing& head = outgoing.first();
+    head.offset += result;
+    head.length -= result;
+    unsentBytes -= result;
+    if (head.length == 0) {
+        transport->releaseSlot(head.slot);
+        outgoing.removeFirst();
+        fillFromBacklog();
+    }
+    sendNext();
+    emit bytesWritten(result);
+    if (state == Closing && unsentBytes == 0) {
+        finishClose();
+    }
+}
+
+void UringConnection::fail(const QString& error) {
+    bool wasConnected = state == Connected || state == Closing;
+    setErrorString(error);
+    closeSocket();
+    emit errorOccurred();
+    if (wasConnected) {
+        emit disconnected();
+    }
+}
+
+void UringConnection::failLater(const QString& error) {
+    // Reported from the event loop, so callers in the middle of a write never see the connection go
+    setErrorString(error);
+    QMetaObject::invokeMethod(this, [this, error]() { fail(error); }, Qt::QueuedConnection);
+}
+
+void UringConnection::closeSocket() {
+    if (transport) {
+        if (id != 0) {
+            // Completions still on their way for this socket are dropped from here on
+            transport->detach(id);
+        }
+        if (fd >= 0) {
+            // Ends the armed receive and any send in flight; their slots come back with the completions
+            ::shutdown(fd, SHUT_RDWR);
+            transport->cancel(fd);
+        }
+        for (const Outgoing& pending : outgoing) {
+            transport->releaseSlot(pending.slot);
+        }
+        for (const Received& chunk : received) {
+            transport->recycle(chunk.buffer);
+        }
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    id = 0;
+    state = Unconnected;
+    receiveArmed = false;
+    peerClosed = false;
+    received.resize(0);
+    receivedBytes = 0;
+    outgoing.resize(0);
+    sendInFlight = false;
+    backlog.resize(0);
+    unsentBytes = 0;
+    if (isOpen()) {
+        close();
+    }
+}
+
+UringTransport::UringTransport(QObject* parent)
+    : Transport(parent), ringOpen(false), valid(false), multishotReceive(true), zeroCopySend(false),
+      registeredBuffers(false), eventFd(-1), notifier(nullptr), bufferRing(nullptr), receiveMemory(nullptr),
+      sendMemory(nullptr), listenFd(-1), listenGeneration(0), acceptLength(0), dispatching(false),
+      slotsFreed(false), nextId(1) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = CompletionDepth;
+    int result = io_uring_queue_init_params(QueueDepth, &ring, &params);
+    if (result < 0) {
+        // ENOSYS on old kernels, EPERM when disabled by sysctl or a seccomp filter
+        error = "io_uring is not available: " + PosixSocket::errorString(-result);
+        SC_LOG(Warning, "uring-unavailable", LogField("errno", -result));
+        return;
+    }
+    ringOpen = true;
+
+    bool supported = false;
+    if (io_uring_probe* probe = io_uring_get_probe_ring(&ring)) {
+        supported = io_uring_opcode_supported(probe, IORING_OP_RECV) && io_uring_opcode_supported(probe, IORING_OP_SEND)
+                    && io_uring_opcode_supported(probe, IORING_OP_ACCEPT)
+                    && io_uring_opcode_supported(probe, IORING_OP_CONNECT)
+                    && io_uring_opcode_supported(probe, IORING_OP_ASYNC_CANCEL);
+        zeroCopySend = io_uring_opcode_supported(probe, IORING_OP_SEND_ZC);
+        io_uring_free_probe(probe);
+    }
+    if (!supported) {
+        error = "io_uring lacks socket operations on this kernel";
+        SC_LOG(Warning, "uring-unsupported", LogField("op", "socket"));
+        return;
+    }
+
+    // Receive buffers are handed to the kernel through a buffer ring (5.19+)
+    receiveMemory = mapMemory(size_t(ReceiveBufferCount) * ReceiveBufferSize);
+    if (receiveMemory) {
+        bufferRing = io_uring_setup_buf_ring(&ring, ReceiveBufferCount, BufferGroup, 0, &result);
+    }
+    if (!bufferRing) {
+        int reason = receiveMemory ? -result : errno;
+        error = "io_uring buffer rings are not available: " + PosixSocket::errorString(reason);
+        SC_LOG(Warning, "uring-no-buffer-ring", LogField("errno", reason));
+        return;
+    }
+    int mask = io_uring_buf_ring_mask(ReceiveBufferCount);
+    for (int i = 0; i < ReceiveBufferCount; ++i) {
+        io_uring_buf_ring_add(bufferRing, receiveBuffer(i), ReceiveBufferSize, quint16(i), mask, i);
+    }
+    io_uring_buf_ring_advance(bufferRing, ReceiveBufferCount);
+
+    // Registered send slots are pinned once, instead of on every zero-copy send
+    sendMemory = mapMemory(size_t(SendSlotCount) * SendSlotSize);
+    if (!sendMemory) {
+        int reason = errno;
+        error = "Cannot allocate io_uring send slots: " + PosixSocket::errorString(reason);
+        SC_LOG(Warning, "uring-no-send-slots", LogField("errno", reason));
+        return;
+    }
+    QVector<iovec> vectors(SendSlotCount);
+    for (int i = 0; i < SendSlotCount; ++i) {
+        vectors[i].iov_base = slotData(i);
+        vectors[i].iov_len = SendSlotSize;
+        freeSlots.append(SendSlotCount - 1 - i);
+    }
+    slotRefs.fill(0, SendSlotCount);
+    registeredBuffers = io_uring_register_buffers(&ring, vectors.constData(), unsigned(SendSlotCount)) == 0;
+    if (!registeredBuffers) {
+        // Usually RLIMIT_MEMLOCK; sends then come from unregistered memory
+        SC_LOG(Info, "uring-unregistered-slots", LogField("slots", SendSlotCount));
+    }
+
+    eventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0 || io_uring_register_eventfd(&ring, eventFd) < 0) {
+        int reason = errno;
+        error = "Cannot watch io_uring completions: " + PosixSocket::errorString(reason);
+        SC_LOG(Warning, "uring-no-eventfd", LogField("errno", reason));
+        return;
+    }
+    notifier = new QSocketNotifier(eventFd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &UringTransport::onCompletions);
+    valid = true;
+
+    SC_LOG(Info, "uring-ready", LogField("zero_copy", zeroCopySend), LogField("registered", registeredBuffers));
+}
+
+UringTransport::~UringTransport() {
+    close();
+    // Connections owned elsewhere lose their transport (QPointer) once this is gone
+    const QList<UringConnection*> attached = connections.values();
+    for (UringConnection* connection : attached) {
+        connection->closeSocket();
+    }
+    delete notifier;
+    if (bufferRing) {
+        io_uring_free_buf_ring(&ring, bufferRing, ReceiveBufferCount, BufferGroup);
+    }
+    if (ringOpen) {
+        io_uring_queue_exit(&ring);
+    }
+    if (eventFd >= 0) {
+        ::close(eventFd);
+    }
+    if (receiveMemory) {
+        ::munmap(receiveMemory, size_t(ReceiveBufferCount) * ReceiveBufferSize);
+    }
+    if (sendMemory) {
+        ::munmap(sendMemory, size_t(SendSlotCount) * SendSlotSize);
+    }
+}
+
+bool UringTransport::listen(const QHostAddress& address, quint16 port) {
+    close();
+    if (!valid) {
+        return false;
+    }
+    listenFd = PosixSocket::listen(address, port, 0, error);
+    if (listenFd < 0) {
+        return false;
+    }
+    armAccept();
+    submit();
+    return true;
+}
+
+void UringTransport::close() {
+    if (listenFd >= 0) {
+        // Wakes the pending accept; the new generation makes its completion a no-op
+        ::shutdown(listenFd, SHUT_RDWR);
+        cancel(listenFd);
+        ::close(listenFd);
+        listenFd = -1;
+        ++listenGeneration;
+    }
+}
+
+void UringTransport::armAccept() {
+    io_uring_sqe* sqe = nextSqe();
+    if (!sqe) {
+        SC_LOG(Warning, "uring-accept-stalled", LogField("fd", listenFd));
+        return;
+    }
+    acceptLength = sizeof(acceptAddress);
+    io_uring_prep_accept(sqe, listenFd, reinterpret_cast<sockaddr*>(&acceptAddress), &acceptLength, SOCK_CLOEXEC);
+    io_uring_sqe_set_data64(sqe, userData(Accept, listenGeneration));
+}
+
+io_uring_sqe* UringTransport::nextSqe() {
+    io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    if (!sqe) {
+        io_uring_submit(&ring);
+        sqe = io_uring_get_sqe(&ring);
+    }
+    return sqe;
+}
+
+void UringTransport::submit() {
+    // While completions are being handled, everything they queue goes out in one submit at the end
+    if (!dispatching) {
+        io_uring_submit(&ring);
+    }
+}
+
+void UringTransport::cancel(int fd) {
+    // Submitted right away: the cancel has to reach the kernel before the descriptor is closed
+    if (io_uring_sqe* sqe = nextSqe()) {
+        io_uring_prep_cancel_fd(sqe, fd, IORING_ASYNC_CANCEL_ALL);
+        io_uring_sqe_set_data64(sqe, userData(Cancel, 0));
+        io_uring_submit(&ring);
+    }
+}
+
+quint32 UringTransport::attach(UringConnection* connection) {
+    quint32 id = nextId++;
+    if (nextId == 0) {
+        nextId = 1;
+    }
+    connections.insert(id, connection);
+    return id;
+}
+
+void UringTransport::detach(quint32 id) {
+    connections.remove(id);
+    starved.removeAll(id);
+}
+
+void UringTransport::recycle(int index) {
+    io_uring_buf_ring_add(bufferRing, receiveBuffer(index), ReceiveBufferSize, quint16(index),
+                          io_uring_buf_ring_mask(ReceiveBufferCount), 0);
+    io_uring_buf_ring_advance(bufferRing, 1);
+
+    if (!starved.isEmpty()) {
+        QVector<quint32> waiting;
+        waiting.swap(starved);
+        for (quint32 id : waiting) {
+            UringConnection* connection = connections.value(id, nullptr);
+            if (connection && connection->state == UringConnection::Connected && !connection->receiveArmed) {
+                connection->armReceive();
+            }
+        }
+        submit();
+    }
+}
+
+int UringTransport::acquireSlot() {
+    if (freeSlots.isEmpty()) {
+        return -1;
+    }
+    int slot = freeSlots.takeLast();
+    slotRefs[slot] = 1;
+    return slot;
+}
+
+void UringTransport::releaseSlot(int slot) {
+    if (--slotRefs[slot] > 0) {
+        return;
+    }
+    freeSlots.append(slot);
+    if (dispatching) {
+        slotsFreed = true;
+    } else {
+        serveBacklogs();
+    }
+}
+
+void UringTransport::serveBacklogs() {
+    bool queued = false;
+    for (UringConnection* connection : connections) {
+        if (!connection->backlog.isEmpty()) {
+            connection->fillFromBacklog();
+            connection->sendNext();
+            queued = true;
+        }
+        if (freeSlots.isEmpty()) {
+            break;
+        }
+    }
+    if (queued) {
+        submit();
+    }
+}
+
+void UringTransport::onCompletions() {
+    quint64 signalled;
+    if (::read(eventFd, &signalled, sizeof(signalled)) < 0 && errno != EAGAIN) {
+        SC_LOG(Warning, "uring-eventfd-error", LogField("errno", errno));
+    }
+
+    dispatching = true;
+    io_uring_cqe* cqe;
+    while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+        // Copied out and marked seen first, so handlers are free to queue more work
+        quint64 data = io_uring_cqe_get_data64(cqe);
+        int result = cqe->res;
+        quint32 flags = cqe->flags;
+        io_uring_cqe_seen(&ring, cqe);
+        dispatch(data, result, flags);
+    }
+    dispatching = false;
+
+    if (slotsFreed) {
+        slotsFreed = false;
+        serveBacklogs();
+    }
+
+    // One readyRead per connection for everything that arrived in this pass
+    QVector<quint32> ready;
+    ready.swap(readable);
+    for (quint32 id : ready) {
+        if (UringConnection* connection = connections.value(id, nullptr)) {
+            connection->notifyReadable();
+        }
+    }
+    io_uring_submit(&ring);
+}
+
+void UringTransport::dispatch(quint64 data, int result, quint32 flags) {
+    Operation operation = Operation(data >> 56);
+    int slot = int((data >> 32) & 0xFFFF);
+    quint32 owner = quint32(data);
+
+    if (operation == Send) {
+        // A zero-copy send completes twice: the result, then a notification once the slot is free again
+        if (flags & IORING_CQE_F_NOTIF) {
+            releaseSlot(slot);
+            return;
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+            releaseSlot(slot);
+        }
+    }
+
+    if (operation == Accept) {
+        if (owner != listenGeneration || listenFd < 0) {
+            if (result >= 0) {
+                ::close(result);
+            }
+            return;
+        }
+        if (result >= 0) {
+            QHostAddress peer(reinterpret_cast<sockaddr*>(&acceptAddress));
+            emit newConnection(new UringConnection(this, result, peer.toString(), this));
+        } else if (result != -ECANCELED) {
+            SC_LOG(Debug, "uring-accept-error", LogField("errno", -result));
+        }
+        if (listenFd >= 0 && owner == listenGeneration) {
+            armAccept();
+        }
+        return;
+    }
+
+    UringConnection* connection = connections.value(owner, nullptr);
+    if (!connection) {
+        // The socket was closed meanwhile; a buffer it was given still goes back to the ring
+        if (operation == Receive && (flags & IORING_CQE_F_BUFFER)) {
+            recycle(int(flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+
+    switch (operation) {
+    case Connect:
+        connection->onConnected(result);
+        break;
+    case Receive:
+        connection->onReceived(result, flags);
+        break;
+    case Send:
+        connection->onSent(result);
+        break;
+    default:
+        break;
+    }
+}
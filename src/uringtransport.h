@@ -0,0 +1,201 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QPointer>
+#include <QSocketNotifier>
+#include <QVector>
+#include <liburing.h>
+#include <sys/socket.h>
+#include "transport.h"
+
+class UringTransport;
+
+// TCP socket driven by a UringTransport. One multishot receive stays armed
+// per socket and the kernel fills buffers from the transport's buffer ring,
+// so reading costs no system call; readInto() copies them into the
+// ReceiveBuffer and hands them straight back. Writes are copied into
+// registered send slots and sent one at a time in order, zero-copy for
+// slots big enough to be worth it; when every slot is in use they wait in
+// a backlog. TCP_NODELAY is always on. disconnectFromHost() closes only
+// once everything written has been sent (or CloseTimeoutMsec has passed),
+// as QTcpSocket does.
+class UringConnection : public Connection {
+    Q_OBJECT
+
+public:
+    UringConnection(UringTransport* transport, QObject* parent = nullptr);
+    // Takes over an accepted, connected socket
+    UringConnection(UringTransport* transport, int fd, const QString& peer, QObject* parent = nullptr);
+    ~UringConnection() override;
+
+    void connectToHost(const QString& host, quint16 port) override;
+    void disconnectFromHost() override;
+    bool isConnected() const override { return state == Connected; }
+    QString peerAddress() const override { return peer; }
+    qint64 readInto(ReceiveBuffer& buffer) override;
+
+    qint64 bytesAvailable() const override { return receivedBytes; }
+    qint64 bytesToWrite() const override { return unsentBytes; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+private:
+    friend class UringTransport;
+
+    enum State {
+        Unconnected,
+        Connecting,
+        Connected,
+        Closing // sending what is left before closing
+    };
+
+    // Data the kernel put in one of the transport's receive buffers
+    struct Received {
+        quint16 buffer;
+        int offset;
+        int length;
+    };
+
+    // Bytes waiting in a send slot; nothing is added once it has been submitted
+    struct Outgoing {
+        int slot;
+        int offset;
+        int length;
+        bool submitted;
+    };
+
+    void start();
+    void armReceive();
+    void onConnected(int result);
+    void onReceived(int result, quint32 flags);
+    void onSent(int result);
+    void notifyReadable();
+    void queueSend(const char* data, qint64 size);
+    void sendNext();
+    void fillFromBacklog();
+    void finishClose();
+    void fail(const QString& error);
+    void failLater(const QString& error);
+    void closeSocket();
+
+    QPointer<UringTransport> transport;
+    quint32 id; // changes with every socket, so completions for an old one are ignored
+    int fd;
+    State state;
+    QString peer;
+    sockaddr_storage address;
+    socklen_t addressLength;
+    bool receiveArmed;
+    bool peerClosed;
+    QVector<Received> received;
+    qint64 receivedBytes;
+    QVector<Outgoing> outgoing;
+    bool sendInFlight;
+    QByteArray backlog;
+    qint64 unsentBytes;
+};
+
+// Linux io_uring backend for relay-heavy nodes. Completions are signalled
+// through an eventfd watched by a single QSocketNotifier, and every
+// completion that arrived by then is handled in one pass, with one
+// readyRead per connection and one io_uring_submit() at the end.
+//
+// Features are picked at runtime: multishot receive falls back to one
+// receive per completion on kernels without it, zero-copy send is used only
+// when IORING_OP_SEND_ZC is there, and send slots that cannot be registered
+// (RLIMIT_MEMLOCK) are sent from as plain memory. If the ring or its
+// receive buffer ring cannot be set up at all, isValid() is false and
+// Transport::create() returns nullptr so the caller can fall back.
+class UringTransport : public Transport {
+    Q_OBJECT
+
+public:
+    static constexpr unsigned QueueDepth = 256;
+    static constexpr unsigned CompletionDepth = 4096;
+    static constexpr int BufferGroup = 0;
+    static constexpr int ReceiveBufferCount = 256; // power of two
+    static constexpr int ReceiveBufferSize = 16 * 1024;
+    static constexpr int SendSlotCount = 32;
+    static constexpr int SendSlotSize = 64 * 1024;
+    // Below this a zero-copy send costs more (page pinning, a second completion) than the copy it saves
+    static constexpr int ZeroCopyMinBytes = 16 * 1024;
+
+    explicit UringTransport(QObject* parent = nullptr);
+    ~UringTransport() override;
+
+    bool isValid() const { return valid; }
+
+    Backend backend() const override { return IoUring; }
+    bool listen(const QHostAddress& address, quint16 port) override;
+    void close() override;
+    QString errorString() const override { return error; }
+    Connection* createConnection(QObject* parent = nullptr) override { return new UringConnection(this, parent); }
+
+private slots:
+    void onCompletions();
+
+private:
+    friend class UringConnection;
+
+    enum Operation : quint8 {
+        Accept = 1,
+        Connect,
+        Receive,
+        Send,
+        Cancel
+    };
+
+    static constexpr int NoSlot = 0xFFFF;
+
+    // Operation, send slot and owner (connection id or listen generation) packed into the user data
+    static quint64 userData(Operation operation, quint32 owner, int slot = NoSlot) {
+        return (quint64(operation) << 56) | (quint64(quint16(slot)) << 32) | owner;
+    }
+
+    io_uring_sqe* nextSqe();
+    void submit();
+    void cancel(int fd);
+    void armAccept();
+    void dispatch(quint64 data, int result, quint32 flags);
+
+    quint32 attach(UringConnection* connection);
+    void detach(quint32 id);
+    void markReadable(quint32 id) { readable.append(id); }
+
+    char* receiveBuffer(int index) const { return receiveMemory + size_t(index) * ReceiveBufferSize; }
+    void recycle(int index);
+
+    char* slotData(int slot) const { return sendMemory + size_t(slot) * SendSlotSize; }
+    int acquireSlot();
+    void retainSlot(int slot) { ++slotRefs[slot]; }
+    void releaseSlot(int slot);
+    void serveBacklogs();
+
+    io_uring ring;
+    bool ringOpen;
+    bool valid;
+    bool multishotReceive;
+    bool zeroCopySend;
+    bool registeredBuffers;
+    int eventFd;
+    QSocketNotifier* notifier;
+    io_uring_buf_ring* bufferRing;
+    char* receiveMemory;
+    char* sendMemory;
+    QVector<int> freeSlots;
+    QVector<int> slotRefs; // the connection holding the slot, plus one per send in flight
+    int listenFd;
+    quint32 listenGeneration;
+    sockaddr_storage acceptAddress;
+    socklen_t acceptLength;
+    bool dispatching;
+    bool slotsFreed;
+    quint32 nextId;
+    QHash<quint32, UringConnection*> connections;
+    QVector<quint32> readable; // connections to tell about new data once this pass is done
+    QVector<quint32> starved;  // connections whose receive stopped for lack of buffers
+    QString error;
+};
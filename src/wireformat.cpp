@@ -0,0 +1,429 @@
+#include "wireformat.h"
+#include "payloadpool.h"
+#include <QDataStream>
+#include <QtEndian>
+#include <climits>
+
+bool WireFormat::isBinaryFrame(const char* data, int size) {
+    return size > 0 && quint8(data[0]) == Magic;
+}
+
+bool WireFormat::readHeader(const char* data, int size, FrameHeader& header) {
+    if (size < HeaderSize || quint8(data[0]) != Magic) {
+        return false;
+    }
+
+    header.version = quint8(data[1]);
+    header.type = quint8(data[2]);
+    header.flags = quint8(data[3]);
+    header.destination = qFromBigEndian<quint16>(data + 4);
+    header.origin = qFromBigEndian<quint16>(data + 6);
+    return true;
+}
+
+void WireFormat::encodeMessage(const Message& message, const NodeTable& nodes, QByteArray& out) {
+    int destination = message.destinationHandle();
+    if (destination == NodeTable::InvalidHandle) {
+        destination = nodes.handleOfUtf8(message.destinationUtf8());
+    }
+    int origin = message.originHandle();
+    if (origin == NodeTable::InvalidHandle) {
+        origin = nodes.handleOfUtf8(message.originUtf8());
+    }
+    bool inlineDestination = !nodes.isShared(destination);
+    bool inlineOrigin = !nodes.isShared(origin);
+
+    quint8 flags = 0;
+    if (inlineDestination) flags |= InlineDestination;
+    if (inlineOrigin) flags |= InlineOrigin;
+    if (message.getTimestamp() > 0) flags |= Timestamped;
+    if (message.isTraced()) flags |= Traced;
+
+    appendHeader(out, ChatFrame, Version, flags,
+                 inlineDestination ? InlineHandle : quint16(destination),
+                 inlineOrigin ? InlineHandle : quint16(origin));
+    appendVarint(out, quint32(message.getSequenceNumber()));
+    if (inlineDestination) {
+        appendBytes(out, message.destinationUtf8());
+    }
+    if (inlineOrigin) {
+        appendBytes(out, message.originUtf8());
+    }
+    appendBytes(out, message.chatTextUtf8());
+    if (message.getTimestamp() > 0) {
+        char timestamp[8];
+        qToBigEndian(message.getTimestamp(), timestamp);
+        out.append(timestamp, 8);
+    }
+    if (message.isTraced()) {
+        const QVector<TraceHop>& hops = message.getTraceHops();
+        int count = qMin(hops.size(), MaxTraceHops);
+        for (int i = 0; i < count; ++i) {
+            char record[TraceHopSize];
+            qToBigEndian(hops[i].node, record);
+            qToBigEndian(hops[i].usec, record + 2);
+            out.append(record, TraceHopSize);
+        }
+        out.append(char(count));
+    }
+}
+
+void WireFormat::appendTraceHop(QByteArray& frame, quint16 node, qint64 usec) {
+    quint8 count = quint8(frame.at(frame.size() - 1));
+    if (count >= MaxTraceHops) {
+        return;
+    }
+    char record[TraceHopSize];
+    qToBigEndian(node, record);
+    qToBigEndian(usec, record + 2);
+    frame.chop(1);
+    frame.append(record, TraceHopSize);
+    frame.append(char(count + 1));
+}
+
+void WireFormat::encodeHello(FrameType type, quint8 version, const QString& origin,
+                             const NodeTable& nodes, QByteArray& out) {
+    int handle = nodes.handleOf(origin);
+    bool inlineOrigin = !nodes.isShared(handle);
+
+    appendHeader(out, type, version, inlineOrigin ? InlineOrigin : 0,
+                 InlineHandle, inlineOrigin ? InlineHandle : quint16(handle));
+    if (inlineOrigin) {
+        appendString(out, origin);
+    }
+}
+
+void WireFormat::encodeNack(const QString& requester, const QString& sender,
+                            const QVector<SequenceRange>& missing, const NodeTable& nodes, QByteArray& out) {
+    int destination = nodes.handleOf(sender);
+    int origin = nodes.handleOf(requester);
+    bool inlineDestination = !nodes.isShared(destination);
+    bool inlineOrigin = !nodes.isShared(origin);
+
+    quint8 flags = 0;
+    if (inlineDestination) flags |= InlineDestination;
+    if (inlineOrigin) flags |= InlineOrigin;
+
+    appendHeader(out, NackFrame, Version, flags,
+                 inlineDestination ? InlineHandle : quint16(destination),
+                 inlineOrigin ? InlineHandle : quint16(origin));
+    appendVarint(out, quint32(missing.size()));
+    if (inlineDestination) {
+        appendString(out, sender);
+    }
+    if (inlineOrigin) {
+        appendString(out, requester);
+    }
+    for (const SequenceRange& range : missing) {
+        appendVarint(out, quint32(range.first));
+        appendVarint(out, quint32(range.length));
+    }
+}
+
+void WireFormat::encodeAck(const QString& acker, const QString& sender, int cumulative, qint64 oneWayUsec,
+                           const QVector<SequenceRange>& skipped, const NodeTable& nodes, QByteArray& out) {
+    int destination = nodes.handleOf(sender);
+    int origin = nodes.handleOf(acker);
+    bool inlineDestination = !nodes.isShared(destination);
+    bool inlineOrigin = !nodes.isShared(origin);
+
+    quint8 flags = 0;
+    if (inlineDestination) flags |= InlineDestination;
+    if (inlineOrigin) flags |= InlineOrigin;
+    if (oneWayUsec >= 0) flags |= Timestamped;
+    if (!skipped.isEmpty()) flags |= Skipped;
+
+    appendHeader(out, AckFrame, Version, flags,
+                 inlineDestination ? InlineHandle : quint16(destination),
+                 inlineOrigin ? InlineHandle : quint16(origin));
+    appendVarint(out, quint32(cumulative));
+    if (inlineDestination) {
+        appendString(out, sender);
+    }
+    if (inlineOrigin) {
+        appendString(out, acker);
+    }
+    if (oneWayUsec >= 0) {
+        appendVarint(out, quint32(qMin<qint64>(oneWayUsec, 0xFFFFFFFF)));
+    }
+    if (!skipped.isEmpty()) {
+        appendVarint(out, quint32(skipped.size()));
+        for (const SequenceRange& range : skipped) {
+            appendVarint(out, quint32(range.first));
+            appendVarint(out, quint32(range.length));
+        }
+    }
+}
+
+void WireFormat::encodeLegacy(const Message& message, QByteArray& out) {
+    QDataStream stream(&out, QIODevice::WriteOnly | QIODevice::Append);
+    stream << message;
+}
+
+bool WireFormat::peekDestination(const char* data, int size, quint16& handle,
+                                 const char*& name, int& nameSize) {
+    FrameHeader header;
+    if (!readHeader(data, size, header) || !isRoutedType(header.type)) {
+        return false;
+    }
+
+    handle = header.destination;
+    name = nullptr;
+    nameSize = 0;
+    if (!(header.flags & InlineDestination)) {
+        return true;
+    }
+
+    // Inline destination follows the sequence number (or range count)
+    const char* p = data + HeaderSize;
+    const char* end = data + size;
+    quint32 sequence;
+    quint32 length;
+    if (!readVarint(p, end, sequence) || !readVarint(p, end, length) || length > quint32(end - p)) {
+        return false;
+    }
+    handle = InlineHandle;
+    name = p;
+    nameSize = int(length);
+    return true;
+}
+
+bool WireFormat::decodeMessage(const char* data, int size, const NodeTable& nodes, Message& message) {
+    FrameHeader header;
+    if (!readHeader(data, size, header) || header.type != ChatFrame
+        || header.version == LegacyVersion || header.version > Version) {
+        return false;
+    }
+
+    const char* p = data + HeaderSize;
+    const char* end = data + size;
+
+    quint32 sequence;
+    if (!readVarint(p, end, sequence)) {
+        return false;
+    }
+
+    // Ring names are shared with the table and the text is copied into a pooled buffer,
+    // so at steady state decoding allocates nothing
+    QByteArray destination;
+    if (header.flags & InlineDestination) {
+        if (!readPooled(p, end, destination)) return false;
+    } else {
+        destination = nodes.utf8NameOf(header.destination);
+    }
+
+    QByteArray origin;
+    if (header.flags & InlineOrigin) {
+        if (!readPooled(p, end, origin)) return false;
+    } else {
+        origin = nodes.utf8NameOf(header.origin);
+    }
+
+    QByteArray chatText;
+    if (!readPooled(p, end, chatText)) {
+        return false;
+    }
+
+    message = Message::fromUtf8(chatText, origin, destination, int(sequence));
+    // Inline names have no shared handle; the receiver looks those up itself
+    message.setHandles((header.flags & InlineOrigin) ? NodeTable::InvalidHandle : int(header.origin),
+                       (header.flags & InlineDestination) ? NodeTable::InvalidHandle : int(header.destination));
+    if (header.flags & Timestamped) {
+        if (end - p < 8) return false;
+        message.setTimestamp(qFromBigEndian<qint64>(p));
+        p += 8;
+    }
+    if (header.flags & Traced) {
+        if (end - p < 1) return false;
+        int count = quint8(end[-1]);
+        if (end - p != count * TraceHopSize + 1) return false;
+        message.setTraced(true);
+        for (int i = 0; i < count; ++i, p += TraceHopSize) {
+            message.addTraceHop(qFromBigEndian<quint16>(p), qFromBigEndian<qint64>(p + 2));
+        }
+    }
+    return true;
+}
+
+bool WireFormat::decodeHelloOrigin(const char* data, int size, const NodeTable& nodes, QString& origin) {
+    FrameHeader header;
+    if (!readHeader(data, size, header)) {
+        return false;
+    }
+
+    if (header.flags & InlineOrigin) {
+        const char* p = data + HeaderSize;
+        return readString(p, data + size, origin);
+    }
+    origin = nodes.nameOf(header.origin);
+    return !origin.isEmpty();
+}
+
+bool WireFormat::decodeNack(const char* data, int size, const NodeTable& nodes,
+                            QString& requester, QVector<SequenceRange>& missing) {
+    FrameHeader header;
+    if (!readHeader(data, size, header) || header.type != NackFrame) {
+        return false;
+    }
+
+    const char* p = data + HeaderSize;
+    const char* end = data + size;
+
+    quint32 count;
+    if (!readVarint(p, end, count)) {
+        return false;
+    }
+
+    QString sender;
+    if ((header.flags & InlineDestination) && !readString(p, end, sender)) {
+        return false;
+    }
+    if (header.flags & InlineOrigin) {
+        if (!readString(p, end, requester)) return false;
+    } else {
+        requester = nodes.nameOf(header.origin);
+    }
+
+    if (!readRanges(p, end, count, missing)) {
+        return false;
+    }
+    return !requester.isEmpty();
+}
+
+bool WireFormat::decodeAck(const char* data, int size, const NodeTable& nodes,
+                           QString& acker, int& cumulative, qint64& oneWayUsec,
+                           QVector<SequenceRange>& skipped) {
+    FrameHeader header;
+    if (!readHeader(data, size, header) || header.type != AckFrame) {
+        return false;
+    }
+
+    const char* p = data + HeaderSize;
+    const char* end = data + size;
+
+    quint32 sequence;
+    if (!readVarint(p, end, sequence)) {
+        return false;
+    }
+
+    QString sender;
+    if ((header.flags & InlineDestination) && !readString(p, end, sender)) {
+        return false;
+    }
+    if (header.flags & InlineOrigin) {
+        if (!readString(p, end, acker)) return false;
+    } else {
+        acker = nodes.nameOf(header.origin);
+    }
+
+    oneWayUsec = -1;
+    if (header.flags & Timestamped) {
+        quint32 delay;
+        if (!readVarint(p, end, delay)) return false;
+        oneWayUsec = delay;
+    }
+    skipped.clear();
+    if (header.flags & Skipped) {
+        quint32 count;
+        if (!readVarint(p, end, count) || !readRanges(p, end, count, skipped)) return false;
+    }
+    cumulative = int(sequence);
+    return !acker.isEmpty();
+}
+
+bool WireFormat::decodeLegacy(const char* data, int size, Message& message) {
+    QByteArray frame = QByteArray::fromRawData(data, size);
+    QDataStream stream(frame);
+    stream >> message;
+    return stream.status() == QDataStream::Ok;
+}
+
+void WireFormat::appendVarint(QByteArray& out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool WireFormat::readVarint(const char*& p, const char* end, quint32& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        quint8 byte = quint8(*p++);
+        // The fifth byte carries only bits 28-31; anything above would not fit
+        if (shift == 28 && (byte & 0xF0)) {
+            return false;
+        }
+        value |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WireFormat::appendHeader(QByteArray& out, quint8 type, quint8 version, quint8 flags,
+                              quint16 destination, quint16 origin) {
+    char header[HeaderSize];
+    header[0] = char(Magic);
+    header[1] = char(version);
+    header[2] = char(type);
+    header[3] = char(flags);
+    qToBigEndian(destination, header + 4);
+    qToBigEndian(origin, header + 6);
+    out.append(header, HeaderSize);
+}
+
+void WireFormat::appendString(QByteArray& out, const QString& text) {
+    appendBytes(out, text.toUtf8());
+}
+
+void WireFormat::appendBytes(QByteArray& out, const QByteArray& utf8) {
+    appendVarint(out, quint32(utf8.size()));
+    out.append(utf8);
+}
+
+bool WireFormat::readString(const char*& p, const char* end, QString& text) {
+    quint32 length;
+    if (!readVarint(p, end, length) || length > quint32(end - p)) {
+        return false;
+    }
+    text = QString::fromUtf8(p, int(length));
+    p += length;
+    return true;
+}
+
+bool WireFormat::readPooled(const char*& p, const char* end, QByteArray& bytes) {
+    quint32 length;
+    if (!readVarint(p, end, length) || length > quint32(end - p)) {
+        return false;
+    }
+    bytes = PayloadPool::local().copy(p, int(length));
+    p += length;
+    return true;
+}
+
+bool WireFormat::readRanges(const char*& p, const char* end, quint32 count, QVector<SequenceRange>& ranges) {
+    // Every range takes at least two bytes, which bounds count by the frame size
+    if (count > quint32(end - p) / 2) {
+        return false;
+    }
+    ranges.clear();
+    ranges.reserve(int(count));
+    for (quint32 i = 0; i < count; ++i) {
+        quint32 first;
+        quint32 length;
+        if (!readVarint(p, end, first) || !readVarint(p, end, length)) {
+            return false;
+        }
+        // Sequence numbers are positive ints; first + length has to stay one too
+        if (first == 0 || first > quint32(INT_MAX) || length > quint32(INT_MAX) - first) {
+            return false;
+        }
+        SequenceRange range;
+        range.first = int(first);
+        range.length = int(length);
+        ranges.append(range);
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "message.h"
+#include "nodetable.h"
+
+// Compact binary framing used on ring links. Every frame body (after the
+// 4-byte length prefix) starts with a fixed 8-byte header:
+//
+//   magic(1) version(1) type(1) flags(1) destination(2) origin(2)
+//
+// Destination and origin are shared NodeTable handles, or InlineHandle when
+// the name follows inline. A chat frame continues with a varint sequence
+// number, the inline names (if any) and a varint-length UTF-8 payload.
+// A NACK frame is routed the same way, from the node missing messages
+// (origin) to their sender (destination): a varint range count, the inline
+// names, then a varint first sequence and length per range. An ACK frame
+// goes from a destination back to the sender: the varint cumulative
+// sequence number delivered so far, the inline names and, when Timestamped
+// is set, the varint one-way delay in microseconds. With Skipped set it
+// then lists the ranges at or below the cumulative sequence that the
+// destination gave up waiting for, as a varint count and first/length
+// pairs, so the sender counts those as lost rather than delivered. Older
+// decoders stop before the list and see a plain cumulative ACK. A Timestamped chat
+// frame ends with the 8-byte send time in microseconds since the epoch.
+// A Traced chat frame then carries one hop record per node it has passed,
+// handle(2) usec(8), and a final hop count byte, so a node can add itself by
+// appending to the frame without decoding it.
+//
+// Legacy frames are a QDataStream'd QVariantMap whose first byte is always
+// zero, so the magic byte is enough to tell the two formats apart.
+class WireFormat {
+public:
+    enum FrameType : quint8 {
+        ChatFrame = 0,
+        HelloFrame = 1,
+        HelloAckFrame = 2,
+        NackFrame = 3,
+        AckFrame = 4
+    };
+
+    enum Flag : quint8 {
+        InlineDestination = 0x01,
+        InlineOrigin = 0x02,
+        Timestamped = 0x04,
+        Traced = 0x08,
+        Skipped = 0x10
+    };
+
+    static constexpr quint8 Magic = 0xA7;
+    static constexpr quint8 LegacyVersion = 0;
+    static constexpr quint8 Version = 1;
+    static constexpr int HeaderSize = 8;
+    static constexpr quint16 InlineHandle = 0xFFFF;
+    static constexpr int TraceHopSize = 10;
+    static constexpr int MaxTraceHops = 255;
+
+    struct FrameHeader {
+        quint8 version;
+        quint8 type;
+        quint8 flags;
+        quint16 destination;
+        quint16 origin;
+    };
+
+    static bool isBinaryFrame(const char* data, int size);
+    static bool readHeader(const char* data, int size, FrameHeader& header);
+
+    // Encoders append the frame body to out
+    static void encodeMessage(const Message& message, const NodeTable& nodes, QByteArray& out);
+    static void encodeHello(FrameType type, quint8 version, const QString& origin,
+                            const NodeTable& nodes, QByteArray& out);
+    static void encodeNack(const QString& requester, const QString& sender,
+                           const QVector<SequenceRange>& missing, const NodeTable& nodes, QByteArray& out);
+    // oneWayUsec < 0 leaves the delay out; skipped are the ranges given up as lost
+    static void encodeAck(const QString& acker, const QString& sender, int cumulative, qint64 oneWayUsec,
+                          const QVector<SequenceRange>& skipped, const NodeTable& nodes, QByteArray& out);
+    static void encodeLegacy(const Message& message, QByteArray& out);
+
+    // Adds a hop record to the Traced chat frame at the end of frame; a no-op once MaxTraceHops is reached
+    static void appendTraceHop(QByteArray& frame, quint16 node, qint64 usec);
+
+    // Chat, NACK and ACK frames travel to a destination node; everything else is for the neighbor only
+    static bool isRoutedType(quint8 type) { return type == ChatFrame || type == NackFrame || type == AckFrame; }
+
+    // Finds the destination of a routed frame without decoding the rest of it. For inline
+    // destinations handle is InlineHandle and name/nameSize point into data.
+    static bool peekDestination(const char* data, int size, quint16& handle,
+                                const char*& name, int& nameSize);
+
+    static bool decodeMessage(const char* data, int size, const NodeTable& nodes, Message& message);
+    static bool decodeHelloOrigin(const char* data, int size, const NodeTable& nodes, QString& origin);
+    static bool decodeNack(const char* data, int size, const NodeTable& nodes,
+                           QString& requester, QVector<SequenceRange>& missing);
+    static bool decodeAck(const char* data, int size, const NodeTable& nodes,
+                          QString& acker, int& cumulative, qint64& oneWayUsec,
+                          QVector<SequenceRange>& skipped);
+    static bool decodeLegacy(const char* data, int size, Message& message);
+
+    static void appendVarint(QByteArray& out, quint32 value);
+    static bool readVarint(const char*& p, const char* end, quint32& value);
+
+private:
+    static void appendHeader(QByteArray& out, quint8 type, quint8 version, quint8 flags,
+                             quint16 destination, quint16 origin);
+    static void appendString(QByteArray& out, const QString& text);
+    static void appendBytes(QByteArray& out, const QByteArray& utf8);
+    static bool readString(const char*& p, const char* end, QString& text);
+    static bool readPooled(const char*& p, const char* end, QByteArray& bytes);
+    static bool readRanges(const char*& p, const char* end, quint32 count, QVector<SequenceRange>& ranges);
+};
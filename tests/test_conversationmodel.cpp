@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "../src/conversationmodel.h"
+
+// Test rows keep the text as plain data along with who sent it
+TEST(ConversationModelTest, AppendKeepsPlainText) {
+    ConversationModel model;
+    model.append("<b>not html</b>", ConversationModel::Received);
+    model.append("reply", ConversationModel::Sent);
+
+    ASSERT_EQ(model.rowCount(), 2);
+    QModelIndex first = model.index(0);
+    EXPECT_EQ(model.data(first).toString(), "<b>not html</b>");
+    EXPECT_EQ(model.data(first, ConversationModel::KindRole).toInt(), int(ConversationModel::Received));
+    EXPECT_EQ(model.entry(1).kind, ConversationModel::Sent);
+    EXPECT_FALSE(model.data(model.index(2)).isValid());
+}
+
+// Test a batch of messages is announced to views as a single insert
+TEST(ConversationModelTest, BatchAppendIsOneInsert) {
+    ConversationModel model;
+    int inserts = 0;
+    int insertedRows = 0;
+    QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                     [&](const QModelIndex&, int first, int last) {
+        ++inserts;
+        insertedRows += last - first + 1;
+    });
+
+    QVector<ConversationModel::Entry> batch(100);
+    for (int i = 0; i < batch.size(); ++i) {
+        batch[i].text = QString("message %1").arg(i);
+        batch[i].kind = ConversationModel::Received;
+    }
+    model.append(batch);
+
+    EXPECT_EQ(inserts, 1);
+    EXPECT_EQ(insertedRows, 100);
+    EXPECT_EQ(model.rowCount(), 100);
+}
+
+// Test measured heights are only reused at the width they were measured for
+TEST(ConversationModelTest, HeightCacheIsPerWidth) {
+    ConversationModel model;
+    model.append("hello", ConversationModel::Sent);
+
+    EXPECT_EQ(model.cachedHeight(0, 400), -1);
+    model.cacheHeight(0, 400, 52);
+    EXPECT_EQ(model.cachedHeight(0, 400), 52);
+    EXPECT_EQ(model.cachedHeight(0, 320), -1);
+}
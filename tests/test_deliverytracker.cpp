@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "../src/deliverytracker.h"
+#include "../src/latencyhistogram.h"
+
+// Test every value lands in a bucket whose bounds contain it
+TEST(LatencyHistogramTest, BucketBounds) {
+    for (quint64 usec : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 17ull, 1000ull, 123456ull, 3600000000ull}) {
+        int bucket = LatencyHistogram::bucketFor(usec);
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(bucket), usec);
+        if (bucket > 0) {
+            EXPECT_LT(LatencyHistogram::bucketUpperBound(bucket - 1), usec);
+        }
+    }
+}
+
+// Test percentiles stay within the bucket resolution
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    for (quint64 usec = 1; usec <= 1000; ++usec) {
+        histogram.record(usec);
+    }
+
+    LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.max, 1000u);
+    EXPECT_EQ(snapshot.mean(), 500u);
+    EXPECT_NEAR(double(snapshot.percentile(0.5)), 500.0, 500.0 * 0.125);
+    EXPECT_NEAR(double(snapshot.percentile(0.99)), 990.0, 990.0 * 0.125);
+    EXPECT_EQ(snapshot.percentile(1.0), 1000u);
+}
+
+// Test one cumulative ACK settles every outstanding message up to it
+TEST(DeliveryTrackerTest, CumulativeAck) {
+    DeliveryTracker tracker;
+    for (int sequence = 1; sequence <= 5; ++sequence) {
+        tracker.messageSent(sequence, sequence * 100);
+    }
+
+    EXPECT_EQ(tracker.acknowledge(3, 1000, 250), 3);
+    EXPECT_EQ(tracker.outstandingCount(), 2);
+    EXPECT_EQ(tracker.acknowledge(3, 1100), 0);
+
+    DeliveryTracker::Stats stats = tracker.stats();
+    EXPECT_EQ(stats.sent, 5u);
+    EXPECT_EQ(stats.acknowledged, 3u);
+    EXPECT_EQ(stats.roundTrip.count, 3u);
+    EXPECT_EQ(stats.roundTrip.max, 900u);
+    EXPECT_EQ(stats.oneWay.count, 1u);
+}
+
+// Test skipped sequence numbers count as lost, not delivered
+TEST(DeliveryTrackerTest, SkippedAreLost) {
+    DeliveryTracker tracker;
+    for (int sequence = 1; sequence <= 6; ++sequence) {
+        tracker.messageSent(sequence, 0);
+    }
+
+    SequenceRange lost;
+    lost.first = 2;
+    lost.length = 2;
+    EXPECT_EQ(tracker.acknowledge(5, 1000, -1, QVector<SequenceRange>{lost}), 3);
+    EXPECT_EQ(tracker.outstandingCount(), 1);
+
+    DeliveryTracker::Stats stats = tracker.stats();
+    EXPECT_EQ(stats.acknowledged, 3u);
+    EXPECT_EQ(stats.lost, 2u);
+    EXPECT_EQ(stats.roundTrip.count, 3u);
+}
+
+// Test messages never acknowledged do not pile up
+TEST(DeliveryTrackerTest, OutstandingIsBounded) {
+    DeliveryTracker tracker;
+    for (int sequence = 1; sequence <= DeliveryTracker::MaxOutstanding + 10; ++sequence) {
+        tracker.messageSent(sequence, 0);
+    }
+    EXPECT_EQ(tracker.outstandingCount(), DeliveryTracker::MaxOutstanding);
+    EXPECT_EQ(tracker.stats().expired, 10u);
+}
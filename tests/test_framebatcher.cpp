@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include "../src/framebatcher.h"
+
+class FrameBatcherTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        // The flush timer needs an event loop; one application object serves every test
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char name[] = "SimpleChat_Tests";
+            static char* argv[] = {name, nullptr};
+            new QCoreApplication(argc, argv);
+        }
+    }
+
+    void SetUp() override {
+        ASSERT_TRUE(device.open(QIODevice::WriteOnly));
+        batcher.setDevice(&device);
+        QObject::connect(&batcher, &FrameBatcher::batchFlushed, [this](int frames, int) {
+            flushedFrames.append(frames);
+        });
+    }
+
+    template<typename Predicate>
+    static bool waitFor(Predicate done, int timeoutMsec = 5000) {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done()) {
+            if (timer.hasExpired(timeoutMsec)) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        return true;
+    }
+
+    static QByteArray framed(const QByteArray& body) {
+        char prefix[4];
+        qToBigEndian(quint32(body.size()), prefix);
+        return QByteArray(prefix, 4) + body;
+    }
+
+    QBuffer device;
+    FrameBatcher batcher;
+    QVector<int> flushedFrames;
+};
+
+// Test a batch is written in one piece as soon as it reaches the byte threshold
+TEST_F(FrameBatcherTest, FlushesOnSize) {
+    batcher.setWindowUsec(10 * 1000 * 1000);
+    batcher.setMaxBatchBytes(64);
+    const QByteArray body(20, 'a');
+
+    batcher.enqueue(body.constData(), body.size());
+    batcher.enqueue(body.constData(), body.size());
+    EXPECT_EQ(device.data().size(), 0);
+    EXPECT_EQ(batcher.pendingFrames(), 2);
+
+    batcher.enqueue(body.constData(), body.size());
+    EXPECT_EQ(device.data(), framed(body) + framed(body) + framed(body));
+    EXPECT_EQ(batcher.pendingFrames(), 0);
+    EXPECT_EQ(batcher.pendingBytes(), 0);
+    EXPECT_EQ(flushedFrames, QVector<int>({3}));
+    EXPECT_EQ(batcher.stats().batches, 1u);
+    EXPECT_EQ(batcher.stats().frames, 3u);
+    EXPECT_EQ(batcher.stats().bytes, quint64(3 * (4 + body.size())));
+}
+
+// Test a batch below the threshold goes out once the window expires, with
+// frames encoded in place through beginFrame() and endFrame()
+TEST_F(FrameBatcherTest, FlushesOnTimer) {
+    batcher.setWindowUsec(2000);
+
+    batcher.beginFrame().append("hello");
+    batcher.endFrame();
+    batcher.enqueue("world!", 6);
+    EXPECT_EQ(device.data().size(), 0);
+
+    ASSERT_TRUE(waitFor([this]() { return !flushedFrames.isEmpty(); }));
+    EXPECT_EQ(device.data(), framed("hello") + framed("world!"));
+    EXPECT_EQ(flushedFrames, QVector<int>({2}));
+    EXPECT_EQ(batcher.stats().largestBatchFrames, 2);
+}
+
+// Test discard() drops the batch and stops the timer, and takeFrames() returns
+// the complete frames without writing them
+TEST_F(FrameBatcherTest, DiscardAndTakeFrames) {
+    batcher.setWindowUsec(1000);
+    batcher.enqueue("lost", 4);
+    batcher.discard();
+    EXPECT_EQ(batcher.pendingFrames(), 0);
+    EXPECT_EQ(batcher.pendingBytes(), 0);
+
+    QElapsedTimer timer;
+    timer.start();
+    waitFor([&timer]() { return timer.hasExpired(20); });
+    EXPECT_EQ(device.data().size(), 0);
+    EXPECT_TRUE(flushedFrames.isEmpty());
+
+    batcher.enqueue("one", 3);
+    batcher.enqueue("two", 3);
+    batcher.beginFrame().append("unfinished");
+    const QList<QByteArray> frames = batcher.takeFrames();
+    ASSERT_EQ(frames.size(), 2);
+    EXPECT_EQ(frames[0], QByteArray("one"));
+    EXPECT_EQ(frames[1], QByteArray("two"));
+    EXPECT_EQ(batcher.pendingBytes(), 0);
+    EXPECT_EQ(device.data().size(), 0);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "../src/logging.h"
+
+static int evaluations = 0;
+
+static int countEvaluation() {
+    return ++evaluations;
+}
+
+// Test records are formatted as an event followed by key=value fields
+TEST(LoggingTest, FormatsFields) {
+    LogRecord record;
+    record.timeUsec = 1500000;
+    record.event = "forward";
+    record.level = Logger::Trace;
+    record.fieldCount = 4;
+    record.fields[0] = LogField("to", QByteArray("Node3"));
+    record.fields[1] = LogField("seq", 42);
+    record.fields[2] = LogField("via", QString("Node2"));
+    record.fields[3] = LogField("ratio", 0.5);
+
+    EXPECT_EQ(Logger::format(record), QByteArray("[+1.500000s] trace forward to=Node3 seq=42 via=Node2 ratio=0.5"));
+}
+
+// Test long text values are cut at MaxText bytes
+TEST(LoggingTest, TruncatesLongText) {
+    LogField field("name", QByteArray(100, 'n'));
+    EXPECT_EQ(field.textSize, LogField::MaxText);
+    EXPECT_EQ(QByteArray(field.text, field.textSize), QByteArray(LogField::MaxText, 'n'));
+}
+
+// Test QString values are encoded as UTF-8 and cut only between characters
+TEST(LoggingTest, EncodesQStringInPlace) {
+    QString name = QString::fromUtf8("Kn\xc3\xb6" "del-\xe2\x82\xac-\xf0\x9f\x98\x80");
+    LogField field("name", name);
+    EXPECT_EQ(QByteArray(field.text, field.textSize), name.toUtf8());
+
+    // 10 three-byte characters fill 30 bytes; the 11th does not fit in MaxText
+    LogField truncated("name", QString(11, QChar(0x20AC)));
+    EXPECT_EQ(truncated.textSize, 30);
+    EXPECT_EQ(QByteArray(truncated.text, truncated.textSize), QString(10, QChar(0x20AC)).toUtf8());
+}
+
+// Test fields are not evaluated for records filtered out at runtime
+TEST(LoggingTest, SkipsDisabledLevels) {
+    Logger::Level previous = Logger::level();
+    Logger::setLevel(Logger::Warning);
+    evaluations = 0;
+    SC_LOG(Debug, "skipped", LogField("n", countEvaluation()));
+    EXPECT_EQ(evaluations, 0);
+
+    SC_LOG(Warning, "written", LogField("n", countEvaluation()));
+    Logger::flush();
+    EXPECT_EQ(evaluations, 1);
+    Logger::setLevel(previous);
+}
+
+// Test level names round-trip through --log-level parsing
+TEST(LoggingTest, ParsesLevelNames) {
+    Logger::Level level;
+    ASSERT_TRUE(Logger::parseLevel("trace", level));
+    EXPECT_EQ(level, Logger::Trace);
+    ASSERT_TRUE(Logger::parseLevel("off", level));
+    EXPECT_EQ(level, Logger::Off);
+    EXPECT_FALSE(Logger::parseLevel("verbose", level));
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include "../src/messagestore.h"
+
+class MessageStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(dir.isValid());
+        path = dir.filePath("Node1");
+    }
+
+    static Message sent(int sequence) {
+        return Message(QString("to Node2 #%1").arg(sequence), "Node1", "Node2", sequence);
+    }
+
+    static Message received(int sequence) {
+        return Message(QString("from Node3 #%1").arg(sequence), "Node3", "Node1", sequence);
+    }
+
+    QTemporaryDir dir;
+    QString path;
+};
+
+// Test sequence counters and records come back after a restart
+TEST_F(MessageStoreTest, RestoresSequenceStateAfterReopen) {
+    {
+        MessageStore store;
+        ASSERT_TRUE(store.open(path));
+        for (int i = 1; i <= 3; ++i) {
+            ASSERT_TRUE(store.append(MessageStore::Sent, sent(i)));
+        }
+        ASSERT_TRUE(store.append(MessageStore::Received, received(1)));
+        ASSERT_TRUE(store.append(MessageStore::Received, received(2)));
+    }
+
+    MessageStore store;
+    ASSERT_TRUE(store.open(path));
+    EXPECT_EQ(store.count(), 5);
+    EXPECT_EQ(store.nextSendSequences().value("Node2"), 4);
+    EXPECT_EQ(store.nextExpectedSequences().value("Node3"), 3);
+
+    MessageStore::Record record = store.read(3);
+    EXPECT_EQ(record.direction, MessageStore::Received);
+    EXPECT_EQ(record.message.getOrigin(), "Node3");
+    EXPECT_EQ(record.message.getSequenceNumber(), 1);
+    EXPECT_EQ(record.message.getChatText(), "from Node3 #1");
+}
+
+// Test records are read back across rolled-over segments, and the counters
+// are rebuilt from the records when the checkpoint is missing
+TEST_F(MessageStoreTest, SegmentsAndMissingCheckpoint) {
+    {
+        MessageStore store;
+        store.setSegmentBytes(128);
+        ASSERT_TRUE(store.open(path));
+        for (int i = 1; i <= 20; ++i) {
+            ASSERT_TRUE(store.append(MessageStore::Sent, sent(i)));
+        }
+    }
+    EXPECT_GT(QDir(path).entryList({"segment-*.log"}).size(), 1);
+    ASSERT_TRUE(QFile::remove(QDir(path).filePath("sequences.dat")));
+
+    MessageStore store;
+    ASSERT_TRUE(store.open(path));
+    EXPECT_EQ(store.nextSendSequences().value("Node2"), 21);
+
+    QVector<MessageStore::Record> recent = store.recent(5);
+    ASSERT_EQ(recent.size(), 5);
+    EXPECT_EQ(recent.first().message.getSequenceNumber(), 16);
+    EXPECT_EQ(recent.last().message.getChatText(), "to Node2 #20");
+}
+
+// Test a torn tail record is cut off and a lost index is rebuilt from the segments
+TEST_F(MessageStoreTest, RecoversTornTailAndLostIndex) {
+    {
+        MessageStore store;
+        ASSERT_TRUE(store.open(path));
+        for (int i = 1; i <= 3; ++i) {
+            ASSERT_TRUE(store.append(MessageStore::Sent, sent(i)));
+        }
+    }
+    QFile segment(QDir(path).filePath("segment-000001.log"));
+    ASSERT_TRUE(segment.open(QIODevice::Append));
+    segment.write("\x00\x00\x00\x40\x00partial", 12);
+    segment.close();
+    ASSERT_TRUE(QFile::remove(QDir(path).filePath("index.dat")));
+
+    MessageStore store;
+    ASSERT_TRUE(store.open(path));
+    EXPECT_EQ(store.count(), 3);
+    ASSERT_TRUE(store.append(MessageStore::Sent, sent(4)));
+    EXPECT_EQ(store.read(3).message.getChatText(), "to Node2 #4");
+    EXPECT_EQ(store.nextSendSequences().value("Node2"), 5);
+}
+
+// Test appended records wait in the write buffer until flush(), or until
+// FlushBytes of them have piled up
+TEST_F(MessageStoreTest, BuffersAppendsUntilFlush) {
+    MessageStore store;
+    ASSERT_TRUE(store.open(path));
+    const QString segmentPath = QDir(path).filePath("segment-000001.log");
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_TRUE(store.append(MessageStore::Sent, sent(i)));
+    }
+    EXPECT_TRUE(store.hasUnflushed());
+    EXPECT_EQ(QFileInfo(segmentPath).size(), 0);
+
+    ASSERT_TRUE(store.flush());
+    EXPECT_FALSE(store.hasUnflushed());
+    qint64 flushedSize = QFileInfo(segmentPath).size();
+    EXPECT_GT(flushedSize, 0);
+
+    // Reads still see records that are only buffered
+    ASSERT_TRUE(store.append(MessageStore::Sent, sent(4)));
+    EXPECT_EQ(store.read(3).message.getChatText(), "to Node2 #4");
+    ASSERT_TRUE(store.append(MessageStore::Sent, sent(5)));
+    EXPECT_EQ(store.count(), 5);
+
+    const QString text(1024, QChar('x'));
+    int appended = 0;
+    while (store.hasUnflushed()) {
+        ASSERT_LT(appended, MessageStore::FlushBytes / text.size() + 1);
+        ASSERT_TRUE(store.append(MessageStore::Sent, Message(text, "Node1", "Node2", 6 + appended++)));
+    }
+    EXPECT_GT(QFileInfo(segmentPath).size(), flushedSize + MessageStore::FlushBytes - text.size());
+    EXPECT_EQ(store.read(store.count() - 1).message.getSequenceNumber(), 5 + appended);
+}
+
+// Test records stored without text still carry addressing and sequence state
+TEST_F(MessageStoreTest, RecordsWithoutText) {
+    {
+        MessageStore store;
+        store.setStoreText(false);
+        ASSERT_TRUE(store.open(path));
+        ASSERT_TRUE(store.append(MessageStore::Sent, sent(1)));
+        ASSERT_TRUE(store.append(MessageStore::Received, received(4)));
+    }
+
+    MessageStore store;
+    ASSERT_TRUE(store.open(path));
+    EXPECT_EQ(store.count(), 2);
+    EXPECT_EQ(store.nextSendSequences().value("Node2"), 2);
+    EXPECT_EQ(store.nextExpectedSequences().value("Node3"), 5);
+
+    MessageStore::Record record = store.read(1);
+    EXPECT_EQ(record.direction, MessageStore::Received);
+    EXPECT_EQ(record.message.getOrigin(), "Node3");
+    EXPECT_EQ(record.message.getDestination(), "Node1");
+    EXPECT_TRUE(record.message.getChatText().isEmpty());
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "../src/metricsserver.h"
+
+// Test counters and gauges are exported with the node label
+TEST(MetricsTest, RendersCountersAndGauges) {
+    NetworkMetrics metrics;
+    metrics.framesReceived.fetchAndAddRelaxed(12);
+    metrics.delivered.fetchAndAddRelaxed(5);
+    metrics.queuedFrames.storeRelaxed(3);
+
+    QByteArray text = MetricsServer::render(metrics, "Node1");
+    EXPECT_TRUE(text.contains("# TYPE simplechat_frames_received_total counter\n"));
+    EXPECT_TRUE(text.contains("simplechat_frames_received_total{node=\"Node1\"} 12\n"));
+    EXPECT_TRUE(text.contains("simplechat_delivered_total{node=\"Node1\"} 5\n"));
+    EXPECT_TRUE(text.contains("simplechat_decode_errors_total{node=\"Node1\"} 0\n"));
+    EXPECT_TRUE(text.contains("# TYPE simplechat_outbound_queue_frames gauge\n"));
+    EXPECT_TRUE(text.contains("simplechat_outbound_queue_frames{node=\"Node1\"} 3\n"));
+}
+
+// Test histogram buckets are cumulative and in seconds, each bound moved up to
+// the end of the histogram bucket it falls in so that no sample below it is missed
+TEST(MetricsTest, RendersCumulativeHistogram) {
+    NetworkMetrics metrics;
+    metrics.forwardNsec.record(100);
+    metrics.forwardNsec.record(245); // shares a histogram bucket (240..255) with the 250 ns bound
+    metrics.forwardNsec.record(300);
+    metrics.forwardNsec.record(2000000);
+
+    QByteArray text = MetricsServer::render(metrics, "Node2");
+    QByteArray prefix = "simplechat_forward_latency_seconds_bucket{node=\"Node2\",le=";
+    EXPECT_TRUE(text.contains(prefix + "\"2.55e-07\"} 2\n"));
+    EXPECT_TRUE(text.contains(prefix + "\"5.11e-07\"} 3\n"));
+    EXPECT_TRUE(text.contains(prefix + "\"0.00104857\"} 3\n"));
+    EXPECT_TRUE(text.contains(prefix + "\"0.00262144\"} 4\n"));
+    EXPECT_TRUE(text.contains(prefix + "\"+Inf\"} 4\n"));
+    EXPECT_TRUE(text.contains("simplechat_forward_latency_seconds_count{node=\"Node2\"} 4\n"));
+    EXPECT_TRUE(text.contains("simplechat_decode_seconds_count{node=\"Node2\"} 0\n"));
+}
+
+// Test every bound is a bucket edge: a sample at the bound counts, one just past it does not
+TEST(MetricsTest, HistogramBoundsAreExact) {
+    NetworkMetrics metrics;
+    metrics.decodeNsec.record(1023);
+    metrics.decodeNsec.record(1024);
+
+    QByteArray text = MetricsServer::render(metrics, "Node1");
+    QByteArray prefix = "simplechat_decode_seconds_bucket{node=\"Node1\",le=";
+    EXPECT_TRUE(text.contains(prefix + "\"1.023e-06\"} 1\n"));
+    EXPECT_TRUE(text.contains(prefix + "\"2.559e-06\"} 2\n"));
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include "../src/framebatcher.h"
+#include "../src/outboundqueue.h"
+
+class OutboundQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(dir.isValid());
+        path = dir.filePath("outbound.log");
+    }
+
+    static QByteArray frame(int i) {
+        return QByteArray("frame-") + QByteArray::number(i);
+    }
+
+    QTemporaryDir dir;
+    QString path;
+};
+
+// Test frames spill to disk past the memory limit and come back in order
+TEST_F(OutboundQueueTest, SpillPreservesOrder) {
+    OutboundQueue queue;
+    ASSERT_TRUE(queue.open(path));
+    queue.setMemoryLimit(3 * frame(0).size());
+
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(queue.enqueue(frame(i)));
+    }
+    EXPECT_EQ(queue.size(), 20);
+    EXPECT_GT(queue.spilledFrames(), 0);
+    EXPECT_LE(queue.memoryBytes(), 3 * frame(0).size());
+
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_FALSE(queue.isEmpty());
+        EXPECT_EQ(queue.dequeue(), frame(i));
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+// Test a memory limit below one frame still hands spilled frames back one at a time
+TEST_F(OutboundQueueTest, ZeroMemoryLimitStillDrains) {
+    OutboundQueue queue;
+    ASSERT_TRUE(queue.open(path));
+    queue.setMemoryLimit(0);
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(queue.enqueue(frame(i)));
+    }
+    EXPECT_EQ(queue.spilledFrames(), 5);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_FALSE(queue.isEmpty());
+        EXPECT_EQ(queue.dequeue(), frame(i));
+    }
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_TRUE(queue.dequeue().isEmpty());
+}
+
+// Test frames still queued at shutdown are replayed by the next run
+TEST_F(OutboundQueueTest, PersistAndRecover) {
+    {
+        OutboundQueue queue;
+        ASSERT_TRUE(queue.open(path));
+        queue.setMemoryLimit(2 * frame(0).size());
+        for (int i = 0; i < 6; ++i) {
+            queue.enqueue(frame(i));
+        }
+        EXPECT_EQ(queue.dequeue(), frame(0));
+        queue.persist();
+    }
+
+    OutboundQueue recovered;
+    ASSERT_TRUE(recovered.open(path));
+    EXPECT_EQ(recovered.size(), 5);
+    for (int i = 1; i < 6; ++i) {
+        EXPECT_EQ(recovered.dequeue(), frame(i));
+    }
+    EXPECT_TRUE(recovered.isEmpty());
+}
+
+// Test drop-oldest keeps memory bounded and the newest frames
+TEST_F(OutboundQueueTest, DropOldest) {
+    OutboundQueue queue;
+    queue.setPolicy(OutboundQueue::DropOldest);
+    queue.setMemoryLimit(3 * frame(0).size());
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(queue.enqueue(frame(i)));
+    }
+    EXPECT_EQ(queue.size(), 3);
+    EXPECT_EQ(queue.droppedFrames(), 2u);
+    EXPECT_EQ(queue.dequeue(), frame(2));
+}
+
+// Test reject-new pushes back once memory is full
+TEST_F(OutboundQueueTest, RejectNew) {
+    OutboundQueue queue;
+    queue.setPolicy(OutboundQueue::RejectNew);
+    queue.setMemoryLimit(2 * frame(0).size());
+
+    EXPECT_TRUE(queue.enqueue(frame(0)));
+    EXPECT_TRUE(queue.enqueue(frame(1)));
+    EXPECT_FALSE(queue.enqueue(frame(2)));
+    EXPECT_EQ(queue.size(), 2);
+}
+
+// Test frames staged in the batcher when the link drops are replayed first, in order
+TEST_F(OutboundQueueTest, StagedFramesRequeuedOnReconnect) {
+    OutboundQueue queue;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(queue.enqueue(frame(i)));
+    }
+
+    // No device, as on a link that just went down: every flush leaves the batch staged
+    FrameBatcher batcher;
+    batcher.setMaxBatchBytes(1);
+    for (int i = 0; i < 4; ++i) {
+        QByteArray staged = queue.dequeue();
+        batcher.enqueue(staged.constData(), staged.size());
+    }
+    ASSERT_EQ(batcher.pendingFrames(), 4);
+
+    queue.requeue(batcher.takeFrames());
+    EXPECT_EQ(batcher.pendingFrames(), 0);
+    EXPECT_EQ(queue.size(), 10);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(queue.dequeue(), frame(i));
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "../src/payloadpool.h"
+#include "../src/wireformat.h"
+
+// Test a buffer is reused once nothing refers to it any more
+TEST(PayloadPoolTest, ReusesReleasedBuffers) {
+    PayloadPool pool(4);
+    QByteArray first = pool.copy("hello", 5);
+    const char* storage = first.constData();
+    EXPECT_EQ(first, QByteArray("hello"));
+
+    // Still referenced, so the next payload gets a buffer of its own
+    QByteArray second = pool.copy("world", 5);
+    EXPECT_NE(second.constData(), storage);
+    EXPECT_EQ(first, QByteArray("hello"));
+
+    first = QByteArray();
+    second = QByteArray();
+    QByteArray third = pool.copy("again", 5);
+    QByteArray fourth = pool.copy("more", 4);
+    EXPECT_TRUE(third.constData() == storage || fourth.constData() == storage);
+    EXPECT_EQ(pool.size(), 2);
+    EXPECT_EQ(pool.reusedCount(), 2u);
+}
+
+// Test a full pool keeps working by handing out unpooled copies
+TEST(PayloadPoolTest, FallsBackWhenExhausted) {
+    PayloadPool pool(1);
+    QByteArray held = pool.copy("one", 3);
+    QByteArray extra = pool.copy("two", 3);
+    EXPECT_EQ(extra, QByteArray("two"));
+    EXPECT_EQ(pool.size(), 1);
+    EXPECT_EQ(pool.allocatedCount(), 2u);
+
+    QByteArray large(PayloadPool::MaxPooledBytes + 1, 'x');
+    EXPECT_EQ(pool.copy(large.constData(), large.size()), large);
+    EXPECT_EQ(pool.size(), 1);
+}
+
+// Test decoded messages share the node table's names instead of copying them
+TEST(PayloadPoolTest, DecodedMessagesShareNames) {
+    NodeTable nodes;
+    nodes.setRingMembers(QStringList({"Node1", "Node2"}));
+
+    QByteArray frame;
+    WireFormat::encodeMessage(Message("shared", "Node1", "Node2", 1), nodes, frame);
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+
+    EXPECT_EQ(decoded.originUtf8().constData(), nodes.utf8NameOf(0).constData());
+    EXPECT_EQ(decoded.destinationUtf8().constData(), nodes.utf8NameOf(1).constData());
+    EXPECT_EQ(decoded.getChatText(), "shared");
+
+    // Copies share the payload too
+    Message copy = decoded;
+    EXPECT_EQ(copy.chatTextUtf8().constData(), decoded.chatTextUtf8().constData());
+}
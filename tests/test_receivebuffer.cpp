@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <QtEndian>
+#include <cstring>
+#include "../src/receivebuffer.h"
+
+static QByteArray makeFrame(const QByteArray& body) {
+    char prefix[ReceiveBuffer::PrefixSize];
+    qToBigEndian(quint32(body.size()), prefix);
+    return QByteArray(prefix, ReceiveBuffer::PrefixSize) + body;
+}
+
+// Test several frames delivered in one read
+TEST(ReceiveBufferTest, MultipleFramesPerRead) {
+    ReceiveBuffer buffer;
+    QByteArray chunk = makeFrame("one") + makeFrame("two") + makeFrame("three");
+    buffer.append(chunk.constData(), chunk.size());
+
+    const char* data;
+    int size;
+    ASSERT_TRUE(buffer.nextFrame(data, size));
+    EXPECT_EQ(QByteArray(data, size), QByteArray("one"));
+    ASSERT_TRUE(buffer.nextFrame(data, size));
+    EXPECT_EQ(QByteArray(data, size), QByteArray("two"));
+    ASSERT_TRUE(buffer.nextFrame(data, size));
+    EXPECT_EQ(QByteArray(data, size), QByteArray("three"));
+    EXPECT_FALSE(buffer.nextFrame(data, size));
+    EXPECT_EQ(buffer.bytesAvailable(), 0);
+}
+
+// Test a frame split across reads, including inside the length prefix
+TEST(ReceiveBufferTest, PartialFrames) {
+    ReceiveBuffer buffer;
+    QByteArray frame = makeFrame("split across reads");
+
+    const char* data;
+    int size;
+    for (int i = 0; i < frame.size() - 1; ++i) {
+        buffer.append(frame.constData() + i, 1);
+        EXPECT_FALSE(buffer.nextFrame(data, size));
+    }
+    buffer.append(frame.constData() + frame.size() - 1, 1);
+    ASSERT_TRUE(buffer.nextFrame(data, size));
+    EXPECT_EQ(QByteArray(data, size), QByteArray("split across reads"));
+}
+
+// Test compaction and growth keep unread bytes intact
+TEST(ReceiveBufferTest, CompactAndGrow) {
+    ReceiveBuffer buffer;
+    QByteArray body(ReceiveBuffer::InitialCapacity / 3, 'x');
+    QByteArray frame = makeFrame(body);
+
+    const char* data;
+    int size;
+    for (int round = 0; round < 10; ++round) {
+        buffer.append(frame.constData(), frame.size());
+        buffer.append(frame.constData(), frame.size() / 2);
+        ASSERT_TRUE(buffer.nextFrame(data, size));
+        EXPECT_EQ(size, body.size());
+        buffer.append(frame.constData() + frame.size() / 2, frame.size() - frame.size() / 2);
+        ASSERT_TRUE(buffer.nextFrame(data, size));
+        EXPECT_EQ(QByteArray(data, size), body);
+    }
+    EXPECT_EQ(buffer.bytesAvailable(), 0);
+}
+
+// Test frames written in place through prepareWrite()/commitWrite()
+TEST(ReceiveBufferTest, DirectWrite) {
+    ReceiveBuffer buffer;
+    QByteArray frame = makeFrame("written in place");
+
+    int room;
+    char* tail = buffer.prepareWrite(frame.size(), room);
+    ASSERT_GE(room, frame.size());
+    std::memcpy(tail, frame.constData(), 6);
+    buffer.commitWrite(6);
+
+    const char* data;
+    int size;
+    EXPECT_FALSE(buffer.nextFrame(data, size));
+    tail = buffer.prepareWrite(frame.size() - 6, room);
+    std::memcpy(tail, frame.constData() + 6, frame.size() - 6);
+    buffer.commitWrite(frame.size() - 6);
+    ASSERT_TRUE(buffer.nextFrame(data, size));
+    EXPECT_EQ(QByteArray(data, size), QByteArray("written in place"));
+}
+
+// Test a length prefix above MaxFrameSize is rejected instead of waited for
+TEST(ReceiveBufferTest, OversizedPrefix) {
+    ReceiveBuffer buffer;
+    char prefix[ReceiveBuffer::PrefixSize];
+    qToBigEndian(quint32(0xFFFFFFF0), prefix);
+    buffer.append(prefix, ReceiveBuffer::PrefixSize);
+    QByteArray next = makeFrame("after");
+    buffer.append(next.constData(), next.size());
+
+    const char* data;
+    int size;
+    EXPECT_FALSE(buffer.nextFrame(data, size));
+    EXPECT_TRUE(buffer.hasError());
+    EXPECT_FALSE(buffer.nextFrame(data, size));
+
+    ReceiveBuffer limit;
+    QByteArray largest = makeFrame(QByteArray(ReceiveBuffer::MaxFrameSize, 'x'));
+    limit.append(largest.constData(), largest.size());
+    ASSERT_TRUE(limit.nextFrame(data, size));
+    EXPECT_EQ(size, ReceiveBuffer::MaxFrameSize);
+    EXPECT_FALSE(limit.hasError());
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "../src/reorderbuffer.h"
+#include "../src/retransmitbuffer.h"
+
+static Message message(int sequence) {
+    return Message(QString("message %1").arg(sequence), "Node2", "Node1", sequence);
+}
+
+static QList<int> sequences(const QVector<Message>& messages) {
+    QList<int> result;
+    for (const Message& m : messages) {
+        result.append(m.getSequenceNumber());
+    }
+    return result;
+}
+
+// Test buffered messages are released in order once the gap fills
+TEST(ReorderBufferTest, ReleasesInOrder) {
+    ReorderBuffer buffer(8);
+    QVector<Message> ready;
+
+    EXPECT_EQ(buffer.insert(message(3), ready), ReorderBuffer::Buffered);
+    EXPECT_EQ(buffer.insert(message(2), ready), ReorderBuffer::Buffered);
+    EXPECT_TRUE(ready.isEmpty());
+    EXPECT_TRUE(buffer.hasGap());
+
+    EXPECT_EQ(buffer.insert(message(1), ready), ReorderBuffer::Delivered);
+    EXPECT_EQ(sequences(ready), QList<int>({1, 2, 3}));
+    EXPECT_EQ(buffer.expected(), 4);
+    EXPECT_EQ(buffer.buffered(), 0);
+    EXPECT_FALSE(buffer.hasGap());
+
+    EXPECT_EQ(buffer.insert(message(2), ready), ReorderBuffer::Duplicate);
+}
+
+// Test gaps are reported as ranges and the window bounds what is held
+TEST(ReorderBufferTest, MissingRangesAndWindow) {
+    ReorderBuffer buffer(4);
+    QVector<Message> ready;
+
+    buffer.insert(message(2), ready);
+    buffer.insert(message(4), ready);
+    EXPECT_EQ(buffer.insert(message(4), ready), ReorderBuffer::Duplicate);
+    EXPECT_EQ(buffer.insert(message(9), ready), ReorderBuffer::OutOfWindow);
+
+    QVector<SequenceRange> missing = buffer.missingRanges(8);
+    ASSERT_EQ(missing.size(), 2);
+    EXPECT_EQ(missing[0].first, 1);
+    EXPECT_EQ(missing[0].length, 1);
+    EXPECT_EQ(missing[1].first, 3);
+    EXPECT_EQ(missing[1].length, 1);
+    EXPECT_EQ(buffer.missingRanges(1).size(), 1);
+}
+
+// Test skipping a gap releases what was waiting behind it
+TEST(ReorderBufferTest, SkipGap) {
+    ReorderBuffer buffer(8, 10);
+    QVector<Message> ready;
+
+    buffer.insert(message(12), ready);
+    buffer.insert(message(13), ready);
+    EXPECT_EQ(buffer.skipGap(ready), 2);
+    EXPECT_EQ(sequences(ready), QList<int>({12, 13}));
+    EXPECT_EQ(buffer.expected(), 14);
+
+    // A late arrival of a skipped message is a duplicate
+    EXPECT_EQ(buffer.insert(message(10), ready), ReorderBuffer::Duplicate);
+}
+
+// Test the retransmit buffer keeps the most recent capacity messages
+TEST(RetransmitBufferTest, KeepsRecentMessages) {
+    RetransmitBuffer buffer(4);
+    for (int i = 1; i <= 6; ++i) {
+        buffer.add(message(i));
+    }
+
+    Message found;
+    EXPECT_FALSE(buffer.find(2, found));
+    ASSERT_TRUE(buffer.find(5, found));
+    EXPECT_EQ(found.getChatText(), "message 5");
+    EXPECT_FALSE(buffer.find(7, found));
+}
+
+// Test a retransmit buffer allocates nothing until the first message
+TEST(RetransmitBufferTest, AllocatesOnFirstMessage) {
+    RetransmitBuffer buffer;
+    Message found;
+    EXPECT_TRUE(buffer.isEmpty());
+    EXPECT_FALSE(buffer.find(1, found));
+
+    buffer.add(message(1));
+    EXPECT_FALSE(buffer.isEmpty());
+    EXPECT_TRUE(buffer.find(1, found));
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "../src/ringconfig.h"
+
+// Test the generated local ring matches the classic four-node layout
+TEST(RingConfigTest, LocalRing) {
+    RingConfig ring = RingConfig::localRing();
+    ASSERT_EQ(ring.size(), 4);
+    EXPECT_EQ(ring.member(0).nodeId, "Node1");
+    EXPECT_EQ(ring.member(3).port, 9004);
+    EXPECT_EQ(ring.indexOfPort(9003), 2);
+    EXPECT_EQ(ring.indexOfNode("Node2"), 1);
+    EXPECT_EQ(ring.nextIndex(3), 0);
+
+    RingConfig large = RingConfig::localRing(1000, 20000);
+    EXPECT_EQ(large.size(), 1000);
+    EXPECT_EQ(large.member(999).nodeId, "Node1000");
+    EXPECT_EQ(large.member(999).port, 20999);
+}
+
+// Test members, comments and blank lines in a topology file
+TEST(RingConfigTest, ParseMembers) {
+    RingConfig ring;
+    QString error;
+    ASSERT_TRUE(ring.parse("# relay ring\n"
+                           "alpha 10.0.0.1:7000\n"
+                           "\n"
+                           "beta   10.0.0.2:7000   # second box\n"
+                           "gamma localhost:7001\n", error)) << error.toStdString();
+
+    ASSERT_EQ(ring.size(), 3);
+    EXPECT_EQ(ring.nodeIds(), QStringList({"alpha", "beta", "gamma"}));
+    EXPECT_EQ(ring.member(1).host, "10.0.0.2");
+    EXPECT_EQ(ring.member(1).port, 7000);
+    EXPECT_EQ(ring.member(0).listenAddress(), QHostAddress(QHostAddress::Any));
+    EXPECT_EQ(ring.member(2).listenAddress(), QHostAddress(QHostAddress::LocalHost));
+}
+
+// Test malformed lines and duplicate members are rejected with the line number
+TEST(RingConfigTest, RejectsInvalidMembers) {
+    RingConfig ring;
+    QString error;
+
+    EXPECT_FALSE(ring.parse("alpha 10.0.0.1\n", error));
+    EXPECT_TRUE(error.startsWith("line 1"));
+
+    EXPECT_FALSE(ring.parse("alpha 10.0.0.1:7000\nalpha 10.0.0.2:7000\n", error));
+    EXPECT_TRUE(error.startsWith("line 2"));
+
+    EXPECT_FALSE(ring.parse("alpha 10.0.0.1:7000\nbeta 10.0.0.1:7000\n", error));
+    EXPECT_FALSE(ring.parse("alpha 10.0.0.1:99999\n", error));
+    EXPECT_FALSE(ring.parse("# nothing here\n", error));
+}
+
+// Test a ring with more members than there are wire handles is rejected while parsing
+TEST(RingConfigTest, RejectsTooManyMembers) {
+    QString text;
+    for (int i = 0; i < RingConfig::MaxMembers; ++i) {
+        text += QString("n%1 10.0.%2.%3:7000\n").arg(i).arg(i / 256).arg(i % 256);
+    }
+
+    RingConfig ring;
+    QString error;
+    ASSERT_TRUE(ring.parse(text, error)) << error.toStdString();
+    EXPECT_EQ(ring.size(), RingConfig::MaxMembers);
+
+    text += "one-more 10.1.0.0:7000\n";
+    EXPECT_FALSE(ring.parse(text, error));
+    EXPECT_EQ(error, QString("line %1: ring has more than %2 members").arg(RingConfig::MaxMembers + 1)
+                         .arg(RingConfig::MaxMembers));
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../src/ringrouter.h"
+
+// Test clockwise mode always hands frames to the successor
+TEST(RingRouterTest, ClockwiseUsesSuccessor) {
+    RingRouter router;
+    router.configure(8, 2, RingRouter::Clockwise);
+
+    EXPECT_EQ(router.neighbors(), QList<int>({3}));
+    EXPECT_EQ(router.nextHop(1), 3);
+    EXPECT_EQ(router.hopCount(1), 7);
+    EXPECT_EQ(router.nextHop(2), -1);
+    EXPECT_EQ(router.nextHop(8), -1);
+}
+
+// Test shortest-direction mode picks the nearer way round, ties going clockwise
+TEST(RingRouterTest, ShortestDirection) {
+    RingRouter router;
+    router.configure(8, 0, RingRouter::ShortestDirection);
+
+    EXPECT_EQ(router.neighbors(), QList<int>({1, 7}));
+    EXPECT_EQ(router.nextHop(3), 1);
+    EXPECT_EQ(router.nextHop(4), 1);
+    EXPECT_EQ(router.nextHop(5), 7);
+    EXPECT_EQ(router.hopCount(5), 3);
+    EXPECT_EQ(router.hopCount(4), 4);
+}
+
+// Test a frame keeps its direction at every hop, so it never bounces back
+TEST(RingRouterTest, DirectionIsStableAlongThePath) {
+    const int size = 9;
+    for (int origin = 0; origin < size; ++origin) {
+        for (int destination = 0; destination < size; ++destination) {
+            RingRouter router;
+            router.configure(size, origin, RingRouter::ShortestDirection);
+            int expectedHops = router.hopCount(destination);
+
+            int at = origin;
+            int hops = 0;
+            while (at != destination && hops <= size) {
+                router.configure(size, at, RingRouter::ShortestDirection);
+                at = router.nextHop(destination);
+                ++hops;
+            }
+            EXPECT_EQ(at, destination);
+            EXPECT_EQ(hops, expectedHops) << origin << " -> " << destination;
+            EXPECT_LE(hops, size / 2);
+        }
+    }
+}
+
+// Test rings too small for a second direction
+TEST(RingRouterTest, SmallRings) {
+    RingRouter router;
+    router.configure(2, 1, RingRouter::ShortestDirection);
+    EXPECT_EQ(router.neighbors(), QList<int>({0}));
+    EXPECT_EQ(router.nextHop(0), 0);
+
+    router.configure(1, 0, RingRouter::ShortestDirection);
+    EXPECT_TRUE(router.neighbors().isEmpty());
+}
+
+// Test every mode reaches every member in the predicted number of hops on
+// rings of one and two nodes and on sizes that are not powers of two
+TEST(RingRouterTest, EveryModeOnOddAndTinyRings) {
+    const RingRouter::Mode modes[] = {RingRouter::Clockwise, RingRouter::ShortestDirection, RingRouter::Finger};
+    for (int size : {1, 2, 3, 5, 6, 7, 9, 12, 15, 17, 31, 33, 100}) {
+        for (RingRouter::Mode mode : modes) {
+            RingRouter router;
+            for (int origin = 0; origin < size; ++origin) {
+                router.configure(size, origin, mode);
+                EXPECT_EQ(router.neighbors().isEmpty(), size == 1);
+                EXPECT_EQ(router.nextHop(origin), -1);
+                EXPECT_EQ(router.nextHop(size), -1);
+                for (int destination = 0; destination < size; ++destination) {
+                    router.configure(size, origin, mode);
+                    int expectedHops = router.hopCount(destination);
+
+                    int at = origin;
+                    int hops = 0;
+                    while (at != destination && hops <= size) {
+                        router.configure(size, at, mode);
+                        int next = router.nextHop(destination);
+                        ASSERT_TRUE(router.neighbors().contains(next)) << size << ": " << at << " -> " << next;
+                        at = next;
+                        ++hops;
+                    }
+                    EXPECT_EQ(at, destination) << size << ": " << origin << " -> " << destination;
+                    EXPECT_EQ(hops, expectedHops) << size << ": " << origin << " -> " << destination;
+                    EXPECT_LT(hops, qMax(size, 1));
+                }
+            }
+        }
+    }
+}
+
+// Test finger mode links to power-of-two distances and reaches anything in log2(N) hops
+TEST(RingRouterTest, FingerRouting) {
+    RingRouter router;
+    router.configure(16, 3, RingRouter::Finger);
+
+    EXPECT_EQ(router.neighbors(), QList<int>({4, 5, 7, 11}));
+    EXPECT_EQ(router.nextHop(4), 4);
+    EXPECT_EQ(router.nextHop(10), 7);
+    EXPECT_EQ(router.nextHop(2), 11);
+    EXPECT_EQ(router.hopCount(2), 4);
+
+    const int size = 1024;
+    for (int destination = 1; destination < size; destination += 37) {
+        int at = 0;
+        int hops = 0;
+        while (at != destination && hops <= size) {
+            router.configure(size, at, RingRouter::Finger);
+            at = router.nextHop(destination);
+            ++hops;
+        }
+        EXPECT_EQ(at, destination);
+        EXPECT_LE(hops, 10);
+        router.configure(size, 0, RingRouter::Finger);
+        EXPECT_EQ(hops, router.hopCount(destination));
+    }
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <QFile>
+#include <QTemporaryDir>
+#include "../src/scrollbacklog.h"
+#include "../src/conversationmodel.h"
+
+class ScrollbackLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(dir.isValid());
+        path = dir.filePath("Node1-Node2");
+    }
+
+    static QVector<ConversationModel::Entry> entries(int first, int count) {
+        QVector<ConversationModel::Entry> batch;
+        for (int i = first; i < first + count; ++i) {
+            batch.append({QString("message %1").arg(i),
+                          i % 2 ? ConversationModel::Sent : ConversationModel::Received});
+        }
+        return batch;
+    }
+
+    QTemporaryDir dir;
+    QString path;
+};
+
+// Test records are read back by index range after a reopen
+TEST_F(ScrollbackLogTest, ReadRangeAfterReopen) {
+    {
+        ScrollbackLog log;
+        ASSERT_TRUE(log.open(path));
+        ASSERT_TRUE(log.append(entries(0, 10)));
+        ASSERT_TRUE(log.append(entries(10, 5)));
+        EXPECT_EQ(log.count(), 15);
+    }
+
+    ScrollbackLog log;
+    ASSERT_TRUE(log.open(path));
+    EXPECT_EQ(log.count(), 15);
+
+    QVector<ConversationModel::Entry> page = log.read(7, 4);
+    ASSERT_EQ(page.size(), 4);
+    EXPECT_EQ(page[0].text, "message 7");
+    EXPECT_EQ(page[0].kind, ConversationModel::Sent);
+    EXPECT_EQ(page[3].text, "message 10");
+    EXPECT_EQ(log.read(13, 10).size(), 2);
+}
+
+// Test a torn record and a stale index are repaired on open
+TEST_F(ScrollbackLogTest, RecoversFromTornTail) {
+    {
+        ScrollbackLog log;
+        ASSERT_TRUE(log.open(path));
+        ASSERT_TRUE(log.append(entries(0, 3)));
+    }
+    QFile raw(path + ".log");
+    ASSERT_TRUE(raw.open(QIODevice::Append));
+    raw.write("\x00\x00\x00\x40\x01partial", 12);
+    raw.close();
+
+    ScrollbackLog log;
+    ASSERT_TRUE(log.open(path));
+    EXPECT_EQ(log.count(), 3);
+    ASSERT_TRUE(log.append(entries(3, 1)));
+    EXPECT_EQ(log.read(3, 1).value(0).text, "message 3");
+}
+
+// Test the model keeps a bounded window and pages older rows back in
+TEST_F(ScrollbackLogTest, ModelWindowPaging) {
+    ConversationModel model;
+    model.setWindowRows(10);
+    ASSERT_TRUE(model.openScrollback(path));
+
+    model.append(entries(0, 25));
+    model.trimToWindow();
+    ASSERT_EQ(model.rowCount(), 10);
+    EXPECT_EQ(model.entry(0).text, "message 15");
+    EXPECT_TRUE(model.hasOlder());
+
+    EXPECT_EQ(model.fetchOlder(8), 8);
+    EXPECT_EQ(model.entry(0).text, "message 7");
+    EXPECT_EQ(model.fetchOlder(100), 7);
+    EXPECT_EQ(model.entry(0).text, "message 0");
+    EXPECT_FALSE(model.hasOlder());
+
+    // A new model over the same log starts from the newest window
+    ConversationModel restored;
+    restored.setWindowRows(10);
+    ASSERT_TRUE(restored.openScrollback(path));
+    ASSERT_EQ(restored.rowCount(), 10);
+    EXPECT_EQ(restored.entry(9).text, "message 24");
+}
+
+// Test appends return before the writer thread has run, and a read of the
+// newest records waits for them rather than coming back short
+TEST_F(ScrollbackLogTest, ReadsWaitForQueuedWrites) {
+    ScrollbackLog log;
+    ASSERT_TRUE(log.open(path));
+    for (int batch = 0; batch < 50; ++batch) {
+        ASSERT_TRUE(log.append(entries(batch * 20, 20)));
+    }
+    EXPECT_EQ(log.count(), 1000);
+
+    QVector<ConversationModel::Entry> page = log.read(990, 10);
+    ASSERT_EQ(page.size(), 10);
+    EXPECT_EQ(page[0].text, "message 990");
+    EXPECT_EQ(page[9].text, "message 999");
+    EXPECT_EQ(QFile(path + ".idx").size(), 1000 * 8);
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include "../src/tracewriter.h"
+
+// Test each hop becomes a complete event spanning the time to the next hop
+TEST(TraceWriterTest, OneSlicePerHop) {
+    NodeTable nodes;
+    nodes.setRingMembers(QStringList({"Node1", "Node2", "Node3"}));
+
+    Message message("traced", "Node1", "Node3", 7);
+    message.setTraced(true);
+    message.addTraceHop(0, 1000);
+    message.addTraceHop(1, 1250);
+    message.addTraceHop(2, 1600);
+
+    QByteArray events = TraceWriter::traceEvents(message, nodes, 4);
+    EXPECT_TRUE(events.contains("\"args\":{\"name\":\"Node1 #7 -> Node3\"}"));
+    EXPECT_TRUE(events.contains("{\"name\":\"Node1 -> Node2\",\"cat\":\"hop\",\"ph\":\"X\",\"pid\":1,\"tid\":4,"
+                                "\"ts\":1000,\"dur\":250"));
+    EXPECT_TRUE(events.contains("{\"name\":\"Node2 -> Node3\",\"cat\":\"hop\",\"ph\":\"X\",\"pid\":1,\"tid\":4,"
+                                "\"ts\":1250,\"dur\":350"));
+    EXPECT_EQ(events.count("\"ph\":\"X\""), 2);
+}
+
+// Test timelines reach the file every FlushEvents messages, not only on close
+TEST(TraceWriterTest, FlushesEveryFewEvents) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString path = dir.filePath("trace.json");
+    NodeTable nodes;
+    nodes.setRingMembers(QStringList({"Node1", "Node2"}));
+
+    TraceWriter writer;
+    ASSERT_TRUE(writer.open(path));
+    Message message("traced", "Node1", "Node2", 1);
+    message.setTraced(true);
+    message.addTraceHop(0, 1000);
+    message.addTraceHop(1, 1100);
+
+    writer.write(message, nodes);
+    EXPECT_LT(QFileInfo(path).size(), 100);
+    for (int i = 1; i < TraceWriter::FlushEvents; ++i) {
+        writer.write(message, nodes);
+    }
+    EXPECT_GT(QFileInfo(path).size(), TraceWriter::FlushEvents * 100);
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QtEndian>
+#include "../src/receivebuffer.h"
+#include "../src/transport.h"
+
+// Loopback tests run against every backend built in; one the kernel refuses is skipped
+class TransportTest : public ::testing::TestWithParam<Transport::Backend> {
+protected:
+    static constexpr quint16 FirstPort = 47300;
+    static constexpr int PortAttempts = 100;
+
+    static void SetUpTestSuite() {
+        // Sockets need an event loop; one application object serves every test
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char name[] = "SimpleChat_Tests";
+            static char* argv[] = {name, nullptr};
+            new QCoreApplication(argc, argv);
+        }
+    }
+
+    void SetUp() override {
+        transport = Transport::create(GetParam());
+        if (!transport) {
+            GTEST_SKIP() << "Backend " << Transport::backendName(GetParam()).toStdString() << " is not available";
+        }
+        QObject::connect(transport, &Transport::newConnection, [this](Connection* connection) {
+            accepted = connection;
+            QObject::connect(connection, &Connection::disconnected, [this]() { ++acceptedDisconnects; });
+        });
+
+        port = FirstPort;
+        while (!transport->listen(QHostAddress::LocalHost, port)) {
+            ASSERT_LT(++port, FirstPort + PortAttempts) << transport->errorString().toStdString();
+        }
+
+        client = transport->createConnection();
+        QObject::connect(client, &Connection::disconnected, [this]() { ++clientDisconnects; });
+        client->connectToHost("127.0.0.1", port);
+        ASSERT_TRUE(waitFor([this]() { return accepted && client->isConnected(); }));
+    }
+
+    void TearDown() override {
+        delete client;
+        delete accepted.data();
+        delete transport;
+    }
+
+    template<typename Predicate>
+    static bool waitFor(Predicate done, int timeoutMsec = 10000) {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done()) {
+            if (timer.hasExpired(timeoutMsec)) {
+                return false;
+            }
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        return true;
+    }
+
+    static void pump(int msec) {
+        waitFor([]() { return false; }, msec);
+    }
+
+    // Every byte depends on the frame index and its offset, so reordering or loss shows up
+    static QByteArray body(int index, int size) {
+        QByteArray bytes(size, Qt::Uninitialized);
+        for (int i = 0; i < size; ++i) {
+            bytes[i] = char((index * 31 + i) & 0xFF);
+        }
+        return bytes;
+    }
+
+    static void writeFrame(Connection* connection, const QByteArray& frame) {
+        char prefix[ReceiveBuffer::PrefixSize];
+        qToBigEndian(quint32(frame.size()), prefix);
+        ASSERT_EQ(connection->write(prefix, ReceiveBuffer::PrefixSize), ReceiveBuffer::PrefixSize);
+        ASSERT_EQ(connection->write(frame), frame.size());
+    }
+
+    void readFrames() {
+        accepted->readInto(buffer);
+        const char* data;
+        int size;
+        while (buffer.nextFrame(data, size)) {
+            received.append(QByteArray(data, size));
+        }
+    }
+
+    bool receiveAll(int count) {
+        return waitFor([this, count]() {
+            readFrames();
+            return received.size() >= count;
+        });
+    }
+
+    Transport* transport = nullptr;
+    quint16 port = 0;
+    Connection* client = nullptr;
+    QPointer<Connection> accepted;
+    int clientDisconnects = 0;
+    int acceptedDisconnects = 0;
+    ReceiveBuffer buffer;
+    QVector<QByteArray> received;
+};
+
+// Test frames of every size class arrive intact and in order: small copies,
+// zero-copy sized sends and frames spanning several send slots
+TEST_P(TransportTest, InOrderAcrossSizes) {
+    const QVector<int> sizes = {1, 100, 16 * 1024 - 1, 16 * 1024, 64 * 1024, 64 * 1024 + 1, 300 * 1024, 5};
+    QVector<QByteArray> sent;
+    for (int round = 0; round < 3; ++round) {
+        for (int size : sizes) {
+            sent.append(body(sent.size(), size));
+            writeFrame(client, sent.last());
+        }
+    }
+
+    ASSERT_TRUE(receiveAll(sent.size()));
+    ASSERT_EQ(received.size(), sent.size());
+    for (int i = 0; i < sent.size(); ++i) {
+        EXPECT_EQ(received[i], sent[i]) << "frame " << i;
+    }
+}
+
+// Test a reader that falls behind loses nothing: the writer's queue backs up
+// (short sends, exhausted send slots) and the receiver runs out of buffers
+// before it starts reading again
+TEST_P(TransportTest, SlowReaderGetsEverything) {
+    const int frameSize = 96 * 1024;
+    const int frameCount = 128;
+    for (int i = 0; i < frameCount; ++i) {
+        writeFrame(client, body(i, frameSize));
+    }
+    pump(300);
+
+    ASSERT_TRUE(receiveAll(frameCount));
+    ASSERT_EQ(received.size(), frameCount);
+    for (int i = 0; i < frameCount; ++i) {
+        EXPECT_EQ(received[i], body(i, frameSize)) << "frame " << i;
+    }
+    EXPECT_TRUE(waitFor([this]() { return client->bytesToWrite() == 0; }));
+}
+
+// Test disconnecting right after a large write still delivers all of it, then closes
+TEST_P(TransportTest, DisconnectSendsQueuedData) {
+    const int frameSize = 128 * 1024;
+    const int frameCount = 32;
+    for (int i = 0; i < frameCount; ++i) {
+        writeFrame(client, body(i, frameSize));
+    }
+    client->disconnectFromHost();
+    EXPECT_FALSE(client->isConnected());
+
+    ASSERT_TRUE(receiveAll(frameCount));
+    for (int i = 0; i < frameCount; ++i) {
+        EXPECT_EQ(received[i], body(i, frameSize)) << "frame " << i;
+    }
+    EXPECT_TRUE(waitFor([this]() { return clientDisconnects > 0 && acceptedDisconnects > 0; }));
+    EXPECT_EQ(clientDisconnects, 1);
+    EXPECT_EQ(buffer.bytesAvailable(), 0);
+}
+
+// Test closing one end is reported once on the other
+TEST_P(TransportTest, PeerDisconnectIsReported) {
+    accepted->disconnectFromHost();
+    ASSERT_TRUE(waitFor([this]() { return clientDisconnects > 0; }));
+    EXPECT_FALSE(client->isConnected());
+    pump(50);
+    EXPECT_EQ(clientDisconnects, 1);
+    EXPECT_EQ(acceptedDisconnects, 1);
+}
+
+// Test a connection opened after another closed, likely on the same descriptor,
+// gets its own events and none of the old one's
+TEST_P(TransportTest, ReconnectAfterClose) {
+    accepted->disconnectFromHost();
+    ASSERT_TRUE(waitFor([this]() { return clientDisconnects > 0; }));
+    delete client;
+    delete accepted.data();
+
+    client = transport->createConnection();
+    QObject::connect(client, &Connection::disconnected, [this]() { ++clientDisconnects; });
+    client->connectToHost("127.0.0.1", port);
+    ASSERT_TRUE(waitFor([this]() { return accepted && client->isConnected(); }));
+
+    writeFrame(client, body(7, 1000));
+    ASSERT_TRUE(receiveAll(1));
+    EXPECT_EQ(received[0], body(7, 1000));
+    pump(50);
+    EXPECT_EQ(clientDisconnects, 1);
+    EXPECT_TRUE(client->isConnected());
+}
+
+// Test a transport listening on QHostAddress::Any, as non-loopback ring members
+// do, accepts an IPv4 peer
+TEST_P(TransportTest, ListensOnAnyAddress) {
+    Transport* wildcard = Transport::create(GetParam());
+    ASSERT_NE(wildcard, nullptr);
+    QPointer<Connection> wildcardAccepted;
+    QObject::connect(wildcard, &Transport::newConnection, [&wildcardAccepted](Connection* connection) {
+        wildcardAccepted = connection;
+    });
+    quint16 anyPort = port + 1;
+    while (!wildcard->listen(QHostAddress::Any, anyPort)) {
+        ASSERT_LT(++anyPort, FirstPort + 2 * PortAttempts) << wildcard->errorString().toStdString();
+    }
+
+    Connection* peer = wildcard->createConnection();
+    peer->connectToHost("127.0.0.1", anyPort);
+    ASSERT_TRUE(waitFor([&]() { return wildcardAccepted && peer->isConnected(); }));
+
+    writeFrame(peer, body(3, 500));
+    ReceiveBuffer anyBuffer;
+    const char* data = nullptr;
+    int size = 0;
+    ASSERT_TRUE(waitFor([&]() {
+        wildcardAccepted->readInto(anyBuffer);
+        return anyBuffer.nextFrame(data, size);
+    }));
+    EXPECT_EQ(QByteArray(data, size), body(3, 500));
+
+    delete peer;
+    delete wildcardAccepted.data();
+    delete wildcard;
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, TransportTest,
+                         ::testing::Values(Transport::QtSockets, Transport::Epoll, Transport::IoUring),
+                         [](const ::testing::TestParamInfo<Transport::Backend>& info) {
+                             return Transport::backendName(info.param).toStdString();
+                         });
@@ -0,0 +1,300 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <cstring>
+#include "../src/wireformat.h"
+
+class WireFormatTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        nodes.setRingMembers({"Node1", "Node2", "Node3", "Node4"});
+    }
+
+    NodeTable nodes;
+};
+
+// Test binary round trip with interned node IDs
+TEST_F(WireFormatTest, RoundTripRingMembers) {
+    Message original("Hello ring", "Node1", "Node3", 42);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_EQ(decoded.getChatText(), "Hello ring");
+    EXPECT_EQ(decoded.getOrigin(), "Node1");
+    EXPECT_EQ(decoded.getDestination(), "Node3");
+    EXPECT_EQ(decoded.getSequenceNumber(), 42);
+    EXPECT_EQ(decoded.originHandle(), nodes.handleOf("Node1"));
+    EXPECT_EQ(decoded.destinationHandle(), nodes.handleOf("Node3"));
+}
+
+// Test that ring members are not spelled out on the wire
+TEST_F(WireFormatTest, RingMembersUseHandles) {
+    Message msg("Hi", "Node2", "Node4", 1);
+    QByteArray frame;
+    WireFormat::encodeMessage(msg, nodes, frame);
+
+    EXPECT_FALSE(frame.contains("Node"));
+    // header + 1-byte sequence + 1-byte length + 2 bytes text
+    EXPECT_EQ(frame.size(), WireFormat::HeaderSize + 4);
+
+    QByteArray legacy;
+    WireFormat::encodeLegacy(msg, legacy);
+    EXPECT_LT(frame.size(), legacy.size());
+}
+
+// Test nodes outside the ring are sent inline
+TEST_F(WireFormatTest, InlineNodeIds) {
+    Message original("Outsider", "Node9", "Node2", 300);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    WireFormat::FrameHeader header;
+    ASSERT_TRUE(WireFormat::readHeader(frame.constData(), frame.size(), header));
+    EXPECT_EQ(header.flags, WireFormat::InlineOrigin);
+    EXPECT_EQ(header.origin, WireFormat::InlineHandle);
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_EQ(decoded.getOrigin(), "Node9");
+    EXPECT_EQ(decoded.getDestination(), "Node2");
+    EXPECT_EQ(decoded.getSequenceNumber(), 300);
+    EXPECT_EQ(decoded.originHandle(), NodeTable::InvalidHandle);
+    EXPECT_EQ(decoded.destinationHandle(), nodes.handleOf("Node2"));
+}
+
+// Test destination peeking for cut-through forwarding
+TEST_F(WireFormatTest, PeekDestination) {
+    QByteArray frame;
+    WireFormat::encodeMessage(Message("Transit", "Node1", "Node4", 3), nodes, frame);
+
+    quint16 handle;
+    const char* name;
+    int nameSize;
+    ASSERT_TRUE(WireFormat::peekDestination(frame.constData(), frame.size(), handle, name, nameSize));
+    EXPECT_EQ(handle, nodes.handleOf("Node4"));
+    EXPECT_EQ(name, nullptr);
+
+    QByteArray inlineFrame;
+    WireFormat::encodeMessage(Message("Transit", "Node1", "Relay7", 3), nodes, inlineFrame);
+    ASSERT_TRUE(WireFormat::peekDestination(inlineFrame.constData(), inlineFrame.size(), handle, name, nameSize));
+    EXPECT_EQ(handle, WireFormat::InlineHandle);
+    EXPECT_EQ(QByteArray(name, nameSize), QByteArray("Relay7"));
+}
+
+// Test Unicode payload survives the UTF-8 encoding
+TEST_F(WireFormatTest, UnicodePayload) {
+    QString text = "Unicode: 你好 🎉";
+    Message original(text, "Node1", "Node2", 1);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_EQ(decoded.getChatText(), text);
+}
+
+// Test legacy frames are still readable and distinguishable
+TEST_F(WireFormatTest, LegacyFrames) {
+    Message original("Legacy", "Node1", "Node2", 7);
+    QByteArray frame;
+    WireFormat::encodeLegacy(original, frame);
+
+    EXPECT_FALSE(WireFormat::isBinaryFrame(frame.constData(), frame.size()));
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeLegacy(frame.constData(), frame.size(), decoded));
+    EXPECT_EQ(decoded.getChatText(), "Legacy");
+    EXPECT_EQ(decoded.getSequenceNumber(), 7);
+}
+
+// Test truncated frames are rejected
+TEST_F(WireFormatTest, TruncatedFrame) {
+    Message original("Truncate me", "Node1", "Node2", 5);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    Message decoded;
+    for (int size = 0; size < frame.size(); ++size) {
+        EXPECT_FALSE(WireFormat::decodeMessage(frame.constData(), size, nodes, decoded));
+    }
+}
+
+// Test hello frames carry the offered version and sender
+TEST_F(WireFormatTest, HelloFrame) {
+    QByteArray frame;
+    WireFormat::encodeHello(WireFormat::HelloFrame, WireFormat::Version, "Node3", nodes, frame);
+
+    WireFormat::FrameHeader header;
+    ASSERT_TRUE(WireFormat::readHeader(frame.constData(), frame.size(), header));
+    EXPECT_EQ(header.type, WireFormat::HelloFrame);
+    EXPECT_EQ(header.version, WireFormat::Version);
+
+    QString origin;
+    ASSERT_TRUE(WireFormat::decodeHelloOrigin(frame.constData(), frame.size(), nodes, origin));
+    EXPECT_EQ(origin, "Node3");
+}
+
+// Test varint encoding boundaries
+TEST_F(WireFormatTest, VarintBoundaries) {
+    for (quint32 value : {0u, 127u, 128u, 16383u, 16384u, 0xFFFFFFFFu}) {
+        QByteArray out;
+        WireFormat::appendVarint(out, value);
+
+        const char* p = out.constData();
+        quint32 decoded = 0;
+        ASSERT_TRUE(WireFormat::readVarint(p, out.constData() + out.size(), decoded));
+        EXPECT_EQ(decoded, value);
+        EXPECT_EQ(p, out.constData() + out.size());
+    }
+}
+
+// Test varints that do not fit 32 bits or never end are rejected
+TEST_F(WireFormatTest, VarintOverflow) {
+    for (const char* bytes : {"\xFF\xFF\xFF\xFF\x10", "\xFF\xFF\xFF\xFF\x7F", "\x80\x80\x80\x80\x80\x01", "\x80\x80"}) {
+        const char* p = bytes;
+        quint32 decoded = 0;
+        EXPECT_FALSE(WireFormat::readVarint(p, bytes + strlen(bytes), decoded));
+    }
+}
+
+// Test NACK frames round trip and are routed like chat frames
+TEST_F(WireFormatTest, NackFrame) {
+    QVector<SequenceRange> missing(2);
+    missing[0].first = 5;
+    missing[0].length = 1;
+    missing[1].first = 300;
+    missing[1].length = 12;
+
+    QByteArray frame;
+    WireFormat::encodeNack("Node3", "Node1", missing, nodes, frame);
+
+    quint16 handle;
+    const char* name;
+    int nameSize;
+    ASSERT_TRUE(WireFormat::peekDestination(frame.constData(), frame.size(), handle, name, nameSize));
+    EXPECT_EQ(handle, nodes.handleOf("Node1"));
+
+    QString requester;
+    QVector<SequenceRange> decoded;
+    ASSERT_TRUE(WireFormat::decodeNack(frame.constData(), frame.size(), nodes, requester, decoded));
+    EXPECT_EQ(requester, "Node3");
+    ASSERT_EQ(decoded.size(), 2);
+    EXPECT_EQ(decoded[1].first, 300);
+    EXPECT_EQ(decoded[1].length, 12);
+
+    Message message;
+    EXPECT_FALSE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, message));
+}
+
+// Test NACK ranges running past the largest sequence number are rejected
+TEST_F(WireFormatTest, NackRangeOverflow) {
+    QVector<SequenceRange> missing(1);
+    missing[0].first = INT_MAX - 1;
+    missing[0].length = 5;
+
+    QByteArray frame;
+    WireFormat::encodeNack("Node3", "Node1", missing, nodes, frame);
+
+    QString requester;
+    QVector<SequenceRange> decoded;
+    EXPECT_FALSE(WireFormat::decodeNack(frame.constData(), frame.size(), nodes, requester, decoded));
+}
+
+// Test skipped ranges ride along with the cumulative ACK
+TEST_F(WireFormatTest, AckSkippedRanges) {
+    SequenceRange lost;
+    lost.first = 40;
+    lost.length = 3;
+    QByteArray ack;
+    WireFormat::encodeAck("Node3", "Node1", 50, 120, QVector<SequenceRange>{lost}, nodes, ack);
+
+    QString acker;
+    int cumulative;
+    qint64 oneWayUsec;
+    QVector<SequenceRange> skipped;
+    ASSERT_TRUE(WireFormat::decodeAck(ack.constData(), ack.size(), nodes, acker, cumulative, oneWayUsec, skipped));
+    EXPECT_EQ(cumulative, 50);
+    EXPECT_EQ(oneWayUsec, 120);
+    ASSERT_EQ(skipped.size(), 1);
+    EXPECT_EQ(skipped[0].first, 40);
+    EXPECT_EQ(skipped[0].length, 3);
+
+    // A truncated list is rejected rather than read as a plain ACK
+    ack.chop(1);
+    EXPECT_FALSE(WireFormat::decodeAck(ack.constData(), ack.size(), nodes, acker, cumulative, oneWayUsec, skipped));
+}
+
+// Test ACK frames and timestamped chat frames round trip
+TEST_F(WireFormatTest, AckAndTimestamp) {
+    QByteArray ack;
+    WireFormat::encodeAck("Node3", "Node1", 1234, 560, QVector<SequenceRange>(), nodes, ack);
+
+    QString acker;
+    int cumulative;
+    qint64 oneWayUsec;
+    QVector<SequenceRange> skipped;
+    ASSERT_TRUE(WireFormat::decodeAck(ack.constData(), ack.size(), nodes, acker, cumulative, oneWayUsec, skipped));
+    EXPECT_EQ(acker, "Node3");
+    EXPECT_EQ(cumulative, 1234);
+    EXPECT_EQ(oneWayUsec, 560);
+    EXPECT_TRUE(skipped.isEmpty());
+
+    ack.clear();
+    WireFormat::encodeAck("Node3", "Node1", 7, -1, QVector<SequenceRange>(), nodes, ack);
+    ASSERT_TRUE(WireFormat::decodeAck(ack.constData(), ack.size(), nodes, acker, cumulative, oneWayUsec, skipped));
+    EXPECT_EQ(oneWayUsec, -1);
+
+    Message original("stamped", "Node1", "Node2", 3);
+    original.setTimestamp(1700000000123456);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_EQ(decoded.getChatText(), "stamped");
+    EXPECT_EQ(decoded.getTimestamp(), 1700000000123456);
+}
+
+// Test relays can add trace hops to a frame without decoding it
+TEST_F(WireFormatTest, TraceHops) {
+    Message original("traced", "Node1", "Node3", 9);
+    original.setTimestamp(1700000000123456);
+    original.setTraced(true);
+    original.addTraceHop(0, 1000);
+    QByteArray frame;
+    WireFormat::encodeMessage(original, nodes, frame);
+
+    WireFormat::appendTraceHop(frame, 1, 1250);
+    WireFormat::appendTraceHop(frame, 2, 1600);
+
+    Message decoded;
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_EQ(decoded.getChatText(), "traced");
+    EXPECT_EQ(decoded.getTimestamp(), 1700000000123456);
+    ASSERT_TRUE(decoded.isTraced());
+    ASSERT_EQ(decoded.getTraceHops().size(), 3);
+    EXPECT_EQ(decoded.getTraceHops()[1].node, 1);
+    EXPECT_EQ(decoded.getTraceHops()[2].usec, 1600);
+
+    // A hop record cut off in the middle is rejected
+    frame.remove(frame.size() - 5, 1);
+    EXPECT_FALSE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+
+    Message plain("plain", "Node1", "Node3", 10);
+    frame.clear();
+    WireFormat::encodeMessage(plain, nodes, frame);
+    ASSERT_TRUE(WireFormat::decodeMessage(frame.constData(), frame.size(), nodes, decoded));
+    EXPECT_FALSE(decoded.isTraced());
+}
+
+// Test names beyond the ring only fill a bounded number of local handles
+TEST_F(WireFormatTest, LocalHandlesAreCapped) {
+    for (int i = 0; i < NodeTable::MaxLocalHandles; ++i) {
+        ASSERT_TRUE(nodes.hasLocalRoom());
+        EXPECT_EQ(nodes.intern(QString("Outsider%1").arg(i)), nodes.ringSize() + i);
+    }
+    EXPECT_FALSE(nodes.hasLocalRoom());
+    EXPECT_EQ(nodes.size(), nodes.ringSize() + NodeTable::MaxLocalHandles);
+    EXPECT_TRUE(nodes.isShared(nodes.handleOf("Node4")));
+}